@@ -0,0 +1,85 @@
+#ifndef AGC_H_
+#define AGC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ff.h"
+#include "wave.h"
+
+/*
+    Automatic gain for the captured samples, a block at a time before
+    they are summarised and written. The whole block is at hand, so the
+    gain is first cut to what keeps its peak in range, a limiter with
+    the block as look-ahead, and then moves towards the gain that brings
+    the peak to the target: at the attack rate while coming down, the
+    release rate going up. Across the block the gain ramps linearly from
+    where it starts to where it ends, applied to each sample with a
+    saturating multiply.
+
+    The gains go to R0000001.AGC beside R0000001.WAV, so the recording's
+    true level can be recovered. A AGC_HEADER byte header:
+
+        0   "AGC1"
+        4   sample rate, uint32
+        8   samples per record, uint16
+        10  bytes per record, uint16
+        12  record count, uint32, patched on close (0 if the recording
+            was cut short; the file size then gives it)
+
+    then per block, the last one possibly short: the gain at its first
+    sample and after its last, uint32 each in 16.16 fixed point. Sample
+    i of n has start + i * (end - start) / n.
+*/
+#define AGC_HEADER 16
+#define AGC_RECORD 8
+#define AGC_UNITY  0x10000UL
+
+/*
+    The gain stage a build with AGC starts with: peaks brought to half
+    of full scale, a quiet source raised 16 times at most.
+*/
+#define AGC_ATTACK_MS  10
+#define AGC_RELEASE_MS 300
+#define AGC_TARGET     16384
+#define AGC_MAX_GAIN   16
+
+/*
+    Attack and release are time constants in milliseconds, 0 for at
+    once. The target is the peak level sought; max_gain, at most
+    INT16_MAX, caps how far a quiet source is raised.
+*/
+typedef struct Agc_config
+{
+    uint32_t attack_ms;
+    uint32_t release_ms;
+    uint16_t target;
+    uint16_t max_gain;
+
+}   Agc_config;
+
+/*
+    Gain stage settings for the recordings that follow, NULL to leave
+    the samples as captured.
+*/
+void agc_configure(const Agc_config *config);
+
+bool agc_enabled(void);
+
+/*
+    Starts at unity gain for a recording of block_samples a block, with
+    its log beside wave (the recording's path). A failed log write stops
+    the log, not the gain.
+*/
+FRESULT agc_open(const TCHAR *wave, const Wave_info *info, uint32_t block_samples);
+
+/*
+    Applies the gain to bytes of 16-bit mono samples in place and logs
+    it.
+*/
+void agc_apply(void *samples, uint32_t bytes);
+
+FRESULT agc_close(void);
+
+uint32_t agc_gain(void);
+
+#endif /* AGC_H_ */
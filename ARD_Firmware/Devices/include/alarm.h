@@ -0,0 +1,29 @@
+#ifndef ALARM_H_
+#define ALARM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+    Deadlines on the SysTick tick count, which init() runs at 1 kHz, so
+    every time here is in milliseconds. Alarms are kept in deadline
+    order and their callbacks run from alarm_dispatch() in the main
+    loop, never from the tick interrupt.
+*/
+typedef struct Alarm Alarm;
+
+uint32_t alarm_now(void);
+
+bool alarm_expired(uint32_t deadline);
+
+Alarm *alarm_create(void (*callback)(void));
+
+void alarm_start(Alarm *alarm, uint32_t millisecond);
+
+void alarm_stop(Alarm *alarm);
+
+bool alarm_active(Alarm *alarm);
+
+void alarm_dispatch(void);
+
+#endif /* ALARM_H_ */
@@ -0,0 +1,61 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ff.h"
+#include "wave.h"
+
+/*
+    Card qualification: a sequential stream through f_write, then
+    single and multi-block disk_write/disk_read over the sectors it
+    wrote, each call timed, and the busy time the card holds after a
+    single-block write. Latencies are in microseconds.
+
+    The test size is rounded down to whole pool blocks, from enough sectors
+    for every raw sample to one latency sample per pool-block word.
+*/
+#define BENCH_SIZE_DEFAULT (1024UL * 1024)
+#define BENCH_SIZE_MIN     (256UL * 1024)
+#define BENCH_SIZE_MAX     (4096UL * 1024)
+#define BENCH_SAMPLES      64
+#define BENCH_MULTI        8
+
+typedef struct
+{
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t max;
+
+}   Bench_latency;
+
+typedef struct
+{
+    uint32_t size;
+    uint32_t write_rate;
+    Bench_latency stream;
+    Bench_latency write_single;
+    Bench_latency write_multi;
+    Bench_latency read_single;
+    Bench_latency read_multi;
+    Bench_latency busy;
+
+}   Bench_result;
+
+/*
+    Runs the test on a scratch file at path, which is removed again.
+    The caller lends the file object; the card must be mounted.
+*/
+FRESULT bench_run(FIL *file, const TCHAR *path, uint32_t size, Bench_result *result);
+
+/*
+    Whether the card keeps up with a recording in info's format: the
+    stream rate covers the byte rate and the slowest f_write is shorter
+    than the time the other pool blocks take to fill.
+*/
+bool bench_qualifies(const Bench_result *result, const Wave_info *info, uint32_t blocks);
+
+FRESULT bench_report(FIL *file, const TCHAR *path, const Bench_result *result, const Wave_info *info, uint32_t blocks);
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,42 @@
+#ifndef BLOCKPOOL_H_
+#define BLOCKPOOL_H_
+
+#include <stdint.h>
+#include "ramfunc.h"
+#include "sample.h"
+
+/*
+    Fixed-size audio blocks carved out of the SRAM the linker leaves
+    after .bss and the stack (__blockpool_start__ to __blockpool_end__).
+    Every block is 512-byte aligned and a whole number of sectors, so it
+    can go to f_write as is.
+
+    Capture acquires a block, fills it and submits it; the writer takes
+    it with blockpool_next() and releases it once written. Acquire and
+    release are O(1) and safe from any priority; submit and next form a
+    single producer, single consumer queue.
+
+    A block holds BLOCKPOOL_BLOCK_SAMPLES as captured, with room to pack
+    them to the written format in place.
+*/
+#define BLOCKPOOL_BLOCK_SAMPLES 2048
+#define BLOCKPOOL_BLOCK_SIZE    (BLOCKPOOL_BLOCK_SAMPLES * SAMPLE_ROOM)
+#define BLOCKPOOL_BLOCKS_MAX    32
+
+void blockpool_init(void);
+
+RAMFUNC void *blockpool_acquire(void);
+
+RAMFUNC void blockpool_release(void *block);
+
+RAMFUNC void blockpool_submit(void *block);
+
+void *blockpool_next(void);
+
+uint32_t blockpool_count(void);
+
+uint32_t blockpool_available(void);
+
+uint32_t blockpool_low(void);
+
+#endif /* BLOCKPOOL_H_ */
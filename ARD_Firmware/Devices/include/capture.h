@@ -0,0 +1,30 @@
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdint.h>
+#include "wave.h"
+
+/*
+    Sample rates the ADC0 capture path accepts: 8 kHz up to the
+    converter's 1 Msps.
+*/
+#define CAPTURE_RATE_MIN 8000
+#define CAPTURE_RATE_MAX 1000000
+
+typedef enum
+{
+    CAPTURE_OK,
+    CAPTURE_RATE_UNSUPPORTED,
+    CAPTURE_THROUGHPUT_EXCEEDED
+
+}   Capture_status;
+
+Capture_status capture_configure(uint32_t rate, Wave_info *info);
+
+uint32_t capture_period(void);
+
+void capture_measure(uint32_t bytes, uint32_t microsecond);
+
+uint32_t capture_throughput(void);
+
+#endif /* CAPTURE_H_ */
@@ -0,0 +1,34 @@
+#ifndef CATALOG_H_
+#define CATALOG_H_
+
+#include <stdint.h>
+#include "ff.h"
+
+/*
+    Recordings are numbered R0000001.WAV onwards and kept in date
+    buckets off the root, YYYYMMDD.NNN, each holding at most
+    CATALOG_BUCKET_FILES of them, so creating a file only ever searches
+    a short directory. The date is get_fattime()'s when the catalog is
+    built; NNN counts the buckets of that day.
+
+    catalog_build() walks the buckets once after mount and sets a bit
+    per recording's short name in a hash of CATALOG_HASH_BITS.
+    catalog_create() numbers on from the recordings found, skipping
+    names whose bit is set, without a lookup on the card; a false
+    positive only skips a number.
+*/
+#define CATALOG_BUCKET_FILES 64
+#define CATALOG_HASH_BITS    16384
+#define CATALOG_PATH         26
+
+FRESULT catalog_build(void);
+
+FRESULT catalog_create(FIL *file);
+
+const TCHAR *catalog_latest(void);
+
+uint32_t catalog_count(void);
+
+uint32_t catalog_buckets(void);
+
+#endif /* CATALOG_H_ */
@@ -0,0 +1,27 @@
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <stdint.h>
+
+/*
+    Power spectrum of FFT_SAMPLES real 16-bit samples in fixed point.
+    The samples are taken in pairs as FFT_SAMPLES / 2 complex points,
+    transformed by a radix-4 FFT on the Cortex-M4's halving dual 16-bit
+    instructions, and split into the real signal's FFT_BINS bins. Every
+    stage halves twice, so the result is scaled by 1 / FFT_SAMPLES and
+    cannot overflow.
+*/
+#define FFT_SAMPLES 512
+#define FFT_BINS    (FFT_SAMPLES / 2)
+
+/*
+    Applies a Hann window and replaces the frame's samples with the
+    power |X[k]|^2 of bins 0 to FFT_BINS - 1 (DC to just short of half
+    the sample rate), a uint32_t each, bin k at word fft_index(k). The
+    frame must be word-aligned.
+*/
+void fft_power(void *frame);
+
+uint32_t fft_index(uint32_t bin);
+
+#endif /* FFT_H_ */
@@ -0,0 +1,54 @@
+#ifndef PLAYER_H_
+#define PLAYER_H_
+
+#include <stdint.h>
+#include "wave.h"
+
+/*
+    Playback through Timer1A in PWM mode on PB4 (T1CCP0): the PWM
+    period is the sample period, and each period's duty cycle is loaded
+    from the file on the rising edge before it. An RC low-pass on the
+    pin recovers the audio.
+
+    8-bit unsigned, 16 and 24-bit signed PCM and 32-bit float, mono or
+    stereo; a stereo file plays its first channel, and the PWM takes the
+    top 16 bits of any sample wider than that.
+*/
+#define PLAYER_RATE_MIN 8000
+#define PLAYER_RATE_MAX 48000
+
+typedef enum
+{
+    PLAYER_OK,
+    PLAYER_RATE_UNSUPPORTED,
+    PLAYER_FORMAT_UNSUPPORTED
+
+}   Player_status;
+
+Player_status player_configure(const Wave_info *info);
+
+uint32_t player_period(void);
+
+uint32_t player_frame(void);
+
+/*
+    Bytes to read into a buffer of size bytes: whole frames ending on a
+    sector boundary, so every read after a recording's header stays
+    sector aligned: 3072 bytes of a 4096-byte block for a 3 or 6-byte
+    frame.
+*/
+uint32_t player_fill(uint32_t size);
+
+/*
+    First channel of the frame at frame, as a 16-bit sample.
+*/
+int16_t player_sample(const volatile uint8_t *frame);
+
+/*
+    Match register value that puts a sample on the output: the counter
+    falls from the period to zero and the output is high until it
+    reaches the match.
+*/
+uint32_t player_match(int16_t sample);
+
+#endif /* PLAYER_H_ */
@@ -0,0 +1,74 @@
+#ifndef SAMPLE_H_
+#define SAMPLE_H_
+
+#include <stdint.h>
+
+/*
+    Format of the samples written to the card, fixed when building with
+    SAMPLE_FORMAT=8, 16, 24 or 32:
+
+        8   unsigned, the top 8 of the bits in use offset by 128
+        16  signed, the bits in use at the top
+        24  signed in 3 bytes, the bits in use at the top
+        32  IEEE float, the bits in use scaled to +-1.0
+
+    Every format brings the SAMPLE_INPUT_BITS in use to its full scale,
+    saturating anything beyond them.
+
+    Capture, the gain stage and the summaries work on 16-bit samples; a
+    block is packed just before it goes to the card, in place, so a pool
+    block has room for BLOCKPOOL_BLOCK_SAMPLES of the wider formats.
+*/
+#ifndef SAMPLE_FORMAT
+#define SAMPLE_FORMAT 16
+#endif
+
+#if SAMPLE_FORMAT == 8
+#define SAMPLE_BYTES 1
+#elif SAMPLE_FORMAT == 16
+#define SAMPLE_BYTES 2
+#elif SAMPLE_FORMAT == 24
+#define SAMPLE_BYTES 3
+#elif SAMPLE_FORMAT == 32
+#define SAMPLE_BYTES 4
+#else
+#error "SAMPLE_FORMAT is 8, 16, 24 or 32"
+#endif
+
+#define SAMPLE_BITS (8 * SAMPLE_BYTES)
+
+/*
+    WAVE_FORMAT_PCM, or WAVE_FORMAT_IEEE_FLOAT for 32.
+*/
+#define SAMPLE_WAVE_FORMAT (SAMPLE_FORMAT == 32 ? 3 : 1)
+
+/*
+    Room a 16-bit block needs to be packed in place.
+*/
+#define SAMPLE_ROOM (SAMPLE_BYTES > 2 ? SAMPLE_BYTES : 2)
+
+/*
+    Bits a captured sample spans: a 12-bit conversion less the DC bias,
+    which sits below mid-scale, so the top of the range can reach past
+    2047. The gain stage brings samples up to the full 16.
+*/
+#define SAMPLE_CAPTURE_BITS 12
+
+/*
+    Bits the samples span when they are packed, fixed by the build: the
+    gain stage runs in every recording of a build with AGC and none
+    without.
+*/
+#ifdef AGC
+#define SAMPLE_INPUT_BITS 16
+#else
+#define SAMPLE_INPUT_BITS SAMPLE_CAPTURE_BITS
+#endif
+
+/*
+    Turns count 16-bit samples spanning SAMPLE_INPUT_BITS signed bits
+    into the built format in place and returns their size in bytes.
+*/
+uint32_t sample_pack(void *samples, uint32_t count);
+
+#endif /* SAMPLE_H_ */
@@ -0,0 +1,137 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "agc.h"
+#include "sidecar.h"
+#include "simd.h"
+#include "ff.h"
+
+static Agc_config settings;
+static bool enabled;
+
+/*
+    Share of the way to the sought gain covered per block, 16.16.
+*/
+static uint32_t attack;
+static uint32_t release;
+static uint32_t gain = AGC_UNITY;
+static uint32_t records;
+static Sidecar sidecar = { .status = FR_NO_FILE };
+
+void agc_configure(const Agc_config *config)
+{
+    enabled = config != NULL;
+    if (config)
+    {
+        /*
+            In 16.16 the gain stays below 2^31, for the signed multiply.
+        */
+        settings = *config;
+        settings.max_gain = settings.max_gain < INT16_MAX ? settings.max_gain : INT16_MAX;
+    }
+}
+
+bool agc_enabled(void)
+{
+    return enabled;
+}
+
+/*
+    1 - e^(-t / tau) for a block of t, taken as t / (t + tau).
+*/
+static uint32_t coefficient(uint32_t block_samples, uint32_t rate, uint32_t ms)
+{
+    uint64_t tau = (uint64_t)ms * rate / 1000;
+    return (uint32_t)(((uint64_t)block_samples << 16) / (block_samples + tau));
+}
+
+FRESULT agc_open(const TCHAR *wave, const Wave_info *info, uint32_t block_samples)
+{
+    gain = AGC_UNITY;
+    records = 0;
+    attack = coefficient(block_samples, info->sample_rate, settings.attack_ms);
+    release = coefficient(block_samples, info->sample_rate, settings.release_ms);
+    uint8_t header[AGC_HEADER];
+    memcpy(header, "AGC1", 4);
+    sidecar_put_uint32(header + 4, info->sample_rate);
+    sidecar_put_uint16(header + 8, block_samples);
+    sidecar_put_uint16(header + 10, AGC_RECORD);
+    sidecar_put_uint32(header + 12, 0);
+    return sidecar_open(&sidecar, wave, "AGC", header, sizeof header);
+}
+
+static uint32_t peak(const int16_t *sample, uint32_t count)
+{
+    uint32_t highest = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t value = (uint32_t)(sample[i] < 0 ? -sample[i] : sample[i]);
+        if (value > highest)
+        {
+            highest = value;
+        }
+    }
+    return highest;
+}
+
+void agc_apply(void *samples, uint32_t bytes)
+{
+    uint32_t count = bytes / 2;
+    if (!count)
+    {
+        return;
+    }
+    /*
+        The gains the block's peak allows and asks for.
+    */
+    uint32_t highest = peak(samples, count);
+    uint32_t most = (uint32_t)settings.max_gain << 16;
+    uint32_t limit = highest ? ((uint32_t)INT16_MAX << 16) / highest : most;
+    uint32_t sought = highest ? ((uint32_t)settings.target << 16) / highest : most;
+    limit = limit < most ? limit : most;
+    sought = sought < limit ? sought : limit;
+    uint32_t start = gain < limit ? gain : limit;
+    uint32_t end = sought < start ?
+        start - (uint32_t)((uint64_t)(start - sought) * attack >> 16) :
+        start + (uint32_t)((uint64_t)(sought - start) * release >> 16);
+    int32_t step = ((int32_t)end - (int32_t)start) / (int32_t)count;
+    end = start + (uint32_t)(step * (int32_t)count);
+    /*
+        Two samples a word: a 32 x 16-bit multiply for each half and a
+        saturation back to 16 bits.
+    */
+    uint32_t *pair = samples;
+    int32_t g = (int32_t)start;
+    for (uint32_t i = 0; i < count / 2; i++)
+    {
+        uint32_t x = pair[i];
+        int32_t lo = simd_smulwb(g, x);
+        g += step;
+        int32_t hi = simd_smulwt(g, x);
+        g += step;
+        pair[i] = simd_pack(simd_ssat16(lo), simd_ssat16(hi));
+    }
+    if (count & 1)
+    {
+        int16_t *last = (int16_t *)samples + count - 1;
+        *last = (int16_t)simd_ssat16((int32_t)((int64_t)g * *last >> 16));
+    }
+    gain = end;
+    uint8_t record[AGC_RECORD];
+    sidecar_put_uint32(record, start);
+    sidecar_put_uint32(record + 4, end);
+    if (sidecar_write(&sidecar, record, sizeof record) == FR_OK)
+    {
+        records++;
+    }
+}
+
+FRESULT agc_close(void)
+{
+    return sidecar_close(&sidecar, 12, records);
+}
+
+uint32_t agc_gain(void)
+{
+    return gain;
+}
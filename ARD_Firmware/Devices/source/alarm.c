@@ -0,0 +1,96 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "mempool.h"
+#include "systick.h"
+#include "alarm.h"
+
+struct Alarm
+{
+    Alarm *next;
+    uint32_t deadline;
+    void (*callback)(void);
+    bool active;
+};
+
+/*
+    Pending alarms, soonest first. Only the main loop touches the list,
+    so it needs no masking.
+*/
+static Alarm *head;
+
+uint32_t alarm_now(void)
+{
+    return systick_ticks();
+}
+
+bool alarm_expired(uint32_t deadline)
+{
+    /*
+        Signed difference, so a deadline past the 32-bit wrap compares
+        correctly for up to 24 days either side.
+    */
+    return (int32_t)(alarm_now() - deadline) >= 0;
+}
+
+Alarm *alarm_create(void (*callback)(void))
+{
+    Alarm *alarm = mempool_allocate(sizeof(Alarm));
+    alarm->next = NULL;
+    alarm->deadline = 0;
+    alarm->callback = callback;
+    alarm->active = false;
+    return alarm;
+}
+
+void alarm_start(Alarm *alarm, uint32_t millisecond)
+{
+    alarm_stop(alarm);
+    alarm->deadline = alarm_now() + millisecond;
+    /*
+        After any alarm due at the same time, so equal deadlines run in
+        the order they were started.
+    */
+    Alarm **link = &head;
+    while (*link && (int32_t)((*link)->deadline - alarm->deadline) <= 0)
+    {
+        link = &(*link)->next;
+    }
+    alarm->next = *link;
+    *link = alarm;
+    alarm->active = true;
+}
+
+void alarm_stop(Alarm *alarm)
+{
+    if (!alarm->active)
+    {
+        return;
+    }
+    Alarm **link = &head;
+    while (*link != alarm)
+    {
+        link = &(*link)->next;
+    }
+    *link = alarm->next;
+    alarm->active = false;
+}
+
+bool alarm_active(Alarm *alarm)
+{
+    return alarm->active;
+}
+
+void alarm_dispatch(void)
+{
+    /*
+        A callback may start its own alarm again; it goes back into the
+        list behind anything else already due.
+    */
+    while (head && alarm_expired(head->deadline))
+    {
+        Alarm *alarm = head;
+        head = alarm->next;
+        alarm->active = false;
+        alarm->callback();
+    }
+}
@@ -0,0 +1,211 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "blockpool.h"
+#include "diskio.h"
+#include "dwt.h"
+#include "sysctl.h"
+#include "bench.h"
+
+static uint32_t elapsed(uint32_t start)
+{
+    return (dwt_cycles() - start) / (sysctl_get_clock() / 1000000);
+}
+
+/*
+    Insertion sort: at most a pool block of samples, once per test.
+*/
+static void summarise(uint32_t *sample, uint32_t count, Bench_latency *latency)
+{
+    for (uint32_t i = 1; i < count; i++)
+    {
+        uint32_t value = sample[i];
+        uint32_t j = i;
+        for (; j && sample[j - 1] > value; j--)
+        {
+            sample[j] = sample[j - 1];
+        }
+        sample[j] = value;
+    }
+    latency->p50 = sample[count * 50 / 100];
+    latency->p90 = sample[count * 90 / 100];
+    latency->p99 = sample[count * 99 / 100];
+    latency->max = sample[count - 1];
+}
+
+/*
+    BENCH_SAMPLES raw transfers of count sectors each, walking forward
+    from the first sector of the stream. After each write the card's
+    busy time is taken with CTRL_SYNC and, for single sectors, kept in
+    the second half of the samples.
+*/
+static FRESULT transfer(BYTE *block, DWORD sector, BYTE count, bool write, uint32_t *sample, Bench_latency *latency, Bench_latency *busy)
+{
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++)
+    {
+        uint32_t start = dwt_cycles();
+        DRESULT res = write ? disk_write(0, block, sector + i * count, count) : disk_read(0, block, sector + i * count, count);
+        sample[i] = elapsed(start);
+        if (res == RES_OK && write)
+        {
+            start = dwt_cycles();
+            res = disk_ioctl(0, CTRL_SYNC, NULL);
+            sample[BENCH_SAMPLES + i] = elapsed(start);
+        }
+        if (res != RES_OK)
+        {
+            return FR_DISK_ERR;
+        }
+    }
+    summarise(sample, BENCH_SAMPLES, latency);
+    if (busy)
+    {
+        summarise(sample + BENCH_SAMPLES, BENCH_SAMPLES, busy);
+    }
+    return FR_OK;
+}
+
+FRESULT bench_run(FIL *file, const TCHAR *path, uint32_t size, Bench_result *result)
+{
+    size -= size % BLOCKPOOL_BLOCK_SIZE;
+    if (size < BENCH_SIZE_MIN || size > BENCH_SIZE_MAX)
+    {
+        return FR_INVALID_PARAMETER;
+    }
+    BYTE *block = blockpool_acquire();
+    uint32_t *sample = blockpool_acquire();
+    FRESULT status = block && sample ? f_open(file, path, FA_CREATE_ALWAYS|FA_WRITE) : FR_NOT_ENOUGH_CORE;
+    if (status == FR_OK)
+    {
+        for (uint32_t i = 0; i < BLOCKPOOL_BLOCK_SIZE; i++)
+        {
+            block[i] = (BYTE)i;
+        }
+        /*
+            One contiguous, pre-erased run, as a recording gets, so the
+            raw tests can address the stream's sectors directly.
+        */
+        DWORD au;
+        if (disk_ioctl(0, GET_BLOCK_SIZE, &au) != RES_OK)
+        {
+            au = 1;
+        }
+        status = f_reserve(file, size, au, NULL);
+    }
+    if (status == FR_OK)
+    {
+        uint32_t count = size / BLOCKPOOL_BLOCK_SIZE;
+        uint64_t total = 0;
+        for (uint32_t i = 0; status == FR_OK && i < count; i++)
+        {
+            UINT bytes_written;
+            uint32_t start = dwt_cycles();
+            status = f_write(file, block, BLOCKPOOL_BLOCK_SIZE, &bytes_written);
+            sample[i] = elapsed(start);
+            total += sample[i];
+            if (status == FR_OK && bytes_written != BLOCKPOOL_BLOCK_SIZE)
+            {
+                status = FR_DENIED;
+            }
+        }
+        if (status == FR_OK)
+        {
+            status = f_sync(file);
+        }
+        if (status == FR_OK)
+        {
+            result->size = size;
+            result->write_rate = total ? (uint32_t)((uint64_t)size * 1000000 / total) : 0;
+            summarise(sample, count, &result->stream);
+        }
+    }
+    if (status == FR_OK)
+    {
+        DWORD sector = file->fs->database + (file->sclust - 2) * file->fs->csize;
+        status = transfer(block, sector, 1, true, sample, &result->write_single, &result->busy);
+        if (status == FR_OK)
+        {
+            status = transfer(block, sector, BENCH_MULTI, true, sample, &result->write_multi, NULL);
+        }
+        if (status == FR_OK)
+        {
+            status = transfer(block, sector, 1, false, sample, &result->read_single, NULL);
+        }
+        if (status == FR_OK)
+        {
+            status = transfer(block, sector, BENCH_MULTI, false, sample, &result->read_multi, NULL);
+        }
+    }
+    if (block && sample)
+    {
+        FRESULT closed = f_close(file);
+        if (closed == FR_OK)
+        {
+            closed = f_unlink(path);
+        }
+        if (status == FR_OK)
+        {
+            status = closed;
+        }
+    }
+    if (block)
+    {
+        blockpool_release(block);
+    }
+    if (sample)
+    {
+        blockpool_release(sample);
+    }
+    return status;
+}
+
+static uint32_t byte_rate(const Wave_info *info)
+{
+    return info->sample_rate * info->num_channels * info->bits_per_sample / 8;
+}
+
+/*
+    Microseconds of samples the pool holds besides the block being
+    written.
+*/
+static uint32_t cover(const Wave_info *info, uint32_t blocks)
+{
+    return (uint32_t)((uint64_t)(blocks - 1) * BLOCKPOOL_BLOCK_SIZE * 1000000 / byte_rate(info));
+}
+
+bool bench_qualifies(const Bench_result *result, const Wave_info *info, uint32_t blocks)
+{
+    return result->write_rate >= byte_rate(info) && result->stream.max < cover(info, blocks);
+}
+
+static void row(FIL *file, const char *name, const Bench_latency *latency)
+{
+    f_printf(file, "%-16s%8lu%8lu%8lu%8lu\n", name,
+        (unsigned long)latency->p50, (unsigned long)latency->p90,
+        (unsigned long)latency->p99, (unsigned long)latency->max);
+}
+
+FRESULT bench_report(FIL *file, const TCHAR *path, const Bench_result *result, const Wave_info *info, uint32_t blocks)
+{
+    FRESULT status = f_open(file, path, FA_CREATE_ALWAYS|FA_WRITE);
+    if (status != FR_OK)
+    {
+        return status;
+    }
+    f_printf(file, "test size       %lu KiB\n", (unsigned long)(result->size / 1024));
+    f_printf(file, "block size      %lu bytes\n", (unsigned long)BLOCKPOOL_BLOCK_SIZE);
+    f_printf(file, "f_write stream  %lu bytes/s\n", (unsigned long)result->write_rate);
+    f_printf(file, "\nlatency us          p50     p90     p99     max\n");
+    row(file, "f_write block", &result->stream);
+    row(file, "write 1", &result->write_single);
+    row(file, "write 8", &result->write_multi);
+    row(file, "read 1", &result->read_single);
+    row(file, "read 8", &result->read_multi);
+    row(file, "busy after 1", &result->busy);
+    f_printf(file, "\n%lu Hz x %u x %u bit needs %lu bytes/s, %lu blocks cover %lu ms: %s\n",
+        (unsigned long)info->sample_rate, info->num_channels, info->bits_per_sample,
+        (unsigned long)byte_rate(info), (unsigned long)blocks,
+        (unsigned long)(cover(info, blocks) / 1000),
+        bench_qualifies(result, info, blocks) ? "PASS" : "FAIL");
+    return f_close(file);
+}
@@ -0,0 +1,111 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "blockpool.h"
+#include "nvic.h"
+
+/*
+    Provided by linker.lds.
+*/
+extern uint8_t __blockpool_start__[];
+extern uint8_t __blockpool_end__[];
+
+/*
+    Free blocks are chained through their first word.
+*/
+struct Free
+{
+    struct Free *next;
+};
+
+static struct Pool
+{
+    struct Free *free;
+    uint32_t count;
+    uint32_t available;
+    uint32_t low;
+    void *volatile ready[BLOCKPOOL_BLOCKS_MAX];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+
+}   pool;
+
+void blockpool_init(void)
+{
+    uintptr_t start = ((uintptr_t)__blockpool_start__ + 511) & ~(uintptr_t)511;
+    uintptr_t end = (uintptr_t)__blockpool_end__;
+    pool.free = NULL;
+    pool.count = 0;
+    pool.head = 0;
+    pool.tail = 0;
+    while (start + BLOCKPOOL_BLOCK_SIZE <= end && pool.count < BLOCKPOOL_BLOCKS_MAX)
+    {
+        blockpool_release((void *)start);
+        start += BLOCKPOOL_BLOCK_SIZE;
+        pool.count++;
+    }
+    pool.available = pool.count;
+    pool.low = pool.count;
+}
+
+RAMFUNC void *blockpool_acquire(void)
+{
+    uint32_t state = nvic_mask_all();
+    struct Free *block = pool.free;
+    if (block)
+    {
+        pool.free = block->next;
+        pool.available--;
+        if (pool.available < pool.low)
+        {
+            pool.low = pool.available;
+        }
+    }
+    nvic_unmask_all(state);
+    return block;
+}
+
+RAMFUNC void blockpool_release(void *block)
+{
+    uint32_t state = nvic_mask_all();
+    struct Free *free = block;
+    free->next = pool.free;
+    pool.free = free;
+    pool.available++;
+    nvic_unmask_all(state);
+}
+
+RAMFUNC void blockpool_submit(void *block)
+{
+    /*
+        Never full: a block is either free, being filled or queued here,
+        and the queue holds every block the pool has.
+    */
+    pool.ready[pool.head % BLOCKPOOL_BLOCKS_MAX] = block;
+    pool.head++;
+}
+
+void *blockpool_next(void)
+{
+    if (pool.tail == pool.head)
+    {
+        return NULL;
+    }
+    void *block = pool.ready[pool.tail % BLOCKPOOL_BLOCKS_MAX];
+    pool.tail++;
+    return block;
+}
+
+uint32_t blockpool_count(void)
+{
+    return pool.count;
+}
+
+uint32_t blockpool_available(void)
+{
+    return pool.available;
+}
+
+uint32_t blockpool_low(void)
+{
+    return pool.low;
+}
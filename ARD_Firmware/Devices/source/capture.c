@@ -0,0 +1,67 @@
+#include <stdint.h>
+#include "capture.h"
+#include "sample.h"
+#include "sysctl.h"
+#include "timer.h"
+
+/*
+    Sustained card throughput assumed until writes have been timed: the
+    40 kHz mono stream the recorder was validated at, in the sample
+    format it is built for, so an instant-on start is not refused for
+    want of a calibration.
+*/
+#define CAPTURE_THROUGHPUT_DEFAULT (40000UL * SAMPLE_BYTES)
+
+static struct Measure
+{
+    uint64_t bytes;
+    uint64_t microsecond;
+
+}   measure;
+
+static uint32_t period;
+
+Capture_status capture_configure(uint32_t rate, Wave_info *info)
+{
+    if (rate < CAPTURE_RATE_MIN || rate > CAPTURE_RATE_MAX)
+    {
+        return CAPTURE_RATE_UNSUPPORTED;
+    }
+    /*
+        Timer0 fires every CPU_FREQ/TIMER_FREQ cycles; the period is
+        rounded to the nearest cycle and the rate it gives is what goes
+        into the header.
+    */
+    uint32_t clock = sysctl_get_clock();
+    uint32_t cycles = (clock + rate / 2) / rate;
+    uint32_t achieved = (clock + cycles / 2) / cycles;
+    uint32_t byte_rate = achieved * info->num_channels * info->bits_per_sample / 8;
+    if (byte_rate > capture_throughput())
+    {
+        return CAPTURE_THROUGHPUT_EXCEEDED;
+    }
+    period = cycles;
+    timer_set_load(timer_address(TIMER_MOD0), TIMER_A, period - 1);
+    info->sample_rate = achieved;
+    return CAPTURE_OK;
+}
+
+uint32_t capture_period(void)
+{
+    return period;
+}
+
+void capture_measure(uint32_t bytes, uint32_t microsecond)
+{
+    measure.bytes += bytes;
+    measure.microsecond += microsecond;
+}
+
+uint32_t capture_throughput(void)
+{
+    if (!measure.microsecond)
+    {
+        return CAPTURE_THROUGHPUT_DEFAULT;
+    }
+    return (uint32_t)(measure.bytes * 1000000 / measure.microsecond);
+}
@@ -0,0 +1,238 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "catalog.h"
+
+#define NUMBER_DIGITS 7
+#define NUMBER_MAX    9999999UL
+#define BUCKET_MAX    999
+#define BUCKET_NAME   12
+
+static uint32_t hash[CATALOG_HASH_BITS / 32];
+static uint32_t count;
+static uint32_t buckets;
+
+/*
+    Today's newest bucket and how many recordings it holds; a new one is
+    made when there is none yet or it is full.
+*/
+static uint32_t today;
+static uint32_t bucket;
+static uint32_t bucket_files;
+static bool bucket_found;
+
+static uint32_t latest_number;
+static TCHAR latest[CATALOG_PATH];
+
+static void put_digits(TCHAR *p, uint32_t value, uint8_t digits)
+{
+    while (digits--)
+    {
+        p[digits] = (TCHAR)('0' + value % 10);
+        value /= 10;
+    }
+}
+
+static bool get_digits(const TCHAR *p, uint8_t digits, uint32_t *value)
+{
+    *value = 0;
+    for (uint8_t i = 0; i < digits; i++)
+    {
+        if (p[i] < '0' || p[i] > '9')
+        {
+            return false;
+        }
+        *value = *value * 10 + (uint32_t)(p[i] - '0');
+    }
+    return true;
+}
+
+static void bucket_name(TCHAR *p, uint32_t date, uint32_t number)
+{
+    put_digits(p, date, 8);
+    p[8] = '.';
+    put_digits(p + 9, number, 3);
+    p[BUCKET_NAME] = 0;
+}
+
+static bool parse_bucket(const TCHAR *name, uint32_t *date, uint32_t *number)
+{
+    return get_digits(name, 8, date) && name[8] == '.' && get_digits(name + 9, 3, number) && !name[BUCKET_NAME];
+}
+
+static void recording_name(TCHAR *p, uint32_t number)
+{
+    p[0] = 'R';
+    put_digits(p + 1, number, NUMBER_DIGITS);
+    memcpy(p + 1 + NUMBER_DIGITS, ".WAV", 5);
+}
+
+static bool parse_recording(const TCHAR *name, uint32_t *number)
+{
+    return name[0] == 'R' && get_digits(name + 1, NUMBER_DIGITS, number) && !memcmp(name + 1 + NUMBER_DIGITS, ".WAV", 5);
+}
+
+/*
+    FNV-1a over the short name, folded to a bit of the hash.
+*/
+static uint32_t slot(const TCHAR *name)
+{
+    uint32_t h = 2166136261UL;
+    while (*name)
+    {
+        h = (h ^ (uint8_t)*name++) * 16777619UL;
+    }
+    return h % CATALOG_HASH_BITS;
+}
+
+static void mark(const TCHAR *name)
+{
+    uint32_t s = slot(name);
+    hash[s / 32] |= 1UL << (s % 32);
+}
+
+static bool marked(const TCHAR *name)
+{
+    uint32_t s = slot(name);
+    return hash[s / 32] & (1UL << (s % 32));
+}
+
+static uint32_t fat_date(void)
+{
+    DWORD time = get_fattime();
+    return ((time >> 25) + 1980) * 10000 + (time >> 21 & 0x0F) * 100 + (time >> 16 & 0x1F);
+}
+
+/*
+    Marks and counts one bucket's recordings, keeping the highest
+    numbered as the one to play back.
+*/
+static FRESULT walk_bucket(const TCHAR *name, uint32_t *files)
+{
+    DIR dir;
+    FILINFO entry;
+    FRESULT result = f_opendir(&dir, name);
+    *files = 0;
+    while (result == FR_OK && (result = f_readdir(&dir, &entry)) == FR_OK && entry.fname[0])
+    {
+        uint32_t number;
+        if (!(entry.fattrib & AM_DIR) && parse_recording(entry.fname, &number))
+        {
+            mark(entry.fname);
+            (*files)++;
+            if (number > latest_number)
+            {
+                latest_number = number;
+                memcpy(latest, name, BUCKET_NAME);
+                latest[BUCKET_NAME] = '/';
+                recording_name(latest + BUCKET_NAME + 1, number);
+            }
+        }
+    }
+    return result;
+}
+
+FRESULT catalog_build(void)
+{
+    DIR dir;
+    FILINFO entry;
+    memset(hash, 0, sizeof hash);
+    count = 0;
+    buckets = 0;
+    latest_number = 0;
+    today = fat_date();
+    bucket_found = false;
+    FRESULT result = f_opendir(&dir, "");
+    while (result == FR_OK && (result = f_readdir(&dir, &entry)) == FR_OK && entry.fname[0])
+    {
+        uint32_t date;
+        uint32_t number;
+        uint32_t files;
+        if (!(entry.fattrib & AM_DIR) || !parse_bucket(entry.fname, &date, &number))
+        {
+            continue;
+        }
+        result = walk_bucket(entry.fname, &files);
+        count += files;
+        buckets++;
+        if (date == today && (!bucket_found || number > bucket))
+        {
+            bucket = number;
+            bucket_files = files;
+            bucket_found = true;
+        }
+    }
+    return result;
+}
+
+/*
+    Creates and opens the next recording. FatFs checks the name only
+    against the bucket it goes in; the hash keeps it unique across the
+    card.
+*/
+FRESULT catalog_create(FIL *file)
+{
+    TCHAR path[CATALOG_PATH];
+    FRESULT result;
+    if (!bucket_found || bucket_files >= CATALOG_BUCKET_FILES)
+    {
+        uint32_t next = bucket_found ? bucket + 1 : 0;
+        if (next > BUCKET_MAX)
+        {
+            return FR_DENIED;
+        }
+        bucket_name(path, today, next);
+        result = f_mkdir(path);
+        if (result != FR_OK)
+        {
+            return result;
+        }
+        bucket = next;
+        bucket_files = 0;
+        bucket_found = true;
+        buckets++;
+    }
+    bucket_name(path, today, bucket);
+    path[BUCKET_NAME] = '/';
+    TCHAR *name = path + BUCKET_NAME + 1;
+    for (uint32_t number = count + 1; number <= NUMBER_MAX; number++)
+    {
+        recording_name(name, number);
+        if (marked(name))
+        {
+            continue;
+        }
+        result = f_open(file, path, FA_CREATE_NEW|FA_WRITE);
+        if (result == FR_EXIST)
+        {
+            mark(name);
+            continue;
+        }
+        if (result == FR_OK)
+        {
+            mark(name);
+            count++;
+            bucket_files++;
+            latest_number = number;
+            memcpy(latest, path, CATALOG_PATH);
+        }
+        return result;
+    }
+    return FR_DENIED;
+}
+
+const TCHAR *catalog_latest(void)
+{
+    return latest_number ? latest : NULL;
+}
+
+uint32_t catalog_count(void)
+{
+    return count;
+}
+
+uint32_t catalog_buckets(void)
+{
+    return buckets;
+}
@@ -0,0 +1,166 @@
+#include <stdint.h>
+#include "fft.h"
+#include "simd.h"
+
+#define POINTS (FFT_SAMPLES / 2)
+
+/*
+    sin(2 pi k / FFT_SAMPLES) in Q15 for the first quarter turn; the
+    rest of the circle follows by symmetry.
+*/
+static const int16_t sine[FFT_SAMPLES / 4 + 1] =
+{
+    0, 402, 804, 1206, 1608, 2009, 2410, 2811,
+    3212, 3612, 4011, 4410, 4808, 5205, 5602, 5998,
+    6393, 6786, 7179, 7571, 7962, 8351, 8739, 9126,
+    9512, 9896, 10278, 10659, 11039, 11417, 11793, 12167,
+    12539, 12910, 13279, 13645, 14010, 14372, 14732, 15090,
+    15446, 15800, 16151, 16499, 16846, 17189, 17530, 17869,
+    18204, 18537, 18868, 19195, 19519, 19841, 20159, 20475,
+    20787, 21096, 21403, 21705, 22005, 22301, 22594, 22884,
+    23170, 23452, 23731, 24007, 24279, 24547, 24811, 25072,
+    25329, 25582, 25832, 26077, 26319, 26556, 26790, 27019,
+    27245, 27466, 27683, 27896, 28105, 28310, 28510, 28706,
+    28898, 29085, 29268, 29447, 29621, 29791, 29956, 30117,
+    30273, 30424, 30571, 30714, 30852, 30985, 31113, 31237,
+    31356, 31470, 31580, 31685, 31785, 31880, 31971, 32057,
+    32137, 32213, 32285, 32351, 32412, 32469, 32521, 32567,
+    32609, 32646, 32678, 32705, 32728, 32745, 32757, 32765,
+    32767
+};
+
+/*
+    e^(-2 pi j k / FFT_SAMPLES) packed as (cos, -sin).
+*/
+static uint32_t twiddle(uint32_t k)
+{
+    int32_t s = sine[k % (FFT_SAMPLES / 4)];
+    int32_t c = sine[FFT_SAMPLES / 4 - k % (FFT_SAMPLES / 4)];
+    switch (k / (FFT_SAMPLES / 4) % 4)
+    {
+    case 0:  return simd_pack(c, -s);
+    case 1:  return simd_pack(-s, -c);
+    case 2:  return simd_pack(-c, s);
+    default: return simd_pack(s, c);
+    }
+}
+
+/*
+    x * w, with w from twiddle().
+*/
+static uint32_t rotate(uint32_t x, uint32_t w)
+{
+    return simd_pack(simd_smusd(x, w) >> 15, simd_smuadx(x, w) >> 15);
+}
+
+/*
+    Reverses the base-4 digits of a point's index.
+*/
+uint32_t fft_index(uint32_t bin)
+{
+    uint32_t index = 0;
+    for (uint32_t n = POINTS; n > 1; n /= 4)
+    {
+        index = index << 2 | (bin & 3);
+        bin >>= 2;
+    }
+    return index;
+}
+
+/*
+    Periodic Hann window, (1 - cos) / 2, with the samples halved so
+    that no complex point exceeds 2^14 * sqrt(2) in magnitude.
+*/
+static void window(uint32_t *x)
+{
+    const int16_t *sample = (const int16_t *)x;
+    for (uint32_t n = 0; n < POINTS; n++)
+    {
+        int32_t even = (32768 - simd_lo(twiddle(2 * n))) >> 1;
+        int32_t odd = (32768 - simd_lo(twiddle(2 * n + 1))) >> 1;
+        int32_t re = sample[2 * n] * even >> 16;
+        int32_t im = sample[2 * n + 1] * odd >> 16;
+        x[n] = simd_pack(re, im);
+    }
+}
+
+/*
+    Decimation in frequency: each butterfly takes four points a quarter
+    span apart and leaves their 4-point DFT, each output but the first
+    turned by its twiddle. The output comes out in base-4 digit-reversed
+    order.
+*/
+static void radix4(uint32_t *x)
+{
+    for (uint32_t span = POINTS; span >= 4; span /= 4)
+    {
+        uint32_t quarter = span / 4;
+        uint32_t step = FFT_SAMPLES / span;
+        for (uint32_t j = 0; j < quarter; j++)
+        {
+            uint32_t w1 = twiddle(j * step);
+            uint32_t w2 = twiddle(2 * j * step);
+            uint32_t w3 = twiddle(3 * j * step);
+            for (uint32_t i = j; i < POINTS; i += span)
+            {
+                uint32_t *p = x + i;
+                uint32_t t0 = simd_shadd16(p[0], p[2 * quarter]);
+                uint32_t t1 = simd_shsub16(p[0], p[2 * quarter]);
+                uint32_t t2 = simd_shadd16(p[quarter], p[3 * quarter]);
+                uint32_t t3 = simd_shsub16(p[quarter], p[3 * quarter]);
+                p[0] = simd_shadd16(t0, t2);
+                if (j)
+                {
+                    p[quarter] = rotate(simd_shsax(t1, t3), w1);
+                    p[2 * quarter] = rotate(simd_shsub16(t0, t2), w2);
+                    p[3 * quarter] = rotate(simd_shasx(t1, t3), w3);
+                }
+                else
+                {
+                    p[quarter] = simd_shsax(t1, t3);
+                    p[2 * quarter] = simd_shsub16(t0, t2);
+                    p[3 * quarter] = simd_shasx(t1, t3);
+                }
+            }
+        }
+    }
+}
+
+static uint32_t power(int32_t re, int32_t im)
+{
+    return (uint32_t)(re * re) + (uint32_t)(im * im);
+}
+
+/*
+    Splits Z, the transform of the samples taken as complex pairs, into
+    the real signal's bins: X[k] = E[k] + W^k O[k], where E and O, the
+    transforms of the even and odd samples, come from Z[k] and Z[N - k].
+    Bins k and N - k share their inputs, so both are done at once and
+    the power of each lands in the word its input came from.
+*/
+static void split(uint32_t *x)
+{
+    int32_t dc = simd_lo(x[0]) + simd_hi(x[0]);
+    x[0] = power(dc, 0);
+    for (uint32_t k = 1; k <= POINTS / 2; k++)
+    {
+        uint32_t *zk = x + fft_index(k);
+        uint32_t *zm = x + fft_index(POINTS - k);
+        int32_t e_re = (simd_lo(*zk) + simd_lo(*zm)) >> 1;
+        int32_t e_im = (simd_hi(*zk) - simd_hi(*zm)) >> 1;
+        uint32_t odd = simd_pack((simd_hi(*zk) + simd_hi(*zm)) >> 1, (simd_lo(*zm) - simd_lo(*zk)) >> 1);
+        uint32_t w = twiddle(k);
+        int32_t p_re = simd_smusd(odd, w) >> 15;
+        int32_t p_im = simd_smuadx(odd, w) >> 15;
+        *zk = power(e_re + p_re, e_im + p_im);
+        *zm = power(e_re - p_re, p_im - e_im);
+    }
+}
+
+void fft_power(void *frame)
+{
+    uint32_t *x = frame;
+    window(x);
+    radix4(x);
+    split(x);
+}
@@ -0,0 +1,84 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "player.h"
+#include "sysctl.h"
+#include "timer.h"
+
+static uint32_t period;
+static uint32_t frame;
+static uint16_t bits;
+
+Player_status player_configure(const Wave_info *info)
+{
+    if (info->sample_rate < PLAYER_RATE_MIN || info->sample_rate > PLAYER_RATE_MAX)
+    {
+        return PLAYER_RATE_UNSUPPORTED;
+    }
+    bool pcm = info->audio_format == WAVE_FORMAT_PCM &&
+               (info->bits_per_sample == 8 || info->bits_per_sample == 16 || info->bits_per_sample == 24);
+    bool floating = info->audio_format == WAVE_FORMAT_FLOAT && info->bits_per_sample == 32;
+    if ((!pcm && !floating) || (info->num_channels != 1 && info->num_channels != 2))
+    {
+        return PLAYER_FORMAT_UNSUPPORTED;
+    }
+    /*
+        At most 10000 cycles at 80 MHz and 8 kHz, inside the 16-bit
+        counter; 40 kHz leaves 2000 duty steps.
+    */
+    uint32_t clock = sysctl_get_clock();
+    period = (clock + info->sample_rate / 2) / info->sample_rate;
+    frame = info->num_channels * info->bits_per_sample / 8;
+    bits = info->bits_per_sample;
+    Timer *timer1 = timer_address(TIMER_MOD1);
+    timer_set_load(timer1, TIMER_A, period - 1);
+    timer_set_match(timer1, TIMER_A, player_match(0));
+    return PLAYER_OK;
+}
+
+uint32_t player_period(void)
+{
+    return period;
+}
+
+uint32_t player_frame(void)
+{
+    return frame;
+}
+
+uint32_t player_fill(uint32_t size)
+{
+    uint32_t unit = frame % 3 ? 512 : 3 * 512;
+    return size / unit * unit;
+}
+
+/*
+    A float beyond +-1.0, or not a number, is held at the end of the
+    range.
+*/
+static int16_t from_float(const volatile uint8_t *sample)
+{
+    uint32_t word = sample[0] | sample[1] << 8 | sample[2] << 16 | (uint32_t)sample[3] << 24;
+    float value;
+    memcpy(&value, &word, sizeof value);
+    value *= 32768;
+    return value < INT16_MAX ? value > INT16_MIN ? (int16_t)value : INT16_MIN : INT16_MAX;
+}
+
+int16_t player_sample(const volatile uint8_t *sample)
+{
+    switch (bits)
+    {
+    case 8:  return (int16_t)((sample[0] - 128) * 256);
+    case 24: return (int16_t)(sample[1] | sample[2] << 8);
+    case 32: return from_float(sample);
+    default: return (int16_t)(sample[0] | sample[1] << 8);
+    }
+}
+
+uint32_t player_match(int16_t sample)
+{
+    uint32_t load = period - 1;
+    uint32_t high = (uint32_t)(sample + 32768) * load >> 16;
+    return load - high;
+}
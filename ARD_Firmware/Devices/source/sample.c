@@ -0,0 +1,81 @@
+#include <stdint.h>
+#include <string.h>
+#include "sample.h"
+
+#define SAMPLE_MAX ((1L << (SAMPLE_INPUT_BITS - 1)) - 1)
+#define SAMPLE_MIN (-(1L << (SAMPLE_INPUT_BITS - 1)))
+
+/*
+    A sample held to the bits in use; with the full 16 the compare
+    folds away.
+*/
+static inline int32_t saturate(int32_t value)
+{
+    return value > SAMPLE_MAX ? SAMPLE_MAX : value < SAMPLE_MIN ? SAMPLE_MIN : value;
+}
+
+/*
+    Narrower formats go front to back and wider ones back to front, so
+    no sample is overwritten before it is read.
+*/
+#if SAMPLE_FORMAT == 8
+
+uint32_t sample_pack(void *samples, uint32_t count)
+{
+    const int16_t *in = samples;
+    uint8_t *out = samples;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int32_t value = saturate(in[i]) >> (SAMPLE_INPUT_BITS - 8);
+        out[i] = (uint8_t)(value + 128);
+    }
+    return count;
+}
+
+#elif SAMPLE_FORMAT == 16
+
+uint32_t sample_pack(void *samples, uint32_t count)
+{
+#if SAMPLE_INPUT_BITS < 16
+    int16_t *sample = samples;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sample[i] = (int16_t)(saturate(sample[i]) * (1L << (16 - SAMPLE_INPUT_BITS)));
+    }
+#else
+    (void)samples;
+#endif
+    return 2 * count;
+}
+
+#elif SAMPLE_FORMAT == 24
+
+uint32_t sample_pack(void *samples, uint32_t count)
+{
+    const int16_t *in = samples;
+    uint8_t *out = samples;
+    for (uint32_t i = count; i--; )
+    {
+        int32_t value = saturate(in[i]) * (1L << (24 - SAMPLE_INPUT_BITS));
+        out[3 * i] = (uint8_t)value;
+        out[3 * i + 1] = (uint8_t)(value >> 8);
+        out[3 * i + 2] = (uint8_t)(value >> 16);
+    }
+    return 3 * count;
+}
+
+#elif SAMPLE_FORMAT == 32
+
+uint32_t sample_pack(void *samples, uint32_t count)
+{
+    const int16_t *in = samples;
+    uint8_t *out = samples;
+    for (uint32_t i = count; i--; )
+    {
+        float value = saturate(in[i]) * (1.0f / (1L << (SAMPLE_INPUT_BITS - 1)));
+        memcpy(out + 4 * i, &value, sizeof value);
+    }
+    return 4 * count;
+}
+
+#endif
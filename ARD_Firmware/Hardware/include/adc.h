@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "ramfunc.h"
 
 typedef struct Adc Adc;
 
@@ -52,6 +53,13 @@ typedef enum
 
 }   Adc_oversample;
 
+typedef enum
+{
+    ADC_CLOCK_PLL,
+    ADC_CLOCK_PIOSC
+
+}   Adc_clock;
+
 Adc *adc_address(Adc_module module);
 
 void adc_set_order(Adc *adc, Adc_sampler sampler, uint8_t num, Adc_channel channel);
@@ -62,8 +70,12 @@ void adc_set_trigger(Adc *adc, Adc_sampler sampler, uint8_t num);
 
 void adc_set_averaging(Adc *adc, Adc_oversample oversample);
 
+void adc_set_clock(Adc *adc, Adc_clock clock);
+
 void adc_enable_interrupt(Adc *adc, Adc_sampler sampler);
 
+RAMFUNC void adc_clear_interrupt(Adc *adc, Adc_sampler sampler);
+
 void adc_enable_sampler(Adc *adc, Adc_sampler sampler);
 
 void adc_disable_sampler(Adc *adc, Adc_sampler sampler);
@@ -72,6 +84,6 @@ void adc_sample(Adc *adc, Adc_sampler sampler);
 
 bool adc_busy(Adc *adc);
 
-uint32_t adc_result(Adc *adc, Adc_sampler sampler);
+RAMFUNC uint32_t adc_result(Adc *adc, Adc_sampler sampler);
 
 #endif /* ADC_H_ */
@@ -0,0 +1,65 @@
+#ifndef COMP_H_
+#define COMP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Comp Comp;
+
+typedef enum
+{
+    COMP_MOD0,
+    COMP_MOD1
+
+}   Comp_module;
+
+/*
+    What the comparator's VIN+ input is taken from: its own Cn+ pin, the
+    C0+ pin shared by both comparators, or the internal reference.
+*/
+typedef enum
+{
+    COMP_SOURCE_PIN,
+    COMP_SOURCE_C0,
+    COMP_SOURCE_REFERENCE
+
+}   Comp_source;
+
+/*
+    The internal reference is a fraction of VDDA set in 16 steps, level
+    0 to 15, over a low or a high range.
+*/
+typedef enum
+{
+    COMP_RANGE_HIGH,
+    COMP_RANGE_LOW
+
+}   Comp_range;
+
+/*
+    The output is high while VIN- is below VIN+.
+*/
+typedef enum
+{
+    COMP_SENSE_LEVEL,
+    COMP_SENSE_FALLING,
+    COMP_SENSE_RISING,
+    COMP_SENSE_BOTH
+
+}   Comp_sense;
+
+Comp *comp_address(void);
+
+void comp_set_reference(Comp *comp, Comp_range range, uint8_t level);
+
+void comp_set_source(Comp *comp, Comp_module module, Comp_source source);
+
+void comp_set_sense(Comp *comp, Comp_module module, Comp_sense sense);
+
+void comp_enable_interrupt(Comp *comp, Comp_module module);
+
+void comp_clear_interrupt(Comp *comp, Comp_module module);
+
+bool comp_output(Comp *comp, Comp_module module);
+
+#endif /* COMP_H_ */
@@ -0,0 +1,10 @@
+#ifndef DWT_H_
+#define DWT_H_
+
+#include <stdint.h>
+
+void dwt_enable_cycles(void);
+
+uint32_t dwt_cycles(void);
+
+#endif /* DWT_H_ */
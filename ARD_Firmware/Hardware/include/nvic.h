@@ -1,6 +1,16 @@
 #ifndef NVIC_H_
 #define NVIC_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+    The TM4C123 implements three priority bits: 0 is the most urgent
+    level, 7 the least. Every interrupt resets to 0.
+*/
+#define NVIC_PRIORITY_HIGHEST 0
+#define NVIC_PRIORITY_LOWEST  7
+
 typedef enum
 {
     NVIC_VECTOR_GPIO_PORTA,
@@ -91,6 +101,42 @@ typedef enum
 
 }   Nvic_vector;
 
+/*
+    Split of the three priority bits into preemption levels and
+    subpriorities: NVIC_GROUP_8_1 is eight levels that all preempt each
+    other, NVIC_GROUP_1_8 a single level ordered by subpriority only.
+*/
+typedef enum
+{
+    NVIC_GROUP_8_1,
+    NVIC_GROUP_4_2,
+    NVIC_GROUP_2_4,
+    NVIC_GROUP_1_8
+
+}   Nvic_grouping;
+
 void nvic_enable_interrupt(Nvic_vector vector);
 
+void nvic_disable_interrupt(Nvic_vector vector);
+
+void nvic_set_grouping(Nvic_grouping grouping);
+
+void nvic_set_priority(Nvic_vector vector, uint8_t priority);
+
+void nvic_set_priority_systick(uint8_t priority);
+
+bool nvic_pending(Nvic_vector vector);
+
+bool nvic_pending_systick(void);
+
+bool nvic_active(Nvic_vector vector);
+
+uint32_t nvic_enter_critical(uint8_t priority);
+
+void nvic_exit_critical(uint32_t state);
+
+uint32_t nvic_mask_all(void);
+
+void nvic_unmask_all(uint32_t state);
+
 #endif /* NVIC_H_ */
@@ -0,0 +1,17 @@
+#ifndef RAMFUNC_H_
+#define RAMFUNC_H_
+
+/*
+    Places a function in the .ramfunc section, which ResetISR() copies
+    from flash to SRAM before main(). SRAM is fetched without the flash
+    wait states, so this is for ISRs and per-byte loops. long_call lets
+    flash code reach SRAM beyond the range of a BL. Build with
+    RAMFUNC_FLASH defined to leave everything in flash for comparison.
+*/
+#if defined(SIMULATION) || defined(RAMFUNC_FLASH)
+#define RAMFUNC
+#else
+#define RAMFUNC __attribute__ ((section(".ramfunc"), long_call))
+#endif
+
+#endif /* RAMFUNC_H_ */
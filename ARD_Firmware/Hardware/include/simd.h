@@ -0,0 +1,143 @@
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include <stdint.h>
+
+/*
+    Cortex-M4 DSP instructions on pairs of int16 packed in a word, the
+    low half first: a complex sample is (re, im). Each is one cycle on
+    the target; the simulator gets the same arithmetic in C.
+
+        shadd16     (a + b) / 2, each half
+        shsub16     (a - b) / 2, each half
+        shasx       ((a.lo - b.hi) / 2, (a.hi + b.lo) / 2), a + jb halved
+        shsax       ((a.lo + b.hi) / 2, (a.hi - b.lo) / 2), a - jb halved
+        smusd       a.lo * b.lo - a.hi * b.hi
+        smuadx      a.lo * b.hi + a.hi * b.lo
+        smuad       a.lo * b.lo + a.hi * b.hi
+        smulwb      (a * b.lo) >> 16, a taken whole
+        smulwt      (a * b.hi) >> 16, a taken whole
+        ssat16      a clamped to the int16 range
+*/
+static inline uint32_t simd_pack(int32_t lo, int32_t hi)
+{
+    return ((uint32_t)lo & 0xFFFF) | (uint32_t)hi << 16;
+}
+
+static inline int32_t simd_lo(uint32_t x)
+{
+    return (int16_t)x;
+}
+
+static inline int32_t simd_hi(uint32_t x)
+{
+    return (int16_t)(x >> 16);
+}
+
+#if defined(SIMULATION)
+
+static inline uint32_t simd_shadd16(uint32_t a, uint32_t b)
+{
+    return simd_pack((simd_lo(a) + simd_lo(b)) >> 1, (simd_hi(a) + simd_hi(b)) >> 1);
+}
+
+static inline uint32_t simd_shsub16(uint32_t a, uint32_t b)
+{
+    return simd_pack((simd_lo(a) - simd_lo(b)) >> 1, (simd_hi(a) - simd_hi(b)) >> 1);
+}
+
+static inline uint32_t simd_shasx(uint32_t a, uint32_t b)
+{
+    return simd_pack((simd_lo(a) - simd_hi(b)) >> 1, (simd_hi(a) + simd_lo(b)) >> 1);
+}
+
+static inline uint32_t simd_shsax(uint32_t a, uint32_t b)
+{
+    return simd_pack((simd_lo(a) + simd_hi(b)) >> 1, (simd_hi(a) - simd_lo(b)) >> 1);
+}
+
+static inline int32_t simd_smusd(uint32_t a, uint32_t b)
+{
+    return simd_lo(a) * simd_lo(b) - simd_hi(a) * simd_hi(b);
+}
+
+static inline int32_t simd_smuadx(uint32_t a, uint32_t b)
+{
+    return simd_lo(a) * simd_hi(b) + simd_hi(a) * simd_lo(b);
+}
+
+static inline int32_t simd_smuad(uint32_t a, uint32_t b)
+{
+    return simd_lo(a) * simd_lo(b) + simd_hi(a) * simd_hi(b);
+}
+
+static inline int32_t simd_smulwb(int32_t a, uint32_t b)
+{
+    return (int32_t)((int64_t)a * simd_lo(b) >> 16);
+}
+
+static inline int32_t simd_smulwt(int32_t a, uint32_t b)
+{
+    return (int32_t)((int64_t)a * simd_hi(b) >> 16);
+}
+
+static inline int32_t simd_ssat16(int32_t a)
+{
+    return a > INT16_MAX ? INT16_MAX : a < INT16_MIN ? INT16_MIN : a;
+}
+
+#else
+
+#define SIMD_OP(name)\
+static inline uint32_t simd_##name(uint32_t a, uint32_t b)\
+{\
+    uint32_t result;\
+    __asm__ (#name " %0, %1, %2" : "=r" (result) : "r" (a), "r" (b));\
+    return result;\
+}
+
+SIMD_OP(shadd16)
+SIMD_OP(shsub16)
+SIMD_OP(shasx)
+SIMD_OP(shsax)
+
+#undef SIMD_OP
+
+#define SIMD_MUL(name)\
+static inline int32_t simd_##name(uint32_t a, uint32_t b)\
+{\
+    int32_t result;\
+    __asm__ (#name " %0, %1, %2" : "=r" (result) : "r" (a), "r" (b));\
+    return result;\
+}
+
+SIMD_MUL(smusd)
+SIMD_MUL(smuadx)
+SIMD_MUL(smuad)
+
+#undef SIMD_MUL
+
+static inline int32_t simd_smulwb(int32_t a, uint32_t b)
+{
+    int32_t result;
+    __asm__ ("smulwb %0, %1, %2" : "=r" (result) : "r" (a), "r" (b));
+    return result;
+}
+
+static inline int32_t simd_smulwt(int32_t a, uint32_t b)
+{
+    int32_t result;
+    __asm__ ("smulwt %0, %1, %2" : "=r" (result) : "r" (a), "r" (b));
+    return result;
+}
+
+static inline int32_t simd_ssat16(int32_t a)
+{
+    int32_t result;
+    __asm__ ("ssat %0, #16, %1" : "=r" (result) : "r" (a));
+    return result;
+}
+
+#endif
+
+#endif /* SIMD_H_ */
@@ -1,7 +1,9 @@
 #ifndef SSI_H_
 #define SSI_H_
 
+#include <stdbool.h>
 #include <stdint.h>
+#include "ramfunc.h"
 
 typedef struct Ssi Ssi;
 
@@ -36,15 +38,6 @@ typedef enum
 
 }   Ssi_format;
 
-typedef enum
-{
-    SSI_8_MHZ,
-    SSI_4_MHZ,
-    SSI_2_MHZ,
-    SSI_1_MHZ
-
-}   Ssi_rate;
-
 typedef enum
 {
     SSI_SIZE_4,
@@ -78,7 +71,9 @@ void ssi_set_polarity(Ssi *ssi, Ssi_polarity polarity);
 
 void ssi_set_format(Ssi *ssi, Ssi_format format);
 
-void ssi_set_rate(Ssi *ssi, Ssi_rate rate);
+void ssi_set_rate(Ssi *ssi, uint32_t hz);
+
+void ssi_update_rate(Ssi *ssi);
 
 void ssi_set_size(Ssi *ssi, Ssi_size size);
 
@@ -88,6 +83,21 @@ void ssi_enable_module(Ssi *ssi);
 
 void ssi_disable_module(Ssi *ssi);
 
-uint16_t ssi_write(Ssi *ssi, uint16_t data);
+RAMFUNC uint16_t ssi_write(Ssi *ssi, uint16_t data);
+
+/*
+    Receives count bytes while clocking out 0xFF, with the transmit FIFO
+    kept ahead of the receive side so the frames go back to back. No
+    more than a FIFO's worth is ever in flight, so an interrupt taken
+    mid-burst stalls the bus rather than overrunning the receive FIFO.
+*/
+RAMFUNC void ssi_read_burst(Ssi *ssi, uint8_t *buff, uint32_t count);
+
+/*
+    Data register for uDMA, and the receive and transmit DMA requests.
+*/
+volatile void *ssi_data(Ssi *ssi);
+
+void ssi_enable_dma(Ssi *ssi, bool enable);
 
 #endif /* SSI_H_ */
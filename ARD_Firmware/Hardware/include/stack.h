@@ -0,0 +1,16 @@
+#ifndef STACK_H_
+#define STACK_H_
+
+#include <stdint.h>
+
+/*
+    Word ResetISR fills the unused stack with; a word that no longer holds
+    it has been written by main() or an interrupt since reset.
+*/
+#define STACK_PAINT 0xC5C5C5C5
+
+uint32_t stack_size(void);
+
+uint32_t stack_high_water(void);
+
+#endif /* STACK_H_ */
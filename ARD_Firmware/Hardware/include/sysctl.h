@@ -1,6 +1,8 @@
 #ifndef SYSCTL_H_
 #define SYSCTL_H_
 
+#include <stdint.h>
+
 typedef enum
 {
     SYSCTL_PORTA,
@@ -48,12 +50,23 @@ typedef enum
 
 }   Sysctl_divisor;
 
-void sysctl_enable_run_mode(void);
+/*
+    Fastest system clock the part runs at, and the crystal it is derived
+    from; sysctl_set_clock() returns the frequency actually reached.
+*/
+#define SYSCTL_CLOCK_MAX  80000000UL
+#define SYSCTL_CLOCK_XTAL 16000000UL
+
+uint32_t sysctl_set_clock(uint32_t hz);
+
+uint32_t sysctl_get_clock(void);
 
 void sysctl_enable_ahb(Sysctl_port port);
 
 void sysctl_set_clock_adc(Sysctl_module module, Sysctl_mode mode);
 
+void sysctl_set_clock_comp(Sysctl_mode mode);
+
 void sysctl_set_clock_dma(Sysctl_mode mode);
 
 void sysctl_set_clock_gpio(Sysctl_port port, Sysctl_mode mode);
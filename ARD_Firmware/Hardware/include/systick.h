@@ -11,16 +11,6 @@ typedef enum
 
 }   Systick_source;
 
-typedef enum
-{
-    SYSTICK0,
-    SYSTICK1,
-    SYSTICK2,
-    SYSTICK3,
-    SYSTICK_MAX
-
-}   Systick_timer;
-
 void systick_source(Systick_source source);
 
 void systick_reload(uint32_t value);
@@ -33,10 +23,8 @@ void systick_start(void);
 
 void systick_stop(void);
 
-bool systick_delay(Systick_timer event, uint32_t millisecond);
-
-uint32_t systick_current(Systick_timer event);
+uint32_t systick_value(void);
 
-void systick_clear(Systick_timer event);
+uint32_t systick_ticks(void);
 
 #endif /* SYSTICK_H_ */
@@ -35,13 +35,16 @@ typedef enum
 {
     TIMER_ONE_SHOT,
     TIMER_PERIODIC,
+    TIMER_PWM
 
 }   Timer_mode;
 
 typedef enum
 {
     TIMER_A_TIMEOUT,
-    TIMER_B_TIMEOUT
+    TIMER_B_TIMEOUT,
+    TIMER_A_EVENT,
+    TIMER_B_EVENT
 
 }   Timer_interrupt;
 
@@ -63,10 +66,21 @@ void timer_set_mode(Timer *timer, Timer_select select, Timer_mode mode);
 
 void timer_set_load(Timer *timer, Timer_select select, uint32_t load);
 
+/*
+    PWM mode: the output rises as the counter reloads and falls when it
+    reaches the match, and the rising edge raises the event interrupt.
+    A new match takes effect from the next period.
+*/
+void timer_set_match(Timer *timer, Timer_select select, uint32_t match);
+
 void timer_enable(Timer *timer, Timer_select select);
 
 void timer_disable(Timer *timer, Timer_select select);
 
 void timer_interrupt(Timer *timer, Timer_interrupt timer_interrupt);
 
+void timer_clear_interrupt(Timer *timer, Timer_interrupt timer_interrupt);
+
+uint32_t timer_value(Timer *timer, Timer_select select);
+
 #endif /* TIMER_H_ */
@@ -0,0 +1,59 @@
+#ifndef UDMA_H_
+#define UDMA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Udma Udma;
+
+/*
+    One channel's primary control structure. The table is the caller's:
+    an array of these indexed by channel, up to the highest channel
+    used, on a UDMA_TABLE_ALIGN boundary.
+*/
+typedef struct Udma_control
+{
+    const volatile void *src_end;
+    volatile void *dst_end;
+    volatile uint32_t control;
+    uint32_t reserved;
+
+}   Udma_control;
+
+#define UDMA_TABLE_ALIGN 1024
+#define UDMA_TRANSFER_MAX 1024
+
+/*
+    Channels with their reset assignment (encoding 0).
+*/
+typedef enum
+{
+    UDMA_CHANNEL_SSI1_RX = 24,
+    UDMA_CHANNEL_SSI1_TX = 25
+
+}   Udma_channel;
+
+typedef enum
+{
+    UDMA_INCREMENT_BYTE,
+    UDMA_INCREMENT_NONE
+
+}   Udma_increment;
+
+Udma *udma_address(void);
+
+void udma_enable(Udma *udma, Udma_control *table);
+
+void udma_set_priority(Udma *udma, Udma_channel channel, bool high);
+
+/*
+    Basic mode, byte items, arbitrating every 4: half an SSI FIFO.
+    count is 1 to UDMA_TRANSFER_MAX.
+*/
+void udma_transfer(Udma *udma, Udma_channel channel,
+                   const volatile void *src, Udma_increment src_increment,
+                   volatile void *dst, Udma_increment dst_increment, uint32_t count);
+
+bool udma_busy(Udma *udma, Udma_channel channel);
+
+#endif /* UDMA_H_ */
@@ -136,11 +136,25 @@ void adc_set_averaging(Adc *adc, Adc_oversample oversample)
     adc->ADCSAC = mask[oversample];
 }
 
+void adc_set_clock(Adc *adc, Adc_clock clock)
+{
+    /*
+        PLL VCO / 25 or the 16 MHz PIOSC; the PLL source stops converting
+        while the PLL is bypassed.
+    */
+    adc->ADCCC = (clock == ADC_CLOCK_PIOSC) ? 0x1 : 0x0;
+}
+
 void adc_enable_interrupt(Adc *adc, Adc_sampler sampler)
 {
     adc->ADCIM |= (1U << sampler);
 }
 
+RAMFUNC void adc_clear_interrupt(Adc *adc, Adc_sampler sampler)
+{
+    adc->ADCISC = (1U << sampler);
+}
+
 void adc_enable_sampler(Adc *adc, Adc_sampler sampler)
 {
     adc->ADCACTSS |= (1U << sampler);
@@ -165,7 +179,7 @@ bool adc_busy(Adc *adc)
     return false;
 }
 
-uint32_t adc_result(Adc *adc, Adc_sampler sampler)
+RAMFUNC uint32_t adc_result(Adc *adc, Adc_sampler sampler)
 {
     volatile uint32_t *reg[] =
     {
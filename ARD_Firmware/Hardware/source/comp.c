@@ -0,0 +1,70 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "comp.h"
+
+struct Comp
+{
+    volatile uint32_t ACMIS;
+    volatile uint32_t ACRIS;
+    volatile uint32_t ACINTEN;
+    volatile uint32_t RESERVED_0[1];
+    volatile uint32_t ACREFCTL;
+    volatile uint32_t RESERVED_1[3];
+    volatile uint32_t ACSTAT0;
+    volatile uint32_t ACCTL0;
+    volatile uint32_t RESERVED_2[6];
+    volatile uint32_t ACSTAT1;
+    volatile uint32_t ACCTL1;
+    volatile uint32_t RESERVED_3[990];
+    volatile uint32_t ACMPPP;
+};
+
+Comp *comp_address(void)
+{
+    return (void *)0x4003C000;
+}
+
+void comp_set_reference(Comp *comp, Comp_range range, uint8_t level)
+{
+    comp->ACREFCTL = (1U << 9) | ((uint32_t)range << 8) | (level & 0x0F);
+}
+
+void comp_set_source(Comp *comp, Comp_module module, Comp_source source)
+{
+    volatile uint32_t *reg[] =
+    {
+        &comp->ACCTL0,
+        &comp->ACCTL1
+    };
+    *reg[module] = (*reg[module] & ~(0x3U << 9)) | ((uint32_t)source << 9);
+}
+
+void comp_set_sense(Comp *comp, Comp_module module, Comp_sense sense)
+{
+    volatile uint32_t *reg[] =
+    {
+        &comp->ACCTL0,
+        &comp->ACCTL1
+    };
+    *reg[module] = (*reg[module] & ~(0x3U << 2)) | ((uint32_t)sense << 2);
+}
+
+void comp_enable_interrupt(Comp *comp, Comp_module module)
+{
+    comp->ACINTEN |= (1U << module);
+}
+
+void comp_clear_interrupt(Comp *comp, Comp_module module)
+{
+    comp->ACMIS = (1U << module);
+}
+
+bool comp_output(Comp *comp, Comp_module module)
+{
+    volatile uint32_t *reg[] =
+    {
+        &comp->ACSTAT0,
+        &comp->ACSTAT1
+    };
+    return (*reg[module] >> 1) & 1U;
+}
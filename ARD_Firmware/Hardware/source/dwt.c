@@ -0,0 +1,27 @@
+#include <stdint.h>
+#include "dwt.h"
+
+struct Dwt
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+};
+
+static struct Dwt *dwt = (void *)0xE0001000UL;
+
+/*
+    Debug Exception and Monitor Control: TRCENA powers the DWT unit.
+*/
+static volatile uint32_t *demcr = (void *)0xE000EDFCUL;
+
+void dwt_enable_cycles(void)
+{
+    *demcr |= (1U << 24);
+    dwt->CYCCNT = 0;
+    dwt->CTRL |= (1U << 0);
+}
+
+uint32_t dwt_cycles(void)
+{
+    return dwt->CYCCNT;
+}
@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include <stdint.h>
 #include "nvic.h"
 
@@ -74,9 +75,18 @@ struct Nvic
 
 static struct Nvic *nvic = (void *)0xE000E100UL;
 
-void nvic_enable_interrupt(Nvic_vector vector)
+/*
+    System control block registers holding the SysTick pending bit
+    (INTCTRL), the priority grouping (APINT) and the SysTick priority
+    (SYSPRI3).
+*/
+static volatile uint32_t *intctrl = (void *)0xE000ED04UL;
+static volatile uint32_t *apint   = (void *)0xE000ED0CUL;
+static volatile uint32_t *syspri3 = (void *)0xE000ED20UL;
+
+static uint32_t nvic_irq(Nvic_vector vector)
 {
-    uint8_t vector_number[] =
+    static const uint8_t vector_number[] =
     {
         16,  17,  18,  19,  20,  21,  22,  23,  24,  25,
         26,  27,  28,  29,  30,  31,  32,  33,  34,  35,
@@ -88,26 +98,127 @@ void nvic_enable_interrupt(Nvic_vector vector)
         115, 116, 117, 118, 119, 120, 121, 122, 125, 126,
         150, 151, 152, 153, 154
     };
-    uint32_t value = vector_number[vector];
+    return vector_number[vector] - 16;
+}
 
-    if (value < 32  + 16)
-    {
-        nvic->EN0  |= (1U << (value - 16 * 1));
-    }
-    else if (value < 64  + 16)
+void nvic_enable_interrupt(Nvic_vector vector)
+{
+    volatile uint32_t *reg[] =
     {
-        nvic->EN1 |= (1U << (value - 16 * 3));
-    }
-    else if (value < 96  + 16)
+        &nvic->EN0,
+        &nvic->EN1,
+        &nvic->EN2,
+        &nvic->EN3,
+        &nvic->EN4
+    };
+    uint32_t irq = nvic_irq(vector);
+    *reg[irq / 32] = (1U << (irq % 32));
+}
+
+void nvic_disable_interrupt(Nvic_vector vector)
+{
+    volatile uint32_t *reg[] =
     {
-        nvic->EN2 |= (1U << (value - 16 * 5));
-    }
-    else if (value < 128 + 16)
+        &nvic->DIS0,
+        &nvic->DIS1,
+        &nvic->DIS2,
+        &nvic->DIS3,
+        &nvic->DIS4
+    };
+    uint32_t irq = nvic_irq(vector);
+    *reg[irq / 32] = (1U << (irq % 32));
+}
+
+void nvic_set_grouping(Nvic_grouping grouping)
+{
+    /*
+        PRIGROUP 4..7 leaves 3..0 of the implemented bits for
+        preemption; writes need the VECTKEY.
+    */
+    uint32_t value = *apint & ~((0xFFFFU << 16) | (0x7U << 8));
+    *apint = value | (0x05FAU << 16) | ((4U + grouping) << 8);
+}
+
+void nvic_set_priority(Nvic_vector vector, uint8_t priority)
+{
+    volatile uint8_t *reg = (volatile uint8_t *)&nvic->PRI0;
+    reg[nvic_irq(vector)] = (uint8_t)(priority << 5);
+}
+
+void nvic_set_priority_systick(uint8_t priority)
+{
+    *syspri3 &= ~(0x7U << 29);
+    *syspri3 |=  ((uint32_t)priority << 29);
+}
+
+bool nvic_pending(Nvic_vector vector)
+{
+    volatile uint32_t *reg[] =
     {
-        nvic->EN3 |= (1U << (value - 16 * 7));
-    }
-    else if (value < 160 + 16)
+        &nvic->PEND0,
+        &nvic->PEND1,
+        &nvic->PEND2,
+        &nvic->PEND3,
+        &nvic->PEND4
+    };
+    uint32_t irq = nvic_irq(vector);
+    return *reg[irq / 32] & (1U << (irq % 32));
+}
+
+/*
+    PENDSTSET: the SysTick exception is pending, not yet taken.
+*/
+bool nvic_pending_systick(void)
+{
+    return *intctrl & (1U << 26);
+}
+
+bool nvic_active(Nvic_vector vector)
+{
+    volatile uint32_t *reg[] =
     {
-        nvic->EN4 |= (1U << (value - 16 * 9));
-    }
+        &nvic->ACTIVE0,
+        &nvic->ACTIVE1,
+        &nvic->ACTIVE2,
+        &nvic->ACTIVE3,
+        &nvic->ACTIVE4
+    };
+    uint32_t irq = nvic_irq(vector);
+    return *reg[irq / 32] & (1U << (irq % 32));
+}
+
+uint32_t nvic_enter_critical(uint8_t priority)
+{
+    /*
+        Masks every interrupt at priority and below through BASEPRI,
+        leaving the more urgent ones running. BASEPRI_MAX only ever
+        raises the mask, so sections nest. Priority 0 cannot be masked
+        this way (BASEPRI 0 means no masking).
+    */
+    uint32_t state;
+    __asm__ volatile ("mrs %0, basepri" : "=r" (state));
+    __asm__ volatile ("msr basepri_max, %0" : : "r" ((uint32_t)priority << 5) : "memory");
+    return state;
+}
+
+void nvic_exit_critical(uint32_t state)
+{
+    __asm__ volatile ("msr basepri, %0" : : "r" (state) : "memory");
+}
+
+uint32_t nvic_mask_all(void)
+{
+    /*
+        PRIMASK holds off priority 0 too; keep these sections to a few
+        instructions.
+    */
+    uint32_t state;
+    __asm__ volatile ("mrs %0, primask" : "=r" (state));
+    __asm__ volatile ("cpsid i" : : : "memory");
+    return state;
+}
+
+void nvic_unmask_all(uint32_t state)
+{
+    __asm__ volatile ("msr primask, %0" : : "r" (state) : "memory");
 }
@@ -1,6 +1,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "ssi.h"
+#include "sysctl.h"
 
 struct Ssi
 {
@@ -18,6 +19,17 @@ struct Ssi
     volatile uint32_t SSICC;
 };
 
+/*
+    Bit rate last requested per module, kept so it can be re-derived when
+    the system clock changes. Modules sit 4 KiB apart from 0x40008000.
+*/
+static uint32_t rate[SSI_MOD3 + 1];
+
+static uint32_t ssi_module(Ssi *ssi)
+{
+    return ((uint32_t)ssi >> 12) & 0x3;
+}
+
 Ssi *ssi_address(Ssi_module module)
 {
     uint32_t reg[] =
@@ -65,14 +77,36 @@ void ssi_set_format(Ssi *ssi, Ssi_format format)
     ssi->SSICR0 |= mask[format];
 }
 
-void ssi_set_rate(Ssi *ssi, Ssi_rate rate)
+void ssi_set_rate(Ssi *ssi, uint32_t hz)
 {
-    uint32_t mask[] =
+    /*
+        SSIClk = SysClk / (CPSDVSR * (1 + SCR)) with CPSDVSR even, 2..254:
+        take the smallest prescaler whose SCR fits in 8 bits and round SCR
+        up so the bus never runs faster than asked. The module has to be
+        disabled while the divisors change.
+    */
+    uint32_t clock = sysctl_get_clock();
+    uint32_t enabled = ssi->SSICR1 & (1U << 1);
+    uint32_t cpsdvsr = 0;
+    uint32_t scr;
+    rate[ssi_module(ssi)] = hz;
+    do
     {
-        0x02, 0x04,
-        0x08, 0x10
-    };
-    ssi->SSICPSR = mask[rate];
+        cpsdvsr += 2;
+        scr = (clock / cpsdvsr + hz - 1) / hz - 1;
+    }
+    while (scr > 0xFF && cpsdvsr < 254);
+    scr = scr > 0xFF ? 0xFF : scr;
+    ssi->SSICR1 &= ~(1U << 1);
+    ssi->SSICPSR = cpsdvsr;
+    ssi->SSICR0 &= ~(0xFFU << 8);
+    ssi->SSICR0 |=  (scr << 8);
+    ssi->SSICR1 |= enabled;
+}
+
+void ssi_update_rate(Ssi *ssi)
+{
+    ssi_set_rate(ssi, rate[ssi_module(ssi)]);
 }
 
 void ssi_set_size(Ssi *ssi, Ssi_size size)
@@ -109,7 +143,44 @@ void ssi_disable_module(Ssi *ssi)
     ssi->SSICR1 &= ~(1U << 1);
 }
 
-uint16_t ssi_write(Ssi *ssi, uint16_t data)
+#define SSI_FIFO_DEPTH 8
+
+RAMFUNC void ssi_read_burst(Ssi *ssi, uint8_t *buff, uint32_t count)
+{
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    while (received < count)
+    {
+        if (sent < count && sent - received < SSI_FIFO_DEPTH && (ssi->SSISR & (1U << 1)))
+        {
+            ssi->SSIDR = 0xFF;
+            sent++;
+        }
+        if (ssi->SSISR & (1U << 2))
+        {
+            buff[received++] = (uint8_t)ssi->SSIDR;
+        }
+    }
+}
+
+volatile void *ssi_data(Ssi *ssi)
+{
+    return &ssi->SSIDR;
+}
+
+void ssi_enable_dma(Ssi *ssi, bool enable)
+{
+    if (enable)
+    {
+        ssi->SSIDMACTL |= (1U << 0) | (1U << 1);
+    }
+    else
+    {
+        ssi->SSIDMACTL &= ~((1U << 0) | (1U << 1));
+    }
+}
+
+RAMFUNC uint16_t ssi_write(Ssi *ssi, uint16_t data)
 {
     ssi->SSIDR = data;
     bool busy = true;
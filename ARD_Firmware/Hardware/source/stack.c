@@ -0,0 +1,27 @@
+#include <stdint.h>
+#include "stack.h"
+
+/*
+    Ends of the .stack section in linker.lds.
+*/
+extern uint32_t __stack_start__;
+extern uint32_t __stack_end__;
+
+uint32_t stack_size(void)
+{
+    return (uint32_t)(&__stack_end__ - &__stack_start__) * sizeof(uint32_t);
+}
+
+uint32_t stack_high_water(void)
+{
+    /*
+        The stack grows down, so the deepest use is the lowest word that
+        lost its paint.
+    */
+    uint32_t *word = &__stack_start__;
+    while (word < &__stack_end__ && *word == STACK_PAINT)
+    {
+        word++;
+    }
+    return (uint32_t)(&__stack_end__ - word) * sizeof(uint32_t);
+}
@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include <stdint.h>
 #include "sysctl.h"
 
@@ -168,8 +169,35 @@ struct Sysctl
 
 static struct Sysctl *sysctl = (void *)0x400FE000UL;
 
-void sysctl_enable_run_mode(void)
+/*
+    System clock: 16 MHz PIOSC out of reset, then either the 400 MHz PLL
+    or the 16 MHz crystal divided down by SYSDIV2.
+*/
+#define SYSCTL_PLL_HZ  400000000UL
+#define SYSCTL_XTAL_HZ 16000000UL
+
+static uint32_t clock = 16000000UL;
+
+uint32_t sysctl_set_clock(uint32_t hz)
 {
+    /*
+        Round the divisor up so the clock never exceeds the request: PLL
+        divisors 5..25 cover 80 MHz down to 16 MHz, anything at or below
+        the crystal runs from MOSC / 1..64 with the PLL powered down. The
+        flash controller inserts its own wait states and prefetches above
+        40 MHz, so there is no wait state to program here.
+    */
+    uint32_t divisor = hz ? (SYSCTL_PLL_HZ + hz - 1) / hz : 0;
+    bool pll = hz > SYSCTL_XTAL_HZ;
+    if (!pll)
+    {
+        divisor = hz ? (SYSCTL_XTAL_HZ + hz - 1) / hz : 64;
+        divisor = divisor > 64 ? 64 : divisor;
+    }
+    else if (divisor < 5)
+    {
+        divisor = 5;
+    }
     sysctl->RCC2 |=  (1U << 31);   // Enable RCC2
     sysctl->RCC2 |=  (1U << 11);   // set BYPASS
     sysctl->RCC  &= ~(1U << 22);   // clear USESYSDIV
@@ -177,19 +205,36 @@ void sysctl_enable_run_mode(void)
     sysctl->RCC  |=  (0x15U << 6); // set XTAL 16 MHz
     sysctl->RCC2 &= ~(0x7U << 4);  // clear OSCSRC2
     sysctl->RCC2 |=  (0x0U << 4);  // set OSCSRC2 to MOSC
-    sysctl->RCC2 &= ~(1U << 13);   // clear PWRDN2
-
-
-    sysctl->RCC2 |=  (1U << 30);    // set DIV400
     sysctl->RCC2 &= ~(0x3FU << 23); // clear SYSDIV2
-    sysctl->RCC2 |=  (0x02U << 23); // set SYSDIV2
     sysctl->RCC2 &= ~(1U << 22);    // clear SYSDIV2LSB
-    sysctl->RCC  |=  (1U << 22);    // set USESYSDIV
-    while (!(sysctl->RIS & (1U << 6)))
+    if (pll)
+    {
+        sysctl->RCC2 &= ~(1U << 13);   // clear PWRDN2
+        sysctl->RCC2 |=  (1U << 30);    // set DIV400
+        sysctl->RCC2 |=  (((divisor - 1) >> 1) << 23); // set SYSDIV2
+        sysctl->RCC2 |=  (((divisor - 1) & 1U) << 22); // set SYSDIV2LSB
+        sysctl->RCC  |=  (1U << 22);    // set USESYSDIV
+        while (!(sysctl->PLLSTAT & (1U << 0)))
+        {
+            // Wait for PLL to lock
+        }
+        sysctl->RCC2 &= ~(1U << 11);   // clear BYPASS2
+        clock = SYSCTL_PLL_HZ / divisor;
+    }
+    else
     {
-        // Wait for PLL to lock
+        sysctl->RCC2 &= ~(1U << 30);    // clear DIV400
+        sysctl->RCC2 |=  ((divisor - 1) << 23); // set SYSDIV2
+        sysctl->RCC  |=  (1U << 22);    // set USESYSDIV
+        sysctl->RCC2 |=  (1U << 13);    // set PWRDN2
+        clock = SYSCTL_XTAL_HZ / divisor;
     }
-    sysctl->RCC2 &= ~(1U << 11);   // clear BYPASS2
+    return clock;
+}
+
+uint32_t sysctl_get_clock(void)
+{
+    return clock;
 }
 
 void sysctl_enable_ahb(Sysctl_port port)
@@ -208,6 +253,17 @@ void sysctl_set_clock_adc(Sysctl_module module, Sysctl_mode mode)
     *reg[mode] |= (1U << module);
 }
 
+void sysctl_set_clock_comp(Sysctl_mode mode)
+{
+    volatile uint32_t *reg[] =
+    {
+        &sysctl->RCGCACMP,
+        &sysctl->SCGCACMP,
+        &sysctl->DCGCACMP
+    };
+    *reg[mode] |= (1U << 0);
+}
+
 void sysctl_set_clock_dma(Sysctl_mode mode)
 {
     volatile uint32_t *reg[] =
@@ -48,33 +48,23 @@ void systick_stop(void)
     systick->STCTRL &= ~(1U << 0);
 }
 
-static volatile uint32_t count[SYSTICK_MAX];
-
-bool systick_delay(Systick_timer event, uint32_t millisecond)
+uint32_t systick_value(void)
 {
-    if (count[event] >= millisecond)
-    {
-        count[event] = 0;
-        return true;
-    }
-    return false;
+    return systick->STCURRENT;
 }
 
-uint32_t systick_current(Systick_timer event)
-{
-    return count[event];
-}
+/*
+    Counter wraps since reset. The handler costs the same however many
+    deadlines are waiting; alarm.c compares them against this.
+*/
+static volatile uint32_t ticks;
 
-void systick_clear(Systick_timer event)
+uint32_t systick_ticks(void)
 {
-    count[event] = 0;
+    return ticks;
 }
 
 void isr_systick(void)
 {
-    for (uint8_t i = 0; i < SYSTICK_MAX; i++)
-    {
-        count[i]++;
-    }
+    ticks++;
 }
-
@@ -68,7 +68,10 @@ void timer_set_mode(Timer *timer, Timer_select select, Timer_mode mode)
         &timer->GPTMTAMR,
         &timer->GPTMTBMR
     };
-    uint32_t mask[] = {0x1, 0x2};
+    /*
+        PWM: periodic, alternate mode select and the PWM interrupt.
+    */
+    uint32_t mask[] = {0x1, 0x2, 0x20A};
     *reg[select] |= mask[mode];
 }
 
@@ -82,6 +85,16 @@ void timer_set_load(Timer *timer, Timer_select select, uint32_t load)
     *reg[select] = load;
 }
 
+void timer_set_match(Timer *timer, Timer_select select, uint32_t match)
+{
+    volatile uint32_t *reg[] =
+    {
+        &timer->GPTMTAMATCHR,
+        &timer->GPTMTBMATCHR
+    };
+    *reg[select] = match;
+}
+
 void timer_enable(Timer *timer, Timer_select select)
 {
     uint32_t mask[] = {(1 << 0), (1 << 8)};
@@ -96,8 +109,24 @@ void timer_disable(Timer *timer, Timer_select select)
 
 void timer_interrupt(Timer *timer, Timer_interrupt timer_interrupt)
 {
-    uint32_t mask[] = {(1 << 0), (1 << 8)};
+    uint32_t mask[] = {(1 << 0), (1 << 8), (1 << 2), (1 << 10)};
     timer->GPTMIMR |= mask[timer_interrupt];
 }
 
+void timer_clear_interrupt(Timer *timer, Timer_interrupt timer_interrupt)
+{
+    uint32_t mask[] = {(1 << 0), (1 << 8), (1 << 2), (1 << 10)};
+    timer->GPTMICR = mask[timer_interrupt];
+}
+
+uint32_t timer_value(Timer *timer, Timer_select select)
+{
+    volatile uint32_t *reg[] =
+    {
+        &timer->GPTMTAV,
+        &timer->GPTMTBV
+    };
+    return *reg[select];
+}
+
 
@@ -0,0 +1,80 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "udma.h"
+
+struct Udma
+{
+    volatile uint32_t DMASTAT;
+    volatile uint32_t DMACFG;
+    volatile uint32_t DMACTLBASE;
+    volatile uint32_t DMAALTBASE;
+    volatile uint32_t DMAWAITSTAT;
+    volatile uint32_t DMASWREQ;
+    volatile uint32_t DMAUSEBURSTSET;
+    volatile uint32_t DMAUSEBURSTCLR;
+    volatile uint32_t DMAREQMASKSET;
+    volatile uint32_t DMAREQMASKCLR;
+    volatile uint32_t DMAENASET;
+    volatile uint32_t DMAENACLR;
+    volatile uint32_t DMAALTSET;
+    volatile uint32_t DMAALTCLR;
+    volatile uint32_t DMAPRIOSET;
+    volatile uint32_t DMAPRIOCLR;
+    volatile uint32_t RESERVED_0[3];
+    volatile uint32_t DMAERRCLR;
+};
+
+/*
+    Table for the controller, which sees only the channels' control
+    structures through it.
+*/
+static Udma_control *control;
+
+Udma *udma_address(void)
+{
+    return (void *)0x400FF000;
+}
+
+void udma_enable(Udma *udma, Udma_control *table)
+{
+    control = table;
+    udma->DMACFG = 1;
+    udma->DMACTLBASE = (uint32_t)table;
+}
+
+void udma_set_priority(Udma *udma, Udma_channel channel, bool high)
+{
+    if (high)
+    {
+        udma->DMAPRIOSET = 1U << channel;
+    }
+    else
+    {
+        udma->DMAPRIOCLR = 1U << channel;
+    }
+}
+
+void udma_transfer(Udma *udma, Udma_channel channel,
+                   const volatile void *src, Udma_increment src_increment,
+                   volatile void *dst, Udma_increment dst_increment, uint32_t count)
+{
+    /*
+        The end pointers address the last item; a fixed end stays put.
+    */
+    uint32_t last = count - 1;
+    Udma_control *entry = &control[channel];
+    entry->src_end = (const volatile uint8_t *)src + (src_increment == UDMA_INCREMENT_BYTE ? last : 0);
+    entry->dst_end = (volatile uint8_t *)dst + (dst_increment == UDMA_INCREMENT_BYTE ? last : 0);
+    entry->control = ((dst_increment == UDMA_INCREMENT_NONE ? 0x3U : 0x0U) << 30) |
+                     ((src_increment == UDMA_INCREMENT_NONE ? 0x3U : 0x0U) << 26) |
+                     (0x2U << 14) |
+                     (last << 4) |
+                     0x1U;
+    udma->DMAALTCLR = 1U << channel;
+    udma->DMAENASET = 1U << channel;
+}
+
+bool udma_busy(Udma *udma, Udma_channel channel)
+{
+    return udma->DMAENASET & (1U << channel);
+}
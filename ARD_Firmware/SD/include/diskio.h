@@ -37,7 +37,6 @@ DSTATUS disk_status (BYTE pdrv);
 DRESULT disk_read (BYTE pdrv, BYTE*buff, DWORD sector, BYTE count);
 DRESULT disk_write (BYTE pdrv, const BYTE* buff, DWORD sector, BYTE count);
 DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
-void	disk_timerproc (void);
 
 /* Disk Status Bits (DSTATUS) */
 #define STA_NOINIT		0x01	/* Drive not initialized */
@@ -66,6 +65,7 @@ void	disk_timerproc (void);
 #define MMC_GET_CID			12	/* Get CID */
 #define MMC_GET_OCR			13	/* Get OCR */
 #define MMC_GET_SDSTAT		14	/* Get SD status */
+#define MMC_GET_ERASE_TIME	15	/* Get erase time of one allocation unit in ms */
 
 /* ATA/CF specific ioctl command */
 #define ATA_GET_REV			20	/* Get F/W revision */
@@ -80,6 +80,12 @@ void	disk_timerproc (void);
 #define CT_SDC		(CT_SD1|CT_SD2)	/* SD */
 #define CT_BLOCK	0x08		/* Block addressing */
 
+/* SPI clock while the card is identified, and the 25 MHz ceiling of a
+   default speed card once it is; both are rounded down to what the
+   system clock divides to. */
+#define SPI_SLOW_HZ	400000UL
+#define SPI_FAST_HZ	25000000UL
+
 
 #ifdef __cplusplus
 }
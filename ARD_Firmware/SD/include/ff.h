@@ -93,6 +93,20 @@ typedef struct {
 	DWORD	last_clust;		/* Last allocated cluster */
 	DWORD	free_clust;		/* Number of free clusters */
 	DWORD	fsi_sector;		/* fsinfo sector (FAT32) */
+	DWORD	fscan;			/* FAT entries read to find free clusters (0ed on mount) */
+#if _FS_EXTENTS
+	DWORD	xscan;			/* Cluster the next free extent scan starts from */
+	DWORD	xstart[_FS_EXTENTS];	/* First cluster of each listed free extent */
+	DWORD	xlen[_FS_EXTENTS];	/* Clusters in each listed free extent */
+	BYTE	xcnt;			/* Number of listed free extents */
+	BYTE	xfull;			/* A scan found no free cluster (1) since the last was freed */
+#endif
+#if _FS_LAZY_MIRROR
+	DWORD	mfirst;			/* First FAT sector changed since the mirror went stale */
+	DWORD	mlast;			/* Last FAT sector changed since the mirror went stale */
+	BYTE	mflag;			/* Mirror stale flag (1:FAT sectors go to the first FAT only) */
+	BYTE	nwrite;			/* Number of files open for writing */
+#endif
 #endif
 #if _FS_RPATH
 	DWORD	cdir;			/* Current directory start cluster (0:root) */
@@ -105,6 +119,14 @@ typedef struct {
 	DWORD	database;		/* Data start sector */
 	DWORD	winsect;		/* Current sector appearing in the win[] */
 	BYTE	win[_MAX_SS];	/* Disk access window for Directory, FAT (and Data on tiny cfg) */
+#if _FS_CACHE
+	DWORD	pinsect;		/* FAT sector not to be evicted (0:none) */
+	DWORD	ctick;			/* Use counter for LRU */
+	DWORD	csect[_FS_CACHE];	/* Sector held by each cache line */
+	DWORD	cused[_FS_CACHE];	/* Last use of each cache line */
+	BYTE	cbuf[_FS_CACHE][_MAX_SS];	/* Cached sectors */
+	BYTE	cflag[_FS_CACHE];	/* Cache line status (CL_VALID, CL_DIRTY) */
+#endif
 } FATFS;
 
 
@@ -124,9 +146,11 @@ typedef struct {
 #if !_FS_READONLY
 	DWORD	dir_sect;		/* Sector containing the directory entry */
 	BYTE*	dir_ptr;		/* Pointer to the directory entry in the window */
+	DWORD	wcopy;			/* Times f_write copied data through the sector buffer (0ed on file open) */
 #endif
 #if _USE_FASTSEEK
 	DWORD*	cltbl;			/* Pointer to the cluster link map table (null on file open) */
+	DWORD	cltsize;		/* Number of items the link map table holds */
 #endif
 #if _FS_LOCK
 	UINT	lockid;			/* File lock ID (index of file semaphore table Files[]) */
@@ -214,6 +238,7 @@ FRESULT f_stat (const TCHAR* path, FILINFO* fno);					/* Get file status */
 FRESULT f_write (FIL* fp, const void* buff, UINT btw, UINT* bw);	/* Write data to a file */
 FRESULT f_getfree (const TCHAR* path, DWORD* nclst, FATFS** fatfs);	/* Get number of free clusters on the drive */
 FRESULT f_truncate (FIL* fp);										/* Truncate file */
+FRESULT f_reserve (FIL* fp, DWORD size, DWORD align, DWORD* sect);	/* Reserve and erase contiguous clusters ahead of the data */
 FRESULT f_sync (FIL* fp);											/* Flush cached data of a writing file */
 FRESULT f_unlink (const TCHAR* path);								/* Delete an existing file or directory */
 FRESULT	f_mkdir (const TCHAR* path);								/* Create a new directory */
@@ -20,6 +20,30 @@
 /  data transfer. This reduces memory consumption 512 bytes each file object. */
 
 
+#define	_FS_CACHE		4	/* 0:Disable or number of sectors */
+/* Number of FAT and directory sectors kept in the file system object besides
+/  the window, least recently used first out. Dirty sectors are written back
+/  when evicted or on f_sync/f_close, and the FAT sector of a chain being
+/  stretched stays cached. Each costs _MAX_SS bytes; requires _FS_TINY == 0. */
+
+
+#define	_FS_EXTENTS		8	/* 0:Disable or number of free extents listed */
+/* Runs of free clusters kept in the file system object. The FAT is scanned
+/  for them on the first allocation after mount and whenever the list runs
+/  dry, resuming where the last scan stopped; allocation then takes the next
+/  listed cluster instead of walking the FAT at a cluster boundary. Each
+/  costs 8 bytes. */
+
+
+#define	_FS_LAZY_MIRROR	1	/* 0:Disable or 1:Enable */
+/* FAT sectors written while a file is open for writing go to the first FAT
+/  only, and the range changed is copied to the other FATs in one batch on
+/  the f_sync or f_close of the last such file. The clean shutdown bit of FAT
+/  entry 1 is cleared meanwhile, so a mirror left stale by a power loss is
+/  restored from the first FAT at the next mount. FAT12 and single FAT
+/  volumes are unaffected. */
+
+
 #define _FS_READONLY	0	/* 0:Read/Write or 1:Read only */
 /* Setting _FS_READONLY to 1 defines read only configuration. This removes
 /  writing functions, f_write, f_sync, f_unlink, f_mkdir, f_chmod, f_rename,
@@ -40,12 +64,21 @@
 /* To enable string functions, set _USE_STRFUNC to 1 or 2. */
 
 
+#ifdef SIMULATION
+#define	_USE_MKFS		1	/* 0:Disable or 1:Enable */
+#else
 #define	_USE_MKFS		0	/* 0:Disable or 1:Enable */
-/* To enable f_mkfs function, set _USE_MKFS to 1 and set _FS_READONLY to 0 */
+#endif
+/* To enable f_mkfs function, set _USE_MKFS to 1 and set _FS_READONLY to 0.
+/  The host simulation build enables it to format fresh disk images. */
 
 
-#define	_USE_FASTSEEK	0	/* 0:Disable or 1:Enable */
-/* To enable fast seek feature, set _USE_FASTSEEK to 1. */
+#define	_USE_FASTSEEK	1	/* 0:Disable or 1:Enable */
+/* To enable fast seek feature, set _USE_FASTSEEK to 1. A link map created
+/  with f_lseek(fp, CREATE_LINKMAP) on a file open for writing is kept up to
+/  date by f_write, f_reserve and f_truncate while it has room; when a new
+/  fragment does not fit, the map is dropped and the file falls back to
+/  following the chain on the FAT. */
 
 
 #define _USE_LABEL		0	/* 0:Disable or 1:Enable */
@@ -148,7 +181,7 @@
 / is tied to the partitions listed in VolToPart[]. */
 
 
-#define	_USE_ERASE	0	/* 0:Disable or 1:Enable */
+#define	_USE_ERASE	1	/* 0:Disable or 1:Enable */
 /* To enable sector erase feature, set _USE_ERASE to 1. CTRL_ERASE_SECTOR command
 /  should be added to the disk_ioctl functio. */
 
@@ -0,0 +1,49 @@
+#ifndef PEAKS_H_
+#define PEAKS_H_
+
+#include <stdint.h>
+#include "ff.h"
+#include "wave.h"
+
+/*
+    Waveform summary kept beside a recording, R0000001.PKS next to
+    R0000001.WAV, so a viewer can draw it without decoding the samples.
+
+    A PEAKS_HEADER byte header:
+
+        0   "PKS1"
+        4   sample rate, uint32
+        8   samples per record, uint16
+        10  bytes per record, uint16
+        12  record count, uint32, patched on close (0 if the recording
+            was cut short; the file size then gives it)
+
+    then one record per PEAKS_SAMPLES samples, the last one possibly
+    short: minimum, maximum and RMS of the 16-bit samples, each a
+    little-endian int16 (the RMS as uint16).
+*/
+#define PEAKS_SAMPLES 512
+#define PEAKS_HEADER  16
+#define PEAKS_RECORD  6
+
+/*
+    Creates the summary beside wave (the recording's path) and writes
+    its header. Until the next peaks_open(), a failed write stops the
+    summary and leaves the recording alone.
+*/
+FRESULT peaks_open(const TCHAR *wave, const Wave_info *info);
+
+/*
+    Folds bytes of 16-bit mono samples into the summary, writing the
+    records completed.
+*/
+FRESULT peaks_add(const void *samples, uint32_t bytes);
+
+/*
+    Writes the record in progress, patches the count and closes.
+*/
+FRESULT peaks_close(void);
+
+uint32_t peaks_records(void);
+
+#endif /* PEAKS_H_ */
@@ -0,0 +1,41 @@
+#ifndef SIDECAR_H_
+#define SIDECAR_H_
+
+#include <stdint.h>
+#include "ff.h"
+
+/*
+    A file written beside a recording while it is made, R0000001.PKS or
+    .SPC next to R0000001.WAV: a header with a record count, then records
+    appended as the samples come in. Each cluster it takes is synced at
+    once, so the FAT sector it dirtied is not left for whoever next syncs
+    the volume, a recording being closed on a failing supply among them.
+    A failed write closes it; the recording carries on without it.
+*/
+typedef struct
+{
+    FIL file;
+    DWORD synced;
+    FRESULT status;
+
+}   Sidecar;
+
+/*
+    Creates the file beside wave (the recording's path), swapping its
+    extension for the three letters given, and writes the header.
+*/
+FRESULT sidecar_open(Sidecar *sidecar, const TCHAR *wave, const char *extension, const void *header, UINT bytes);
+
+FRESULT sidecar_write(Sidecar *sidecar, const void *data, UINT bytes);
+
+/*
+    Hands back any clusters past the last record, patches the count at
+    offset in the header and closes.
+*/
+FRESULT sidecar_close(Sidecar *sidecar, DWORD offset, uint32_t count);
+
+void sidecar_put_uint16(uint8_t *p, uint32_t value);
+
+void sidecar_put_uint32(uint8_t *p, uint32_t value);
+
+#endif /* SIDECAR_H_ */
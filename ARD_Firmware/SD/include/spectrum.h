@@ -0,0 +1,53 @@
+#ifndef SPECTRUM_H_
+#define SPECTRUM_H_
+
+#include <stdint.h>
+#include "ff.h"
+#include "wave.h"
+
+/*
+    Band energies kept beside a recording, R0000001.SPC next to
+    R0000001.WAV, so a viewer can draw a spectrogram without decoding
+    the samples. Built with SPECTRUM defined.
+
+    A SPECTRUM_HEADER byte header:
+
+        0   "SPC1"
+        4   sample rate, uint32
+        8   samples per record, uint16 (FFT_SAMPLES; a bin is
+            rate / FFT_SAMPLES Hz)
+        10  bands per record, uint16
+        12  record count, uint32, patched on close (0 if the recording
+            was cut short; the file size then gives it)
+        16  first bin of each band and the end of the last, uint16 each
+
+    then one record per FFT_SAMPLES samples: a byte per band, the power
+    of its Hann-windowed bins in quarters of a binary order of magnitude
+    (0.75 dB), 0 for none. Bands are about a quarter octave wide down to
+    a bin each at the bottom.
+*/
+#define SPECTRUM_BANDS  32
+#define SPECTRUM_HEADER (16 + 2 * (SPECTRUM_BANDS + 1))
+
+/*
+    Creates the file beside wave (the recording's path) and writes its
+    header. Until the next spectrum_open(), a failed write stops it and
+    leaves the recording alone.
+*/
+FRESULT spectrum_open(const TCHAR *wave, const Wave_info *info);
+
+/*
+    Analyses whole frames of FFT_SAMPLES 16-bit mono samples and writes
+    a record for each; a part frame at the end is left out. The samples
+    are overwritten, so this comes after they are written to the card.
+*/
+FRESULT spectrum_add(void *samples, uint32_t bytes);
+
+/*
+    Patches the count and closes.
+*/
+FRESULT spectrum_close(void);
+
+uint32_t spectrum_records(void);
+
+#endif /* SPECTRUM_H_ */
@@ -1,6 +1,7 @@
 #ifndef WAVE_H_
 #define WAVE_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "ff.h"
 
@@ -9,9 +10,20 @@
     https://ccrma.stanford.edu/courses/422-winter-2014/projects/WaveFormat/
 */
 
+/*
+    The header is padded with a JUNK chunk so the samples start on a
+    sector boundary: whole-sector writes after it go from the caller's
+    buffer straight to the card.
+*/
+#define WAVE_DATA_OFFSET 512
+
+#define WAVE_FORMAT_PCM   1
+#define WAVE_FORMAT_FLOAT 3
+
 typedef struct Wave_info
 {
     uint32_t chunk_size;
+    uint16_t audio_format;
     uint16_t num_channels;
     uint32_t sample_rate;
     uint16_t bits_per_sample;
@@ -23,4 +35,12 @@ void wave_write_header(FIL *file, Wave_info *info);
 
 void wave_update_header(FIL *file, Wave_info *info);
 
+/*
+    Walks the chunks of a PCM or float file and leaves the file at its samples,
+    with header_bytes and chunk_size as wave_write_header() sets them.
+    The data size is trimmed to what the file holds, so a recording cut
+    short before its header was patched still plays what made it.
+*/
+bool wave_read_header(FIL *file, Wave_info *info);
+
 #endif /* WAVE_H_ */
@@ -137,6 +137,24 @@
 #define	ABORT(fs, res)		{ fp->flag |= FA__ERROR; LEAVE_FF(fs, res); }
 
 
+/* Sector cache */
+#if _FS_CACHE
+#if _FS_TINY
+#error _FS_CACHE must be 0 on tiny cfg.
+#endif
+#define	CL_VALID	0x01	/* Line holds a sector */
+#define	CL_DIRTY	0x02	/* Line must be written back */
+#endif
+
+
+/* Deferred FAT mirror */
+#if _FS_LAZY_MIRROR && !_FS_READONLY
+#define	LAZY_MIRROR(fs)	((fs)->n_fats >= 2 && (fs)->fs_type != FS_FAT12)	/* FAT12 has no clean shutdown bit */
+#define	CLEAN16	0x8000			/* Clean shutdown bit of FAT entry 1 (FAT16) */
+#define	CLEAN32	0x08000000		/* Clean shutdown bit of FAT entry 1 (FAT32) */
+#endif
+
+
 /* File access control feature */
 #if _FS_LOCK
 #if _FS_READONLY
@@ -551,6 +569,18 @@ void mem_cpy (void* dst, const void* src, UINT cnt) {
 		*d++ = *s++;
 }
 
+/* Exchange memory with memory */
+#if _FS_CACHE
+static
+void mem_swap (void* dst, void* src, UINT cnt) {
+	BYTE *d = (BYTE*)dst, *s = (BYTE*)src, t;
+
+	while (cnt--) {
+		t = *d; *d++ = *s; *s++ = t;
+	}
+}
+#endif
+
 /* Fill memory */
 static
 void mem_set (void* dst, int val, UINT cnt) {
@@ -729,24 +759,69 @@ void clear_lock (	/* Clear lock entries of the volume */
 
 #if !_FS_READONLY
 static
-FRESULT sync_window (
-	FATFS *fs		/* File system object */
+FRESULT write_sector (
+	FATFS *fs,		/* File system object */
+	const BYTE *buf,	/* Sector data */
+	DWORD wsect		/* Sector number */
 )
 {
-	DWORD wsect;
 	UINT nf;
 
-	
+
+	if (disk_write(fs->drv, buf, wsect, 1) != RES_OK)
+		return FR_DISK_ERR;
+	if (wsect >= fs->fatbase && wsect < (fs->fatbase + fs->fsize)) {	/* In FAT area? */
+#if _FS_LAZY_MIRROR
+		if (fs->mflag) {	/* Mirror deferred: note the sector for sync_mirror */
+			wsect -= fs->fatbase;
+			if (wsect && wsect < fs->mfirst) fs->mfirst = wsect;	/* Sector 0 goes to every FAT with the clean bit */
+			if (wsect > fs->mlast) fs->mlast = wsect;
+			return FR_OK;
+		}
+#endif
+		for (nf = fs->n_fats; nf >= 2; nf--) {	/* Reflect the change to all FAT copies */
+			wsect += fs->fsize;
+			disk_write(fs->drv, buf, wsect, 1);
+		}
+	}
+	return FR_OK;
+}
+
+
+static
+FRESULT sync_window (
+	FATFS *fs		/* File system object */
+)
+{
 	if (fs->wflag) {	/* Write back the sector if it is dirty */
-		wsect = fs->winsect;	/* Current sector number */
-		if (disk_write(fs->drv, fs->win, wsect, 1) != RES_OK)
+		if (write_sector(fs, fs->win, fs->winsect) != FR_OK)
 			return FR_DISK_ERR;
 		fs->wflag = 0;
-		if (wsect >= fs->fatbase && wsect < (fs->fatbase + fs->fsize)) {	/* In FAT area? */
-			for (nf = fs->n_fats; nf >= 2; nf--) {	/* Reflect the change to all FAT copies */
-				wsect += fs->fsize;
-				disk_write(fs->drv, fs->win, wsect, 1);
-			}
+	}
+	return FR_OK;
+}
+#endif
+
+
+#if _FS_CACHE
+/* The window stays at a fixed address (directory entry pointers into it are
+/  kept across calls); sectors moved out of it are parked in the cache lines
+/  and exchanged back on a hit. */
+
+#if !_FS_READONLY
+static
+FRESULT sync_cache (	/* Write back every dirty cache line */
+	FATFS *fs		/* File system object */
+)
+{
+	UINT i;
+
+
+	for (i = 0; i < _FS_CACHE; i++) {
+		if (fs->cflag[i] & CL_DIRTY) {
+			if (write_sector(fs, fs->cbuf[i], fs->csect[i]) != FR_OK)
+				return FR_DISK_ERR;
+			fs->cflag[i] &= ~CL_DIRTY;
 		}
 	}
 	return FR_OK;
@@ -754,6 +829,94 @@ FRESULT sync_window (
 #endif
 
 
+static
+void discard_cache (	/* Drop cache lines in a sector range rewritten without the cache */
+	FATFS *fs,		/* File system object */
+	DWORD sect,		/* First sector */
+	DWORD n			/* Number of sectors (0:all lines) */
+)
+{
+	UINT i;
+
+
+	for (i = 0; i < _FS_CACHE; i++) {
+		if (!n || fs->csect[i] - sect < n) fs->cflag[i] = 0;
+	}
+	if (!n) fs->pinsect = 0;
+}
+
+
+static
+UINT take_line (	/* Line to load on a miss: a free one, else the least recently used but the pinned */
+	FATFS *fs		/* File system object */
+)
+{
+	UINT i, v;
+
+
+	v = 0;
+	for (i = 0; i < _FS_CACHE; i++) {
+		if (!(fs->cflag[i] & CL_VALID)) { v = i; break; }	/* Free line */
+		if (fs->csect[i] == fs->pinsect) continue;			/* Pinned FAT sector */
+		if (fs->csect[v] == fs->pinsect || fs->cused[i] < fs->cused[v]) v = i;
+	}
+	return v;
+}
+
+
+static
+FRESULT move_window (
+	FATFS *fs,		/* File system object */
+	DWORD sector	/* Sector number to make appearance in the fs->win[] */
+)
+{
+	UINT i, v;
+	DWORD t;
+
+
+	if (sector != fs->winsect) {	/* Changed current window */
+		for (i = 0; i < _FS_CACHE; i++) {	/* Is the sector cached? */
+			if ((fs->cflag[i] & CL_VALID) && fs->csect[i] == sector) break;
+		}
+		if (i < _FS_CACHE) {		/* Hit: exchange the window with the line */
+			v = i;
+			t = fs->cflag[v];
+			if (fs->winsect) {
+				mem_swap(fs->win, fs->cbuf[v], SS(fs));
+				fs->csect[v] = fs->winsect;
+				fs->cflag[v] = CL_VALID | (fs->wflag ? CL_DIRTY : 0);
+			} else {
+				mem_cpy(fs->win, fs->cbuf[v], SS(fs));
+				fs->cflag[v] = 0;
+			}
+			fs->wflag = (t & CL_DIRTY) ? 1 : 0;
+		} else {					/* Miss: park the window in the least recently used line */
+			v = take_line(fs);
+#if !_FS_READONLY
+			if (fs->cflag[v] & CL_DIRTY) {	/* Write back the evicted sector */
+				if (write_sector(fs, fs->cbuf[v], fs->csect[v]) != FR_OK)
+					return FR_DISK_ERR;
+			}
+#endif
+			fs->cflag[v] = 0;
+			if (fs->winsect) {
+				mem_cpy(fs->cbuf[v], fs->win, SS(fs));
+				fs->csect[v] = fs->winsect;
+				fs->cflag[v] = CL_VALID | (fs->wflag ? CL_DIRTY : 0);
+			}
+			fs->wflag = 0;
+			if (disk_read(fs->drv, fs->win, sector, 1) != RES_OK) {
+				fs->winsect = 0;		/* The window is lost, the line has its data */
+				return FR_DISK_ERR;
+			}
+		}
+		fs->cused[v] = ++fs->ctick;
+		fs->winsect = sector;
+	}
+
+	return FR_OK;
+}
+#else
 static
 FRESULT move_window (
 	FATFS *fs,		/* File system object */
@@ -772,6 +935,96 @@ FRESULT move_window (
 
 	return FR_OK;
 }
+#endif
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Deferred FAT mirror                                                   */
+/*-----------------------------------------------------------------------*/
+#if _FS_LAZY_MIRROR && !_FS_READONLY
+static
+FRESULT mark_fat (	/* Clear the clean shutdown bit in the first FAT, or set it in every FAT */
+	FATFS *fs,		/* File system object */
+	BYTE clean		/* 1:Clean, 0:Mirror stale */
+)
+{
+	FRESULT res;
+	DWORD v;
+	UINT nf;
+
+
+	res = move_window(fs, fs->fatbase);
+	if (res == FR_OK) {
+		if (fs->fs_type == FS_FAT32) {
+			v = LD_DWORD(fs->win+4);
+			v = clean ? v | CLEAN32 : v & ~CLEAN32;
+			ST_DWORD(fs->win+4, v);
+		} else {
+			v = LD_WORD(fs->win+2);
+			v = clean ? v | CLEAN16 : v & ~CLEAN16;
+			ST_WORD(fs->win+2, v);
+		}
+		fs->wflag = 1;
+		for (nf = 1; clean && nf < fs->n_fats; nf++) {	/* The mirrors first: a loss before the first FAT leaves it stale */
+			if (disk_write(fs->drv, fs->win, fs->fatbase + nf * fs->fsize, 1) != RES_OK)
+				return FR_DISK_ERR;
+		}
+		res = sync_window(fs);	/* Written through, ahead of any other FAT sector (first FAT only) */
+	}
+	return res;
+}
+
+
+static
+FRESULT sync_mirror (	/* Copy the FAT sectors changed since the mirror went stale */
+	FATFS *fs		/* File system object (window and cache must be clean) */
+)
+{
+	DWORD sect;
+	UINT nf;
+	const BYTE *buf;
+#if _FS_CACHE
+	UINT i;
+#endif
+
+
+	if (!fs->mflag) return FR_OK;
+	for (sect = fs->mfirst; sect <= fs->mlast; sect++) {	/* Copied from where it is held, else read in */
+#if _FS_CACHE
+		if (fs->fatbase + sect == fs->winsect) {
+			buf = fs->win;
+		} else {
+			for (i = 0; i < _FS_CACHE; i++) {
+				if ((fs->cflag[i] & CL_VALID) && fs->csect[i] == fs->fatbase + sect) break;
+			}
+			if (i == _FS_CACHE) {	/* Miss: loaded into one line, clean as every line is here */
+				i = take_line(fs);
+				fs->cflag[i] = 0;
+				if (disk_read(fs->drv, fs->cbuf[i], fs->fatbase + sect, 1) != RES_OK)
+					return FR_DISK_ERR;
+				fs->csect[i] = fs->fatbase + sect;
+				fs->cflag[i] = CL_VALID;
+			}
+			buf = fs->cbuf[i];
+		}
+#else
+		if (move_window(fs, fs->fatbase + sect) != FR_OK)	/* Clean window: nothing written back */
+			return FR_DISK_ERR;
+		buf = fs->win;
+#endif
+		for (nf = 1; nf < fs->n_fats; nf++) {
+			if (disk_write(fs->drv, buf, fs->fatbase + nf * fs->fsize + sect, 1) != RES_OK)
+				return FR_DISK_ERR;
+		}
+	}
+	if (mark_fat(fs, 1) != FR_OK)	/* Flag the volume clean in every FAT */
+		return FR_DISK_ERR;
+	fs->mflag = 0;
+	return FR_OK;
+}
+#endif
 
 
 
@@ -789,6 +1042,14 @@ FRESULT sync_fs (	/* FR_OK: successful, FR_DISK_ERR: failed */
 
 
 	res = sync_window(fs);
+#if _FS_CACHE
+	if (res == FR_OK)
+		res = sync_cache(fs);
+#endif
+#if _FS_LAZY_MIRROR
+	if (res == FR_OK && fs->nwrite <= 1)	/* Last file open for writing */
+		res = sync_mirror(fs);
+#endif
 	if (res == FR_OK) {
 		/* Update FSInfo sector if needed */
 		if (fs->fs_type == FS_FAT32 && fs->fsi_flag) {
@@ -897,6 +1158,14 @@ FRESULT put_fat (
 		res = FR_INT_ERR;
 
 	} else {
+#if _FS_LAZY_MIRROR
+		if (fs->nwrite && !fs->mflag && LAZY_MIRROR(fs)) {	/* First change under an open file */
+			fs->mflag = 1;
+			fs->mfirst = 0xFFFFFFFF; fs->mlast = 0;
+			res = mark_fat(fs, 0);
+			if (res != FR_OK) return res;
+		}
+#endif
 		switch (fs->fs_type) {
 		case FS_FAT12 :
 			bc = (UINT)clst; bc += bc / 2;
@@ -968,6 +1237,9 @@ FRESULT remove_chain (
 			if (nxt == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }	/* Disk error? */
 			res = put_fat(fs, clst, 0);			/* Mark the cluster "empty" */
 			if (res != FR_OK) break;
+#if _FS_EXTENTS
+			fs->xfull = 0;
+#endif
 			if (fs->free_clust != 0xFFFFFFFF) {	/* Update FSInfo */
 				fs->free_clust++;
 				fs->fsi_flag = 1;
@@ -993,6 +1265,135 @@ FRESULT remove_chain (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Free extent list                                       */
+/*-----------------------------------------------------------------------*/
+/* Every cluster allocated goes through take_extent() or trim_extents(), so
+/  the list never holds a cluster in use. Clusters freed after the scan went
+/  past them are listed again when it comes round. A scan reads past used
+/  entries to the first free run and stops at the next XSCAN_STEP boundary
+/  after it, so a mostly empty volume is not read end to end; a full volume
+/  is read once and then known to be full until a cluster is freed. */
+#if !_FS_READONLY && _FS_EXTENTS
+#define	XSCAN_STEP	256		/* Entries in a FAT16 sector, two FAT32 sectors */
+
+static
+FRESULT fill_extents (
+	FATFS *fs			/* File system object */
+)
+{
+	DWORD clst, cs, n;
+	BYTE i;
+
+
+	i = 0;
+	clst = fs->xscan;
+	if (clst < 2 || clst >= fs->n_fatent) clst = 2;
+	for (n = fs->n_fatent - 2; n; n--) {	/* At most one pass over the FAT */
+		if (i && clst % XSCAN_STEP == 0) break;	/* Free clusters listed, stop at a boundary */
+		cs = get_fat(fs, clst);
+		fs->fscan++;
+		if (cs == 1) return FR_INT_ERR;
+		if (cs == 0xFFFFFFFF) return FR_DISK_ERR;
+		if (cs == 0 && i && fs->xstart[i - 1] + fs->xlen[i - 1] == clst) {
+			fs->xlen[i - 1]++;				/* Run continues */
+		} else if (i == _FS_EXTENTS) {
+			break;							/* List is full and the last run ended */
+		} else if (cs == 0) {
+			fs->xstart[i] = clst;			/* New run */
+			fs->xlen[i] = 1;
+			i++;
+		}
+		if (++clst >= fs->n_fatent) clst = 2;
+	}
+	fs->xscan = clst;
+	fs->xcnt = i;
+	if (!n && !i) {							/* A whole pass found no free cluster */
+		fs->xfull = 1;						/* Until remove_chain() frees one */
+		fs->free_clust = 0;
+		fs->fsi_flag = 1;
+	}
+	return FR_OK;
+}
+
+
+static
+DWORD take_extent (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk error, >=2:Free cluster# */
+	FATFS *fs,			/* File system object */
+	DWORD scl			/* Cluster the new one preferably follows */
+)
+{
+	DWORD ncl;
+	BYTE i;
+
+
+	if (!fs->xcnt) {
+		if (fs->xfull) return 0;			/* A whole pass found none and none was freed since */
+		switch (fill_extents(fs)) {
+		case FR_OK: break;
+		case FR_DISK_ERR: return 0xFFFFFFFF;
+		default: return 1;
+		}
+		if (!fs->xcnt) return 0;
+	}
+	for (i = 0; i < fs->xcnt && fs->xstart[i] != scl + 1; i++) ;	/* Keep the chain contiguous if possible */
+	if (i == fs->xcnt) i = 0;
+	ncl = fs->xstart[i]++;
+	if (!--fs->xlen[i]) {					/* Extent used up */
+		for (fs->xcnt--; i < fs->xcnt; i++) {
+			fs->xstart[i] = fs->xstart[i + 1];
+			fs->xlen[i] = fs->xlen[i + 1];
+		}
+	}
+	return ncl;
+}
+
+
+static
+void trim_extents (	/* Remove a range of clusters allocated outside take_extent() */
+	FATFS *fs,			/* File system object */
+	DWORD scl,			/* First cluster */
+	DWORD n				/* Number of clusters */
+)
+{
+	DWORD end;
+	BYTE i, j;
+
+
+	for (i = 0; i < fs->xcnt; ) {
+		end = fs->xstart[i] + fs->xlen[i];
+		if (end <= scl || fs->xstart[i] >= scl + n) {	/* No overlap */
+			i++; continue;
+		}
+		if (end > scl + n) {				/* Part after the range */
+			if (fs->xstart[i] < scl && fs->xcnt < _FS_EXTENTS) {	/* Split, room for both parts */
+				for (j = fs->xcnt++; j > i + 1; j--) {
+					fs->xstart[j] = fs->xstart[j - 1];
+					fs->xlen[j] = fs->xlen[j - 1];
+				}
+				fs->xstart[i + 1] = scl + n;
+				fs->xlen[i + 1] = end - (scl + n);
+			} else if (fs->xstart[i] >= scl) {	/* Only the part after */
+				fs->xlen[i] = end - (scl + n);
+				fs->xstart[i] = scl + n;
+				i++; continue;
+			}
+		}
+		if (fs->xstart[i] < scl) {			/* Part before the range */
+			fs->xlen[i] = scl - fs->xstart[i];
+			i++; continue;
+		}
+		for (fs->xcnt--, j = i; j < fs->xcnt; j++) {	/* Nothing left */
+			fs->xstart[j] = fs->xstart[j + 1];
+			fs->xlen[j] = fs->xlen[j + 1];
+		}
+	}
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* FAT handling - Stretch or Create a cluster chain                      */
 /*-----------------------------------------------------------------------*/
@@ -1014,10 +1415,17 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 	else {					/* Stretch the current chain */
 		cs = get_fat(fs, clst);			/* Check the cluster status */
 		if (cs < 2) return 1;			/* It is an invalid cluster */
+#if _FS_CACHE
+		fs->pinsect = fs->winsect;		/* Keep the FAT sector of a growing chain cached */
+#endif
 		if (cs < fs->n_fatent) return cs;	/* It is already followed by next cluster */
 		scl = clst;
 	}
 
+#if _FS_EXTENTS
+	ncl = take_extent(fs, scl);		/* Next listed free cluster */
+	if (ncl < 2 || ncl == 0xFFFFFFFF) return ncl;
+#else
 	ncl = scl;				/* Start cluster */
 	for (;;) {
 		ncl++;							/* Next cluster */
@@ -1026,11 +1434,13 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 			if (ncl > scl) return 0;	/* No free cluster */
 		}
 		cs = get_fat(fs, ncl);			/* Get the cluster status */
+		fs->fscan++;
 		if (cs == 0) break;				/* Found a free cluster */
 		if (cs == 0xFFFFFFFF || cs == 1)/* An error occurred */
 			return cs;
 		if (ncl == scl) return 0;		/* No free cluster */
 	}
+#endif
 
 	res = put_fat(fs, ncl, 0x0FFFFFFF);	/* Mark the new cluster "last link" */
 	if (res == FR_OK && clst != 0) {
@@ -1076,6 +1486,62 @@ DWORD clmt_clust (	/* <2:Error, >=2:Cluster number */
 	}
 	return cl + *tbl;	/* Return the cluster number */
 }
+
+
+
+
+#if !_FS_READONLY
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Keep the link map table in step with the chain         */
+/*-----------------------------------------------------------------------*/
+
+static
+void clmt_append (
+	FIL* fp,		/* Pointer to the file object */
+	DWORD clst,		/* First cluster appended to the chain */
+	DWORD n			/* Number of contiguous clusters appended */
+)
+{
+	DWORD ulen, *tbl;
+
+
+	if (!fp->cltbl) return;
+	ulen = *fp->cltbl;
+	tbl = fp->cltbl + ulen - 1;		/* Terminator */
+	if (ulen > 2 && tbl[-1] + tbl[-2] == clst) {	/* Continues the last fragment? */
+		tbl[-2] += n;
+	} else if (ulen + 2 <= fp->cltsize) {	/* Room for a new fragment? */
+		*tbl++ = n; *tbl++ = clst; *tbl = 0;
+		*fp->cltbl = ulen + 2;
+	} else {
+		fp->cltbl = 0;				/* Out of room: back to normal seek mode */
+	}
+}
+
+
+static
+void clmt_trim (
+	FIL* fp,		/* Pointer to the file object */
+	DWORD ncl		/* Number of clusters left in the chain */
+)
+{
+	DWORD *tbl;
+
+
+	if (!fp->cltbl) return;
+	tbl = fp->cltbl + 1;
+	while (*tbl && ncl > *tbl) {	/* Find the fragment holding the last cluster */
+		ncl -= *tbl; tbl += 2;
+	}
+	if (*tbl) {
+		if (ncl) {					/* Shorten it */
+			*tbl = ncl; tbl += 2;
+		}
+		*tbl = 0;					/* Drop the fragments after it */
+	}
+	*fp->cltbl = (DWORD)(tbl - fp->cltbl) + 1;
+}
+#endif
 #endif	/* _USE_FASTSEEK */
 
 
@@ -1177,6 +1643,9 @@ FRESULT dir_next (	/* FR_OK:Succeeded, FR_NO_FILE:End of table, FR_DENIED:Could
 						dj->fs->winsect++;
 					}
 					dj->fs->winsect -= c;						/* Rewind window address */
+#if _FS_CACHE
+					discard_cache(dj->fs, dj->fs->winsect, c);
+#endif
 #else
 					return FR_NO_FILE;			/* Report EOT */
 #endif
@@ -2114,6 +2583,11 @@ FRESULT chk_mounted (	/* FR_OK(0): successful, !=0: any error occurred */
 	/* Following code attempts to mount the volume. (analyze BPB and initialize the fs object) */
 
 	fs->fs_type = 0;					/* Clear the file system object */
+#if _FS_CACHE
+	fs->winsect = 0;					/* Forget the sectors of an earlier mount */
+	fs->wflag = 0;
+	discard_cache(fs, 0, 0);
+#endif
 	fs->drv = LD2PD(vol);				/* Bind the logical drive and a physical drive */
 	stat = disk_initialize(fs->drv);	/* Initialize the physical drive */
 	if (stat & STA_NOINIT)				/* Check if the initialization succeeded */
@@ -2196,6 +2670,7 @@ FRESULT chk_mounted (	/* FR_OK(0): successful, !=0: any error occurred */
 	/* Initialize cluster allocation information */
 	fs->free_clust = 0xFFFFFFFF;
 	fs->last_clust = 0;
+	fs->fscan = 0;
 
 	/* Get fsinfo if available */
 	if (fmt == FS_FAT32) {
@@ -2209,11 +2684,34 @@ FRESULT chk_mounted (	/* FR_OK(0): successful, !=0: any error occurred */
 				fs->free_clust = LD_DWORD(fs->win+FSI_Free_Count);
 		}
 	}
+#if _FS_EXTENTS
+	fs->xscan = fs->last_clust;	/* Free extents are listed on the first allocation */
+	fs->xcnt = 0;
+	fs->xfull = 0;				/* The FSInfo free count is only a hint: a stale 0 still gets a scan */
+#endif
 #endif
 	fs->fs_type = fmt;		/* FAT sub-type */
 	fs->id = ++Fsid;		/* File system mount ID */
 	fs->winsect = 0;		/* Invalidate sector cache */
 	fs->wflag = 0;
+#if !_FS_READONLY && _FS_LAZY_MIRROR
+	fs->nwrite = 0;
+	fs->mflag = 0;
+	if (LAZY_MIRROR(fs) && !(stat & STA_PROTECT)) {	/* Restore a mirror left stale by a power loss */
+		if (move_window(fs, fs->fatbase) != FR_OK) {
+			fs->fs_type = 0;
+			return FR_DISK_ERR;
+		}
+		if (fmt == FS_FAT32 ? !(LD_DWORD(fs->win+4) & CLEAN32) : !(LD_WORD(fs->win+2) & CLEAN16)) {
+			fs->mflag = 1;
+			fs->mfirst = 1; fs->mlast = fs->fsize - 1;	/* Sector 0 follows with the clean bit */
+			if (sync_mirror(fs) != FR_OK) {
+				fs->fs_type = 0;
+				return FR_DISK_ERR;
+			}
+		}
+	}
+#endif
 #if _FS_RPATH
 	fs->cdir = 0;			/* Current directory (root dir) */
 #endif
@@ -2375,6 +2873,10 @@ FRESULT f_open (
 					res = remove_chain(dj.fs, cl);
 					if (res == FR_OK) {
 						dj.fs->last_clust = cl - 1;	/* Reuse the cluster hole */
+#if _FS_EXTENTS
+						dj.fs->xscan = cl;			/* List the hole first */
+						dj.fs->xcnt = 0;
+#endif
 						res = move_window(dj.fs, dw);
 					}
 				}
@@ -2398,6 +2900,10 @@ FRESULT f_open (
 #if _FS_LOCK
 			fp->lockid = inc_lock(&dj, (mode & ~FA_READ) ? 1 : 0);
 			if (!fp->lockid) res = FR_INT_ERR;
+#endif
+#if _FS_LAZY_MIRROR
+			if (res == FR_OK && (mode & FA_WRITE))	/* Defers the mirror until its close */
+				dj.fs->nwrite++;
 #endif
 		}
 
@@ -2420,6 +2926,9 @@ FRESULT f_open (
 			fp->fsize = LD_DWORD(dir+DIR_FileSize);	/* File size */
 			fp->fptr = 0;						/* File pointer */
 			fp->dsect = 0;
+#if !_FS_READONLY
+			fp->wcopy = 0;
+#endif
 #if _USE_FASTSEEK
 			fp->cltbl = 0;						/* Normal seek mode */
 #endif
@@ -2569,13 +3078,21 @@ FRESULT f_write (
 			if (!csect) {					/* On the cluster boundary? */
 				if (fp->fptr == 0) {		/* On the top of the file? */
 					clst = fp->sclust;		/* Follow from the origin */
-					if (clst == 0)			/* When no cluster is allocated, */
+					if (clst == 0) {		/* When no cluster is allocated, */
 						fp->sclust = clst = create_chain(fp->fs, 0);	/* Create a new cluster chain */
+#if _USE_FASTSEEK
+						if (clst >= 2 && clst != 0xFFFFFFFF) clmt_append(fp, clst, 1);
+#endif
+					}
 				} else {					/* Middle or end of the file */
 #if _USE_FASTSEEK
-					if (fp->cltbl)
+					if (fp->cltbl) {
 						clst = clmt_clust(fp, fp->fptr);	/* Get cluster# from the CLMT */
-					else
+						if (clst == 0) {	/* Past the mapped chain: stretch it */
+							clst = create_chain(fp->fs, fp->clust);
+							if (clst >= 2 && clst != 0xFFFFFFFF) clmt_append(fp, clst, 1);
+						}
+					} else
 #endif
 						clst = create_chain(fp->fs, fp->clust);	/* Follow or stretch cluster chain on the FAT */
 				}
@@ -2607,11 +3124,13 @@ FRESULT f_write (
 				if (fp->fs->winsect - sect < cc) {	/* Refill sector cache if it gets invalidated by the direct write */
 					mem_cpy(fp->fs->win, wbuff + ((fp->fs->winsect - sect) * SS(fp->fs)), SS(fp->fs));
 					fp->fs->wflag = 0;
+					fp->wcopy++;
 				}
 #else
 				if (fp->dsect - sect < cc) { /* Refill sector cache if it gets invalidated by the direct write */
 					mem_cpy(fp->buf, wbuff + ((fp->dsect - sect) * SS(fp->fs)), SS(fp->fs));
 					fp->flag &= ~FA__DIRTY;
+					fp->wcopy++;
 				}
 #endif
 				wcnt = SS(fp->fs) * cc;		/* Number of bytes transferred */
@@ -2642,6 +3161,7 @@ FRESULT f_write (
 		mem_cpy(&fp->buf[fp->fptr % SS(fp->fs)], wbuff, wcnt);	/* Fit partial sector */
 		fp->flag |= FA__DIRTY;
 #endif
+		fp->wcopy++;
 	}
 
 	if (fp->fptr > fp->fsize) fp->fsize = fp->fptr;	/* Update file size if needed */
@@ -2736,6 +3256,12 @@ FRESULT f_close (
 		res = dec_lock(fp->lockid);
 #endif
 	}
+#endif
+#if _FS_LAZY_MIRROR
+	if (res == FR_OK && (fp->flag & FA_WRITE) && fp->fs->nwrite) {
+		if (--fp->fs->nwrite == 0 && fp->fs->mflag)	/* Last writer closed with nothing to sync */
+			res = sync_fs(fp->fs);
+	}
 #endif
 	if (res == FR_OK) fp->fs = 0;	/* Discard file object */
 	return res;
@@ -2911,10 +3437,15 @@ FRESULT f_lseek (
 				} while (cl < fp->fs->n_fatent);	/* Repeat until end of chain */
 			}
 			*fp->cltbl = ulen;	/* Number of items used */
-			if (ulen <= tlen)
+			if (ulen <= tlen) {
 				*tbl = 0;		/* Terminate table */
-			else
+#if !_FS_READONLY
+				fp->cltsize = tlen;	/* Room left for f_write and f_reserve to extend it */
+#endif
+			} else {
 				res = FR_NOT_ENOUGH_CORE;	/* Given table size is smaller than required */
+				fp->cltbl = 0;	/* Stay in normal seek mode */
+			}
 
 		} else {						/* Fast seek */
 			if (ofs > fp->fsize)		/* Clip offset at the file size */
@@ -3242,18 +3773,25 @@ FRESULT f_truncate (
 		if (fp->fsize > fp->fptr) {
 			fp->fsize = fp->fptr;	/* Set file size to current R/W point */
 			fp->flag |= FA__WRITTEN;
-			if (fp->fptr == 0) {	/* When set file size to zero, remove entire cluster chain */
+		}
+		/* Clusters past the R/W point are removed even at the end of the file,
+		   where f_reserve() may have linked some ahead of the data */
+#if _USE_FASTSEEK
+		clmt_trim(fp, (fp->fptr + (DWORD)fp->fs->csize * SS(fp->fs) - 1) / ((DWORD)fp->fs->csize * SS(fp->fs)));
+#endif
+		if (fp->fptr == 0) {	/* When set file size to zero, remove entire cluster chain */
+			if (fp->sclust) {
 				res = remove_chain(fp->fs, fp->sclust);
 				fp->sclust = 0;
-			} else {				/* When truncate a part of the file, remove remaining clusters */
-				ncl = get_fat(fp->fs, fp->clust);
-				res = FR_OK;
-				if (ncl == 0xFFFFFFFF) res = FR_DISK_ERR;
-				if (ncl == 1) res = FR_INT_ERR;
-				if (res == FR_OK && ncl < fp->fs->n_fatent) {
-					res = put_fat(fp->fs, fp->clust, 0x0FFFFFFF);
-					if (res == FR_OK) res = remove_chain(fp->fs, ncl);
-				}
+				fp->flag |= FA__WRITTEN;
+			}
+		} else {				/* When truncate a part of the file, remove remaining clusters */
+			ncl = get_fat(fp->fs, fp->clust);
+			if (ncl == 0xFFFFFFFF) res = FR_DISK_ERR;
+			if (ncl == 1) res = FR_INT_ERR;
+			if (res == FR_OK && ncl < fp->fs->n_fatent) {
+				res = put_fat(fp->fs, fp->clust, 0x0FFFFFFF);
+				if (res == FR_OK) res = remove_chain(fp->fs, ncl);
 			}
 		}
 		if (res != FR_OK) fp->flag |= FA__ERROR;
@@ -3266,7 +3804,148 @@ FRESULT f_truncate (
 
 
 /*-----------------------------------------------------------------------*/
-/* Delete a File or Directory                                            */
+/* Reserve Contiguous Clusters Ahead of the File Data                    */
+/*-----------------------------------------------------------------------*/
+/* Links a run of free clusters that starts on an aligned sector to the end
+/  of the file's cluster chain and erases it, so a stream written later goes
+/  to whole, pre-erased allocation units. The file size is not changed;
+/  f_write() follows the chain and f_truncate() at the end of the data gives
+/  back what was not used. Clusters reserved by a file that is closed without
+/  truncation stay allocated past its end. A caller that cannot wait for the
+/  erase takes the run's first sector instead and erases it when it can. */
+
+FRESULT f_reserve (
+	FIL *fp,		/* Pointer to the file object */
+	DWORD size,		/* Number of bytes to reserve */
+	DWORD align,	/* Alignment of the first reserved sector in sectors */
+	DWORD *sect		/* First sector of the run, left unerased (NULL: erase it here) */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	DWORD n, step, first, scl, clst, last, cs, cnt;
+	BYTE wrap;
+#if _FS_EXTENTS
+	BYTE i;
+#endif
+#if _USE_ERASE
+	DWORD rt[2];
+#endif
+
+
+	res = validate(fp);						/* Check validity of the object */
+	if (res != FR_OK) LEAVE_FF(fp->fs, res);
+	if (fp->flag & FA__ERROR)				/* Check abort flag */
+		LEAVE_FF(fp->fs, FR_INT_ERR);
+	if (!(fp->flag & FA_WRITE))				/* Check access mode */
+		LEAVE_FF(fp->fs, FR_DENIED);
+	fs = fp->fs;
+
+	cs = (DWORD)fs->csize * SS(fs);			/* Bytes per cluster */
+	n = (size + cs - 1) / cs;				/* Clusters to reserve */
+	if (!n) LEAVE_FF(fs, FR_OK);
+
+	/* First cluster on an aligned sector and the stride between them */
+	if (align < fs->csize) align = fs->csize;
+	first = (align - fs->database % align) % align;
+	if (first % fs->csize || align % fs->csize) {	/* Clusters never meet the alignment */
+		first = 0; step = 1;
+	} else {
+		first /= fs->csize; step = align / fs->csize;
+	}
+	first += 2;
+
+	/* Last cluster of the file */
+	last = 0;
+	clst = fp->sclust;
+#if _USE_FASTSEEK
+	if (fp->cltbl && *fp->cltbl > 2) {		/* Taken from the link map */
+		last = fp->cltbl[*fp->cltbl - 2] + fp->cltbl[*fp->cltbl - 3] - 1;
+		clst = 0;
+	}
+#endif
+	for ( ; clst; ) {
+		cs = get_fat(fs, clst);
+		if (cs == 1) ABORT(fs, FR_INT_ERR);
+		if (cs == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+		last = clst;
+		clst = (cs < fs->n_fatent) ? cs : 0;
+	}
+
+	/* An aligned run in a listed extent, else search the aligned candidates
+	   after the file, then from the top */
+	scl = 0;
+#if _FS_EXTENTS
+	if (!fs->xcnt) {
+		res = fill_extents(fs);
+		if (res != FR_OK) ABORT(fs, res);
+	}
+	for (i = 0; i < fs->xcnt && !scl; i++) {	/* Does a listed extent hold an aligned run? */
+		cs = (fs->xstart[i] > first) ? first + (fs->xstart[i] - first + step - 1) / step * step : first;
+		if (cs + n <= fs->xstart[i] + fs->xlen[i]) scl = cs;
+	}
+#endif
+	if (!scl) {
+		scl = (last > first) ? first + (last - first + step - 1) / step * step : first;
+		wrap = 0;
+		for (;;) {
+			if (scl + n > fs->n_fatent) {
+				if (wrap) LEAVE_FF(fs, FR_DENIED);	/* No contiguous space */
+				wrap = 1; scl = first;
+				continue;
+			}
+			for (cnt = 0; cnt < n; cnt++) {
+				cs = get_fat(fs, scl + cnt);
+				fs->fscan++;
+				if (cs == 1) ABORT(fs, FR_INT_ERR);
+				if (cs == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+				if (cs) break;				/* In use */
+			}
+			if (cnt == n) break;			/* Found */
+			scl += (cnt / step + 1) * step;	/* Next candidate past the cluster in use */
+		}
+	}
+
+	/* Link the run and append it to the file's chain */
+	for (cnt = 0; cnt < n; cnt++) {
+		res = put_fat(fs, scl + cnt, (cnt + 1 < n) ? scl + cnt + 1 : 0x0FFFFFFF);
+		if (res != FR_OK) ABORT(fs, res);
+	}
+	if (last) {
+		res = put_fat(fs, last, scl);
+		if (res != FR_OK) ABORT(fs, res);
+	} else {
+		fp->sclust = scl;					/* New chain: saved to the directory on sync */
+		fp->flag |= FA__WRITTEN;
+	}
+#if _USE_FASTSEEK
+	clmt_append(fp, scl, n);
+#endif
+	fs->last_clust = scl + n - 1;			/* Update FSINFO */
+	if (fs->free_clust != 0xFFFFFFFF) {
+		fs->free_clust -= n;
+		fs->fsi_flag = 1;
+	}
+#if _FS_EXTENTS
+	trim_extents(fs, scl, n);
+#endif
+
+	if (sect) {
+		*sect = clust2sect(fs, scl);
+		LEAVE_FF(fs, FR_OK);
+	}
+#if _USE_ERASE
+	rt[0] = clust2sect(fs, scl);			/* Start sector */
+	rt[1] = rt[0] + n * fs->csize - 1;		/* End sector */
+	disk_ioctl(fs->drv, CTRL_ERASE_SECTOR, rt);	/* Erase is a hint: a card without it still works */
+#endif
+
+	LEAVE_FF(fs, FR_OK);
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 
 FRESULT f_unlink (
@@ -3385,6 +4064,9 @@ FRESULT f_mkdir (
 					if (res != FR_OK) break;
 					mem_set(dir, 0, SS(dj.fs));
 				}
+#if _FS_CACHE
+				discard_cache(dj.fs, clust2sect(dj.fs, dcl), dj.fs->csize);
+#endif
 			}
 			if (res == FR_OK) res = dir_register(&dj);	/* Register the object to the directoy */
 			if (res != FR_OK) {
@@ -3794,7 +4476,7 @@ FRESULT f_forward (
 /* Create File System on the Drive                                       */
 /*-----------------------------------------------------------------------*/
 #define N_ROOTDIR	512		/* Number of root dir entries for FAT12/16 */
-#define N_FATS		1		/* Number of FAT copies (1 or 2) */
+#define N_FATS		2		/* Number of FAT copies (1 or 2) */
 
 
 FRESULT f_mkfs (
@@ -3880,14 +4562,17 @@ FRESULT f_mkfs (
 	if (n_vol < b_data + au - b_vol) return FR_MKFS_ABORTED;	/* Too small volume */
 
 	/* Align data start sector to erase block boundary (for flash memory media) */
-	if (disk_ioctl(pdrv, GET_BLOCK_SIZE, &n) != RES_OK || !n || n > 32768) n = 1;
-	n = (b_data + n - 1) & ~(n - 1);	/* Next nearest erase block from current data start */
-	n = (n - b_data) / N_FATS;
+	if (disk_ioctl(pdrv, GET_BLOCK_SIZE, &n) != RES_OK || !n || n > 131072) n = 1;
+	while (n > 32768) n /= 2;	/* Too far to pad to: a divisor still puts the clusters on its boundaries */
+	n = (b_data + n - 1) / n * n;	/* Next nearest erase block from current data start (12 MiB and 24 MiB units are not powers of 2) */
+	n -= b_data;				/* Sectors to pad before the data area */
 	if (fmt == FS_FAT32) {		/* FAT32: Move FAT offset */
 		n_rsv += n;
 		b_fat += n;
-	} else {					/* FAT12/16: Expand FAT size */
-		n_fat += n;
+	} else {					/* FAT12/16: Expand FAT size, the odd sector to the reserved area */
+		n_rsv += n % N_FATS;
+		b_fat += n % N_FATS;
+		n_fat += n / N_FATS;
 	}
 
 	/* Determine number of clusters and final check of validity of the FAT sub-type */
@@ -0,0 +1,154 @@
+#include <stdint.h>
+#include <string.h>
+#include "peaks.h"
+#include "sidecar.h"
+#include "ff.h"
+
+/*
+    Records go to the file a few at a time; the file's sector buffer
+    takes them on to the card.
+*/
+#define PEAKS_BATCH 8
+
+static struct Record
+{
+    int32_t min;
+    int32_t max;
+    uint64_t squares;
+    uint32_t count;
+
+}   record;
+
+static uint8_t batch[PEAKS_BATCH * PEAKS_RECORD];
+static uint32_t batched;
+static uint32_t records;
+static Sidecar sidecar = { .status = FR_NO_FILE };
+
+static uint32_t square_root(uint32_t value)
+{
+    uint32_t root = 0;
+    for (uint32_t bit = 1UL << 30; bit; bit >>= 2)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+    }
+    return root;
+}
+
+static void start_record(void)
+{
+    record.min = INT16_MAX;
+    record.max = INT16_MIN;
+    record.squares = 0;
+    record.count = 0;
+}
+
+static FRESULT flush(void)
+{
+    FRESULT result = batched ? sidecar_write(&sidecar, batch, batched * PEAKS_RECORD) : sidecar.status;
+    batched = 0;
+    return result;
+}
+
+static void end_record(void)
+{
+    uint8_t *p = batch + batched * PEAKS_RECORD;
+    sidecar_put_uint16(p, (uint32_t)record.min);
+    sidecar_put_uint16(p + 2, (uint32_t)record.max);
+    sidecar_put_uint16(p + 4, square_root((uint32_t)(record.squares / record.count)));
+    batched++;
+    records++;
+    start_record();
+}
+
+FRESULT peaks_open(const TCHAR *wave, const Wave_info *info)
+{
+    start_record();
+    batched = 0;
+    records = 0;
+    uint8_t header[PEAKS_HEADER];
+    memcpy(header, "PKS1", 4);
+    sidecar_put_uint32(header + 4, info->sample_rate);
+    sidecar_put_uint16(header + 8, PEAKS_SAMPLES);
+    sidecar_put_uint16(header + 10, PEAKS_RECORD);
+    sidecar_put_uint32(header + 12, 0);
+    return sidecar_open(&sidecar, wave, "PKS", header, sizeof header);
+}
+
+FRESULT peaks_add(const void *samples, uint32_t bytes)
+{
+    if (sidecar.status != FR_OK)
+    {
+        return sidecar.status;
+    }
+    const int16_t *sample = samples;
+    for (uint32_t left = bytes / 2; left; )
+    {
+        uint32_t run = PEAKS_SAMPLES - record.count;
+        if (run > left)
+        {
+            run = left;
+        }
+        /*
+            Locals, so the loop keeps everything in registers: a
+            compare each way and a multiply-accumulate per sample.
+        */
+        int32_t min = record.min;
+        int32_t max = record.max;
+        uint64_t squares = record.squares;
+        for (uint32_t i = 0; i < run; i++)
+        {
+            int32_t value = sample[i];
+            if (value < min)
+            {
+                min = value;
+            }
+            if (value > max)
+            {
+                max = value;
+            }
+            squares += (uint32_t)(value * value);
+        }
+        record.min = min;
+        record.max = max;
+        record.squares = squares;
+        record.count += run;
+        sample += run;
+        left -= run;
+        if (record.count == PEAKS_SAMPLES)
+        {
+            end_record();
+            if (batched == PEAKS_BATCH && flush() != FR_OK)
+            {
+                return sidecar.status;
+            }
+        }
+    }
+    return FR_OK;
+}
+
+FRESULT peaks_close(void)
+{
+    if (sidecar.status != FR_OK)
+    {
+        return sidecar.status;
+    }
+    if (record.count)
+    {
+        end_record();
+    }
+    FRESULT result = flush();
+    return result == FR_OK ? sidecar_close(&sidecar, 12, records) : result;
+}
+
+uint32_t peaks_records(void)
+{
+    return records;
+}
@@ -0,0 +1,107 @@
+#include <stdint.h>
+#include <string.h>
+#include "sidecar.h"
+#include "ff.h"
+
+#define SIDECAR_PATH 64
+
+void sidecar_put_uint16(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+void sidecar_put_uint32(uint8_t *p, uint32_t value)
+{
+    sidecar_put_uint16(p, value);
+    sidecar_put_uint16(p + 2, value >> 16);
+}
+
+static FRESULT fail(Sidecar *sidecar, FRESULT result)
+{
+    sidecar->status = result;
+    f_close(&sidecar->file);
+    return result;
+}
+
+static FRESULT store(Sidecar *sidecar, const void *data, UINT bytes)
+{
+    UINT written;
+    FRESULT result = f_write(&sidecar->file, data, bytes, &written);
+    if (result == FR_OK && written != bytes)
+    {
+        result = FR_DENIED;
+    }
+    return result == FR_OK ? FR_OK : fail(sidecar, result);
+}
+
+FRESULT sidecar_open(Sidecar *sidecar, const TCHAR *wave, const char *extension, const void *header, UINT bytes)
+{
+    TCHAR path[SIDECAR_PATH];
+    size_t length = wave ? strlen(wave) : 0;
+    if (length < 4 || length >= sizeof path || wave[length - 4] != '.')
+    {
+        return sidecar->status = FR_INVALID_NAME;
+    }
+    memcpy(path, wave, length - 3);
+    memcpy(path + length - 3, extension, 4);
+    sidecar->synced = 0;
+    sidecar->status = f_open(&sidecar->file, path, FA_CREATE_ALWAYS|FA_WRITE);
+    return sidecar->status == FR_OK ? sidecar_write(sidecar, header, bytes) : sidecar->status;
+}
+
+FRESULT sidecar_write(Sidecar *sidecar, const void *data, UINT bytes)
+{
+    if (sidecar->status != FR_OK)
+    {
+        return sidecar->status;
+    }
+    FRESULT result = store(sidecar, data, bytes);
+    if (result == FR_OK && sidecar->file.clust != sidecar->synced)
+    {
+        sidecar->synced = sidecar->file.clust;
+        result = f_sync(&sidecar->file);
+        if (result != FR_OK)
+        {
+            fail(sidecar, result);
+        }
+    }
+    return result;
+}
+
+FRESULT sidecar_close(Sidecar *sidecar, DWORD offset, uint32_t count)
+{
+    if (sidecar->status != FR_OK)
+    {
+        return sidecar->status;
+    }
+    /*
+        The size goes down before the count: a supply that fails in
+        between leaves the count 0 over whole records, never a count
+        the file is too short for.
+    */
+    FRESULT result = f_truncate(&sidecar->file);
+    if (result == FR_OK)
+    {
+        result = f_sync(&sidecar->file);
+    }
+    if (result == FR_OK)
+    {
+        result = f_lseek(&sidecar->file, offset);
+    }
+    if (result == FR_OK)
+    {
+        uint8_t patch[4];
+        sidecar_put_uint32(patch, count);
+        result = store(sidecar, patch, sizeof patch);
+    }
+    if (result == FR_OK)
+    {
+        result = f_close(&sidecar->file);
+    }
+    if (sidecar->status == FR_OK)
+    {
+        sidecar->status = result == FR_OK ? FR_NO_FILE : fail(sidecar, result);
+    }
+    return result;
+}
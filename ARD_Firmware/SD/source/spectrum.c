@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <string.h>
+#include "spectrum.h"
+#include "fft.h"
+#include "sidecar.h"
+#include "ff.h"
+
+/*
+    A block's worth of records at a time; the file's sector buffer
+    takes them on to the card.
+*/
+#define SPECTRUM_BATCH 4
+
+/*
+    A bin each while a quarter octave is narrower, then 2^(b / 4) on to
+    half the sample rate.
+*/
+static const uint16_t edge[SPECTRUM_BANDS + 1] =
+{
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+    17, 19, 23, 27, 32, 38, 45, 54, 64, 76, 91, 108, 128, 152, 181, 215,
+    256
+};
+
+static uint8_t batch[SPECTRUM_BATCH * SPECTRUM_BANDS];
+static uint32_t batched;
+static uint32_t records;
+static Sidecar sidecar = { .status = FR_NO_FILE };
+
+/*
+    4 log2(energy): the position of the top bit and the two below it.
+*/
+static uint8_t level(uint64_t energy)
+{
+    if (!energy)
+    {
+        return 0;
+    }
+    uint32_t top = 63;
+    while (!(energy >> top))
+    {
+        top--;
+    }
+    uint32_t fraction = (uint32_t)(top >= 2 ? energy >> (top - 2) : energy << (2 - top)) & 3;
+    return (uint8_t)(4 * top + fraction);
+}
+
+static FRESULT flush(void)
+{
+    FRESULT result = batched ? sidecar_write(&sidecar, batch, batched * SPECTRUM_BANDS) : sidecar.status;
+    batched = 0;
+    return result;
+}
+
+FRESULT spectrum_open(const TCHAR *wave, const Wave_info *info)
+{
+    batched = 0;
+    records = 0;
+    uint8_t header[SPECTRUM_HEADER];
+    memcpy(header, "SPC1", 4);
+    sidecar_put_uint32(header + 4, info->sample_rate);
+    sidecar_put_uint16(header + 8, FFT_SAMPLES);
+    sidecar_put_uint16(header + 10, SPECTRUM_BANDS);
+    sidecar_put_uint32(header + 12, 0);
+    for (uint32_t b = 0; b <= SPECTRUM_BANDS; b++)
+    {
+        sidecar_put_uint16(header + 16 + 2 * b, edge[b]);
+    }
+    return sidecar_open(&sidecar, wave, "SPC", header, sizeof header);
+}
+
+FRESULT spectrum_add(void *samples, uint32_t bytes)
+{
+    if (sidecar.status != FR_OK)
+    {
+        return sidecar.status;
+    }
+    uint8_t *frame = samples;
+    for (uint32_t left = bytes / (2 * FFT_SAMPLES); left; left--)
+    {
+        fft_power(frame);
+        const uint32_t *power = (const uint32_t *)frame;
+        uint8_t *record = batch + batched * SPECTRUM_BANDS;
+        for (uint32_t b = 0; b < SPECTRUM_BANDS; b++)
+        {
+            uint64_t energy = 0;
+            for (uint32_t k = edge[b]; k < edge[b + 1]; k++)
+            {
+                energy += power[fft_index(k)];
+            }
+            record[b] = level(energy);
+        }
+        batched++;
+        records++;
+        frame += 2 * FFT_SAMPLES;
+        if (batched == SPECTRUM_BATCH && flush() != FR_OK)
+        {
+            return sidecar.status;
+        }
+    }
+    return FR_OK;
+}
+
+FRESULT spectrum_close(void)
+{
+    if (sidecar.status != FR_OK)
+    {
+        return sidecar.status;
+    }
+    FRESULT result = flush();
+    return result == FR_OK ? sidecar_close(&sidecar, 12, records) : result;
+}
+
+uint32_t spectrum_records(void)
+{
+    return records;
+}
@@ -1,7 +1,12 @@
 #include <stdint.h>
 #include "diskio.h"
+#include "alarm.h"
 #include "ssi.h"
 #include "gpio.h"
+#include "ramfunc.h"
+#ifdef SD_DMA
+#include "udma.h"
+#endif
 
 enum Mmc_command
 {
@@ -11,12 +16,16 @@ enum Mmc_command
     CMD9  = 0x40+9,  // SEND_CSD
     CMD10 = 0x40+10, // SEND_CID
     CMD12 = 0x40+12, // STOP_TRANSMISSION
+    CMD13 = 0x40+13, // SD_STATUS (ACMD)
     CMD16 = 0x40+16, // SET_BLOCKLEN
     CMD17 = 0x40+17, // READ_SINGLE_BLOCK
     CMD18 = 0x40+18, // READ_MULTIPLE_BLOCK
     CMD23 = 0x40+23, // SET_BLOCK_COUNT
     CMD24 = 0x40+24, // WRITE_BLOCK
     CMD25 = 0x40+25, // WRITE_MULTIPLE_BLOCK
+    CMD32 = 0x40+32, // ERASE_WR_BLK_START
+    CMD33 = 0x40+33, // ERASE_WR_BLK_END
+    CMD38 = 0x40+38, // ERASE
     CMD41 = 0x40+41, // SEND_OP_COND (ACMD)
     CMD55 = 0x40+55, // APP_CMD
     CMD58 = 0x40+58, // READ_OCR
@@ -25,28 +34,45 @@ enum Mmc_command
 struct Disk
 {
     volatile DSTATUS status; // Disk status
-    volatile BYTE timer1;    // 100Hz decrement timer
-    volatile BYTE timer2;    // 100Hz decrement timer
     BYTE card_type;          // b0:MMC, b1:SDC, b2:Block addressing
+    DWORD au;                // Allocation unit in sectors, 0 until read
+    DWORD erase_ms;          // Longest erase of one unit the card allows
     BYTE power_flag;         // indicates if "power" is on
 };
 
 static struct Disk disk =
 {
     .status = STA_NOINIT,
-    .timer1 = 0,
-    .timer2 = 0,
     .card_type = 0,
+    .au = 0,
+    .erase_ms = 0,
     .power_flag = 0,
 };
 
 static Gpio *portd;
 static Ssi  *ssi1;
 
+/*
+    Built with SD_DMA, data blocks are received by uDMA: the transmit
+    channel feeds 0xFF from a constant and the receive channel, which
+    wins arbitration so the receive FIFO cannot overrun, drains into the
+    buffer. Otherwise they are received with a FIFO burst.
+*/
+#ifdef SD_DMA
+static Udma *udma;
+static Udma_control udma_table[UDMA_CHANNEL_SSI1_TX + 1] __attribute__((aligned(UDMA_TABLE_ALIGN)));
+static const uint8_t udma_fill = 0xFF;
+#endif
+
 static void init(void)
 {
     portd = gpio_address(GPIO_PORTD);
     ssi1  = ssi_address(SSI_MOD1);
+#ifdef SD_DMA
+    udma  = udma_address();
+    udma_enable(udma, udma_table);
+    udma_set_priority(udma, UDMA_CHANNEL_SSI1_RX, true);
+#endif
 }
 
 /*
@@ -69,34 +95,52 @@ static void DESELECT(void)
     gpio_write_high(portd, GPIO_BIT1);
 }
 
-static void xmit_spi(BYTE dat)
+RAMFUNC static void xmit_spi(BYTE dat)
 {
-    uint32_t dummy = ssi_write(ssi1, dat);
+    ssi_write(ssi1, dat);
 }
 
-static BYTE rcvr_spi(void)
+RAMFUNC static BYTE rcvr_spi(void)
 {
     return (BYTE)ssi_write(ssi1, 0xFF);
 }
 
-static void rcvr_spi_m(BYTE *dst)
+RAMFUNC static void rcvr_spi_m(BYTE *dst, UINT count)
 {
-    *dst = rcvr_spi();
+#ifdef SD_DMA
+    udma_transfer(udma, UDMA_CHANNEL_SSI1_RX, ssi_data(ssi1), UDMA_INCREMENT_NONE, dst, UDMA_INCREMENT_BYTE, count);
+    udma_transfer(udma, UDMA_CHANNEL_SSI1_TX, &udma_fill, UDMA_INCREMENT_NONE, ssi_data(ssi1), UDMA_INCREMENT_NONE, count);
+    ssi_enable_dma(ssi1, true);
+    while (udma_busy(udma, UDMA_CHANNEL_SSI1_RX))
+    {
+        // Receive channel done once the last byte is in the buffer
+    }
+    ssi_enable_dma(ssi1, false);
+#else
+    ssi_read_burst(ssi1, dst, count);
+#endif
 }
 
-static BYTE wait_ready(void)
+/*
+    Busy timeouts in milliseconds: any command or data block, and an
+    erase, which the SD specification lets take 250 ms per allocation
+    unit. Data tokens and initialisation have their own below.
+*/
+#define READY_MS 500
+#define ERASE_MS 30000
+#define TOKEN_MS 100
+#define INIT_MS  1000
+
+static BYTE wait_ready(DWORD millisecond)
 {
     BYTE res;
-    /*
-        Wait for ready in timeout of 500ms
-    */
-    disk.timer2 = 50;
+    DWORD deadline = alarm_now() + millisecond;
     rcvr_spi();
     do
     {
         res = rcvr_spi();
     }
-    while ((res != 0xFF) && disk.timer2);
+    while ((res != 0xFF) && !alarm_expired(deadline));
     return res;
 }
 
@@ -115,7 +159,7 @@ static void send_initial_clock_train(void)
     */
     for(uint32_t i = 0 ; i < 10 ; i++)
     {
-        uint32_t dummy = ssi_write(ssi1, 0xFF);
+        ssi_write(ssi1, 0xFF);
     }
     /*
         Revert to hardware control of the SSI TX line.
@@ -133,13 +177,14 @@ static void power_on (void)
         accept a native command.
     */
     init();
+    ssi_set_rate(ssi1, SPI_SLOW_HZ);
     send_initial_clock_train();
     disk.power_flag = 1;
 }
 
 static void set_max_speed(void)
 {
-
+    ssi_set_rate(ssi1, SPI_FAST_HZ);
 }
 
 static void power_off (void)
@@ -155,36 +200,31 @@ static int chk_power(void)
     return disk.power_flag;
 }
 
-static BOOL rcvr_datablock(BYTE *buff, UINT btr)
+RAMFUNC static BOOL rcvr_datablock(BYTE *buff, UINT btr)
 {
     /*
         BYTE *buff : Data buffer to store received data
-        UINT btr   : Byte count (must be even number)
+        UINT btr   : Byte count
     */
     BYTE token;
-    disk.timer1 = 100;
-    do // Wait for data packet in timeout of 100ms
+    DWORD deadline = alarm_now() + TOKEN_MS;
+    do // Wait for data packet
     {
         token = rcvr_spi();
     }
-    while ((token == 0xFF) && disk.timer1);
+    while ((token == 0xFF) && !alarm_expired(deadline));
     if(token != 0xFE)
     {
         return FALSE; // If not valid data token, retutn with error
     }
-    do // Receive the data block into buffer
-    {
-        rcvr_spi_m(buff++);
-        rcvr_spi_m(buff++);
-    }
-    while (btr -= 2);
+    rcvr_spi_m(buff, btr); // Receive the data block into buffer
     rcvr_spi(); // Discard CRC
     rcvr_spi();
     return TRUE; // Return with success
 }
 
 #if _READONLY == 0
-static BOOL xmit_datablock(const BYTE *buff, BYTE token)
+RAMFUNC static BOOL xmit_datablock(const BYTE *buff, BYTE token)
 {
     /*
         const BYTE *buff : 512 byte data block to be transmitted
@@ -192,7 +232,7 @@ static BOOL xmit_datablock(const BYTE *buff, BYTE token)
     */
     BYTE resp;
     BYTE wc;
-    if (wait_ready() != 0xFF)
+    if (wait_ready(READY_MS) != 0xFF)
     {
         return FALSE;
     }
@@ -226,7 +266,7 @@ static BYTE send_cmd(BYTE cmd, DWORD arg)
     */
     BYTE n;
     BYTE res;
-    if (wait_ready() != 0xFF)
+    if (wait_ready(READY_MS) != 0xFF)
     {
         return 0xFF;
     }
@@ -307,6 +347,7 @@ DSTATUS disk_initialize(BYTE drv)
     BYTE n;
     BYTE ty;
     BYTE ocr[4];
+    DWORD deadline;
     if (drv) // Supports only single drive
     {
         return STA_NOINIT;
@@ -321,7 +362,7 @@ DSTATUS disk_initialize(BYTE drv)
     ty = 0;
     if (send_cmd(CMD0, 0) == 1) // Enter Idle state
     {
-        disk.timer1 = 100; // Initialization timeout of 1000 msec
+        deadline = alarm_now() + INIT_MS;
         if (send_cmd(CMD8, 0x1AA) == 1) // SDC Ver2+
         {
             for (n = 0; n < 4; n++)
@@ -337,8 +378,8 @@ DSTATUS disk_initialize(BYTE drv)
                         break; // ACMD41 with HCS bit
                     }
                 }
-                while (disk.timer1);
-                if (disk.timer1 && send_cmd(CMD58, 0) == 0) // Check CCS bit
+                while (!alarm_expired(deadline));
+                if (!alarm_expired(deadline) && send_cmd(CMD58, 0) == 0) // Check CCS bit
                 {
                     for (n = 0; n < 4; n++)
                     {
@@ -368,14 +409,15 @@ DSTATUS disk_initialize(BYTE drv)
                     }
                 }
             }
-            while (disk.timer1);
-            if (!disk.timer1 || send_cmd(CMD16, 512) != 0) // Select R/W block length
+            while (!alarm_expired(deadline));
+            if (alarm_expired(deadline) || send_cmd(CMD16, 512) != 0) // Select R/W block length
             {
                 ty = 0;
             }
         }
     }
     disk.card_type = ty;
+    disk.au = 0;
     DESELECT();
     rcvr_spi(); // Idle (Release DO)
     if (ty) // Initialization success
@@ -510,6 +552,56 @@ DRESULT disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count)
 }
 #endif /* _READONLY */
 
+/*
+    Erase time the SD specification allows for each allocation unit when
+    the card leaves its erase timeout undefined.
+*/
+#define ERASE_UNIT_MS 250
+
+/*
+    Allocation unit in sectors for each AU_SIZE code: 16 KiB doubling up
+    to 16 MiB, except that SD 3.0 fills in 12 MiB and 24 MiB between the
+    larger ones and ends at 64 MiB.
+*/
+static const DWORD au_sectors[16] =
+{
+    0, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384,
+    24576, 32768, 49152, 65536, 131072
+};
+
+static void read_sd_status(void)
+{
+    /*
+        Allocation unit in sectors and the erase timeout from the SD
+        status (ACMD13), of which only the first 16 bytes are kept. MMC,
+        and cards that leave AU_SIZE undefined, report no unit. The
+        timeout is ERASE_TIMEOUT seconds for ERASE_SIZE units plus
+        ERASE_OFFSET seconds once.
+    */
+    BYTE n;
+    BYTE sds[16];
+    WORD size;
+    disk.au = 0;
+    disk.erase_ms = ERASE_UNIT_MS;
+    if ((disk.card_type & 2) && send_cmd(CMD55, 0) <= 1 && send_cmd(CMD13, 0) == 0)
+    {
+        rcvr_spi(); // Second byte of the R2 response
+        if (rcvr_datablock(sds, 16))
+        {
+            for (n = 64 - 16; n; n--)
+            {
+                rcvr_spi(); // Purge the rest of the status
+            }
+            disk.au = au_sectors[sds[10] >> 4];
+            size = (WORD)sds[11] << 8 | sds[12];
+            if (size && (sds[13] >> 2))
+            {
+                disk.erase_ms = 1000UL * (sds[13] >> 2) / size + 1000UL * (sds[13] & 3);
+            }
+        }
+    }
+}
+
 DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
 {
     /*
@@ -522,6 +614,8 @@ DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
     BYTE csd[16];
     BYTE *ptr = buff;
     WORD csize;
+    DWORD st;
+    DWORD ed;
     if (drv)
     {
         return RES_PARERR;
@@ -580,8 +674,64 @@ DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
             *(WORD*)buff = 512;
             res = RES_OK;
             break;
+        case GET_BLOCK_SIZE: // Get erase block size in unit of sector (DWORD)
+            if (!disk.au)
+            {
+                read_sd_status();
+            }
+            if (disk.au) // Otherwise FatFs falls back to single sectors
+            {
+                *(DWORD*)buff = disk.au;
+                res = RES_OK;
+            }
+            break;
+        case MMC_GET_ERASE_TIME: // Get erase time of one allocation unit in ms (DWORD)
+            if (!disk.au)
+            {
+                read_sd_status();
+            }
+            if (disk.au)
+            {
+                *(DWORD*)buff = disk.erase_ms;
+                res = RES_OK;
+            }
+            break;
+        case CTRL_ERASE_SECTOR: // Erase a block of sectors (DWORD[2]: first, last)
+            /*
+                Only the whole allocation units in the range are erased:
+                part of one costs the card as much as all of it and saves
+                nothing on later writes, so a range without a whole unit,
+                such as a fragment of a deleted file, is left alone.
+            */
+            if (!disk.au)
+            {
+                read_sd_status();
+            }
+            if (!disk.au)
+            {
+                break;
+            }
+            st = (((DWORD*)buff)[0] + disk.au - 1) / disk.au * disk.au; // Not always a power of 2
+            ed = (((DWORD*)buff)[1] + 1) / disk.au * disk.au;
+            if (st >= ed)
+            {
+                res = RES_OK;
+                break;
+            }
+            ed--;
+            if (!(disk.card_type & 4)) // Byte addressing
+            {
+                st *= 512;
+                ed *= 512;
+            }
+            if ((disk.card_type & 2) && send_cmd(CMD32, st) == 0 && send_cmd(CMD33, ed) == 0 &&
+                send_cmd(CMD38, 0) == 0 && wait_ready(ERASE_MS) == 0xFF)
+            {
+                res = RES_OK;
+            }
+            break;
         case CTRL_SYNC: // Make sure that data has been written
-            if (wait_ready() == 0xFF)
+            if (wait_ready(READY_MS) == 0xFF)
             {
                 res = RES_OK;
             }
@@ -608,6 +758,16 @@ DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
                 res = RES_OK;
             }
             break; // ADDED BY ME!
+        case MMC_GET_SDSTAT: // Receive SD status as a data block (64 bytes)
+            if ((disk.card_type & 2) && send_cmd(CMD55, 0) <= 1 && send_cmd(CMD13, 0) == 0)
+            {
+                rcvr_spi(); // Second byte of the R2 response
+                if (rcvr_datablock(ptr, 64))
+                {
+                    res = RES_OK;
+                }
+            }
+            break;
         default:
             res = RES_PARERR;
         }
@@ -617,24 +777,6 @@ DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
     return res;
 }
 
-void disk_timerproc(void)
-{
-    /*
-        This function must be called in period of 10ms
-    */
-    BYTE n;
-    n = disk.timer1;
-    if (n)
-    {
-        disk.timer1 = --n;
-    }
-    n = disk.timer2;
-    if (n)
-    {
-        disk.timer2 = --n;
-    }
-}
-
 DWORD get_fattime(void)
 {
     /*
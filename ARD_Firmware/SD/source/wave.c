@@ -1,27 +1,40 @@
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include "wave.h"
 #include "ff.h"
 
+/*
+    Raw little-endian bytes: f_putc would expand a 0x0A byte to CR LF
+    (_USE_STRFUNC 2) and shift the rest of the header.
+*/
 static void write_uint16(FIL* file, uint32_t bytes)
 {
+    uint8_t buff[2];
+    UINT written;
     for (uint8_t i = 0, j = 0; i < 2; i += 1, j += 8)
     {
-        f_putc((bytes >> j), file);
+        buff[i] = (uint8_t)(bytes >> j);
     }
+    f_write(file, buff, sizeof(buff), &written);
 }
 
 static void write_uint32(FIL* file, uint32_t bytes)
 {
+    uint8_t buff[4];
+    UINT written;
     for (uint8_t i = 0, j = 0; i < 4; i += 1, j += 8)
     {
-        f_putc((bytes >> j), file);
+        buff[i] = (uint8_t)(bytes >> j);
     }
+    f_write(file, buff, sizeof(buff), &written);
 }
 
 void wave_write_header(FIL* file, Wave_info *info)
 {
     info->header_bytes = 0;
     info->chunk_size = 0;
+    UINT written;
     /**********************************************************
         (4) chunk_id:
 
@@ -29,7 +42,7 @@ void wave_write_header(FIL* file, Wave_info *info)
         0x52494646 big-endian form.
     ***********************************************************/
     uint8_t chunk_id[] = {'R','I','F','F'};
-    f_write(file, chunk_id, sizeof(chunk_id), 0);
+    f_write(file, chunk_id, sizeof(chunk_id), &written);
 
     /**********************************************************
         (4) chunk_size :
@@ -51,7 +64,7 @@ void wave_write_header(FIL* file, Wave_info *info)
         0x57415645 big-endian form.
     ***********************************************************/
     uint8_t format[] = {'W','A','V','E'};
-    f_write(file, format, sizeof(format), 0);
+    f_write(file, format, sizeof(format), &written);
     info->header_bytes += sizeof(format);
 
     /**********************************************************
@@ -61,7 +74,7 @@ void wave_write_header(FIL* file, Wave_info *info)
         0x666D7420 big-endian form.
     ***********************************************************/
     uint8_t sub_chunk1_id[] = {'f','m','t',' '};
-    f_write(file, sub_chunk1_id, sizeof(sub_chunk1_id), 0);
+    f_write(file, sub_chunk1_id, sizeof(sub_chunk1_id), &written);
     info->header_bytes += sizeof(sub_chunk1_id);
 
     /**********************************************************
@@ -77,12 +90,11 @@ void wave_write_header(FIL* file, Wave_info *info)
     /**********************************************************
         (4) audio_format :
 
-        PCM = 1 (i.e. Linear quantization)
-        Values other than 1 indicate some form of compression.
+        PCM = 1 (i.e. Linear quantization), IEEE float = 3.
+        Other values indicate some form of compression.
     ***********************************************************/
-    uint16_t audio_format = 1;
-    write_uint16(file, audio_format);
-    info->header_bytes += sizeof(audio_format);
+    write_uint16(file, info->audio_format);
+    info->header_bytes += sizeof(info->audio_format);
 
     /**********************************************************
         (2) num_channels :
@@ -127,6 +139,23 @@ void wave_write_header(FIL* file, Wave_info *info)
     write_uint16(file, info->bits_per_sample);
     info->header_bytes += sizeof(info->bits_per_sample);
 
+    /**********************************************************
+        (4) junk_id, (4) junk_size, (junk_size) padding :
+
+        Contains the letters "JUNK", then zeros sized so the
+        samples start at WAVE_DATA_OFFSET. Readers skip
+        chunks they do not know.
+    ***********************************************************/
+    uint8_t junk_id[] = {'J','U','N','K'};
+    f_write(file, junk_id, sizeof(junk_id), &written);
+    uint32_t junk_size = WAVE_DATA_OFFSET - (8 + info->header_bytes) - 8 - 8;
+    write_uint32(file, junk_size);
+    for (uint32_t i = 0; i < junk_size; i += sizeof(uint32_t))
+    {
+        write_uint32(file, 0);
+    }
+    info->header_bytes += sizeof(junk_id) + sizeof(junk_size) + junk_size;
+
     /**********************************************************
         (4) sub_chunk2_id :
 
@@ -134,7 +163,7 @@ void wave_write_header(FIL* file, Wave_info *info)
         0x64617461 big-endian form.
     ***********************************************************/
     uint8_t sub_chunk2_id[] = {'d','a','t','a'};
-    f_write(file, sub_chunk2_id, sizeof(sub_chunk2_id), 0);
+    f_write(file, sub_chunk2_id, sizeof(sub_chunk2_id), &written);
     info->header_bytes += sizeof(sub_chunk2_id);
 
     /**********************************************************
@@ -156,7 +185,70 @@ void wave_update_header(FIL *file, Wave_info *info)
     f_lseek(file, chunk_size_position);
     write_uint32(file, info->chunk_size);
 
-    DWORD sub_chunk2_size = 40;
+    DWORD sub_chunk2_size = 8 + info->header_bytes - 4;
     f_lseek(file, sub_chunk2_size);
     write_uint32(file, info->chunk_size - info->header_bytes);
 }
+
+static uint32_t read_le(const uint8_t *buff, uint8_t bytes)
+{
+    uint32_t value = 0;
+    for (uint8_t i = bytes; i; i--)
+    {
+        value = value << 8 | buff[i - 1];
+    }
+    return value;
+}
+
+bool wave_read_header(FIL *file, Wave_info *info)
+{
+    uint8_t buff[16];
+    UINT read;
+    if (f_read(file, buff, 12, &read) != FR_OK || read != 12 ||
+        memcmp(buff, "RIFF", 4) || memcmp(buff + 8, "WAVE", 4))
+    {
+        return false;
+    }
+    bool format = false;
+    for (;;)
+    {
+        if (f_read(file, buff, 8, &read) != FR_OK || read != 8)
+        {
+            return false;
+        }
+        uint32_t size = read_le(buff + 4, 4);
+        if (!memcmp(buff, "data", 4))
+        {
+            break;
+        }
+        DWORD next = file->fptr + size + (size & 1);
+        if (!memcmp(buff, "fmt ", 4) && size >= 16)
+        {
+            if (f_read(file, buff, 16, &read) != FR_OK || read != 16 ||
+                (read_le(buff, 2) != WAVE_FORMAT_PCM && read_le(buff, 2) != WAVE_FORMAT_FLOAT))
+            {
+                return false;
+            }
+            info->audio_format = (uint16_t)read_le(buff, 2);
+            info->num_channels = (uint16_t)read_le(buff + 2, 2);
+            info->sample_rate = read_le(buff + 4, 4);
+            info->bits_per_sample = (uint16_t)read_le(buff + 14, 2);
+            format = true;
+        }
+        if (f_lseek(file, next) != FR_OK || file->fptr != next)
+        {
+            return false;
+        }
+    }
+    /*
+        Everything past RIFF and its size, as when written.
+    */
+    uint32_t size = read_le(buff + 4, 4);
+    info->header_bytes = file->fptr - 8;
+    if (!size || size > file->fsize - file->fptr)
+    {
+        size = file->fsize - file->fptr;
+    }
+    info->chunk_size = info->header_bytes + size;
+    return format;
+}
@@ -0,0 +1,191 @@
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gpio.h"
+#include "nvic.h"
+#include "ssi.h"
+#include "timer.h"
+
+/*
+    Host simulation of the recorder. The firmware modules are compiled
+    unchanged against simulated Hardware drivers; simulated time only
+    moves when a driver touches a peripheral (sim_advance), and due
+    timer/ADC/pin events fire their ISRs at that point.
+
+    Time is kept in picoseconds so it stays exact across clock changes.
+*/
+
+#define SIM_PS_PER_SECOND 1000000000000ULL
+#define SIM_PS_PER_MS     1000000000ULL
+#define SIM_PS_PER_US     1000000ULL
+#define SIM_NEVER         UINT64_MAX
+
+/*
+    Cycle cost of a bus access to a peripheral register and of
+    exception entry/exit on the Cortex-M4.
+*/
+#define SIM_BUS_CYCLES       2
+#define SIM_EXCEPTION_CYCLES 12
+
+typedef enum
+{
+    SIM_SIGNAL_RAMP,
+    SIM_SIGNAL_SINE,
+    SIM_SIGNAL_WAV
+
+}   Sim_signal;
+
+typedef enum
+{
+    SIM_FAULT_NONE,
+    SIM_FAULT_COMMAND,
+    SIM_FAULT_READ,
+    SIM_FAULT_WRITE
+
+}   Sim_fault;
+
+/*
+    Card timing: ACMD41 initialisation time after CMD0, access time
+    before each read block, busy time after each written block (or a
+    per-block trace file replacing it), and a garbage collection stall
+    of gc_ms every gc_interval bytes written over old data. Sectors
+    erased with CMD38 are programmed without garbage collection; the
+    erase itself is busy for erase_ms per allocation unit of au_kib
+    (a size SD status can report, see sim_card_au_size) it touches.
+*/
+typedef struct Sim_card_profile
+{
+    uint32_t init_ms;
+    uint32_t read_us;
+    uint32_t program_us;
+    uint32_t gc_interval;
+    uint32_t gc_ms;
+    uint32_t au_kib;
+    uint32_t erase_ms;
+    const char *trace;
+
+}   Sim_card_profile;
+
+typedef struct Sim_disk_stats
+{
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t sectors_read;
+    uint32_t sectors_written;
+    uint32_t erases;
+    uint32_t sectors_erased;
+    uint32_t sectors_watched;
+    uint64_t busy;
+    uint64_t longest;
+
+}   Sim_disk_stats;
+
+/*
+    Core (sim.c)
+*/
+uint64_t sim_now(void);
+
+uint64_t sim_cycles(uint32_t cycles);
+
+void sim_advance(uint32_t cycles);
+
+bool sim_in_isr(void);
+
+void sim_schedule_pin(uint64_t time, Gpio_port port, Gpio_bit bit, bool level);
+
+/*
+    Peripheral models, polled by the core for their next event.
+*/
+uint32_t sim_clock_hz(void);
+
+void sim_set_clock_hz(uint32_t hz);
+
+uint64_t sim_timer_next(void);
+
+void sim_timer_update(uint64_t now);
+
+void sim_timer_pwm_sink(void (*sink)(Timer_module module, Timer_select select, uint32_t match));
+
+uint64_t sim_adc_next(void);
+
+void sim_adc_update(uint64_t now);
+
+bool sim_adc_source(Sim_signal signal, uint32_t frequency, const char *path);
+
+uint32_t sim_adc_conversions(void);
+
+uint64_t sim_systick_next(void);
+
+void sim_systick_update(uint64_t now);
+
+uint64_t sim_comp_next(void);
+
+void sim_comp_update(uint64_t now);
+
+void sim_comp_supply_fail(uint64_t time);
+
+void sim_gpio_drive(Gpio_port port, Gpio_bit bit, bool level);
+
+bool sim_gpio_output(Gpio_port port, Gpio_bit bit);
+
+uint32_t sim_ssi_byte_cycles(Ssi_module module);
+
+void sim_ssi_attach(Ssi_module module, uint8_t (*device)(uint8_t byte));
+
+uint8_t sim_ssi_exchange(Ssi_module module, uint8_t byte);
+
+bool sim_ssi_dma(Ssi_module module);
+
+void sim_nvic_raise(Nvic_vector vector);
+
+void sim_nvic_raise_systick(void);
+
+bool sim_nvic_ready(void);
+
+void sim_nvic_dispatch(void);
+
+/*
+    Disk image backing the SD card (image.c)
+*/
+bool sim_image_open(const char *path, uint32_t sectors);
+
+void sim_image_close(void);
+
+uint32_t sim_image_sectors(void);
+
+bool sim_image_read(uint32_t sector, uint8_t *buff);
+
+bool sim_image_write(uint32_t sector, const uint8_t *buff);
+
+/*
+    SD card on the SPI bus (card.c)
+*/
+uint8_t sim_card_exchange(uint8_t byte);
+
+bool sim_card_profile(const Sim_card_profile *profile);
+
+/*
+    AU_SIZE code reporting an allocation unit of kib, 0 if none does.
+*/
+uint8_t sim_card_au_size(uint32_t kib);
+
+void sim_card_fault(Sim_fault fault, uint32_t count);
+
+void sim_card_power_off(uint64_t time);
+
+/*
+    Sectors written from first to first + count - 1 are also counted in
+    sectors_watched.
+*/
+void sim_card_watch(uint32_t first, uint32_t count);
+
+void sim_card_stats(Sim_disk_stats *stats);
+
+/*
+    Host stack below the simulator's frame (stack.c)
+*/
+void sim_stack_paint(void);
+
+#endif /* SIM_H_ */
@@ -0,0 +1,314 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "adc.h"
+#include "nvic.h"
+#include "sim.h"
+
+#define ADC_MODULE_MAX  (ADC_MOD1 + 1)
+#define ADC_SAMPLER_MAX (ADC_SAMPLER3 + 1)
+#define ADC_FIFO_MAX    8
+
+/*
+    The analog front end biases the input around 0x4DB counts (the
+    DC_BIAS the recorder subtracts); the 12-bit converter takes 1 us per
+    sample at 1 Msps, times the hardware averaging factor.
+*/
+#define ADC_BIAS      0x04DB
+#define ADC_AMPLITUDE 0x04B0
+#define ADC_FULL      0x0FFF
+#define ADC_CONVERSION_PS (1 * SIM_PS_PER_US)
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct Adc
+{
+    uint32_t ADCACTSS;
+    uint32_t ADCIM;
+    uint32_t ADCRIS;
+    uint32_t ADCSAC;
+    uint32_t ADCCC;
+    uint32_t ADCSSMUX[ADC_SAMPLER_MAX];
+    uint32_t ADCSSCTL[ADC_SAMPLER_MAX];
+    uint16_t fifo[ADC_SAMPLER_MAX][ADC_FIFO_MAX];
+    uint8_t  count[ADC_SAMPLER_MAX];
+    uint64_t done[ADC_SAMPLER_MAX];
+    bool     busy[ADC_SAMPLER_MAX];
+};
+
+static Adc adc[ADC_MODULE_MAX];
+
+static const Nvic_vector vector[ADC_MODULE_MAX][ADC_SAMPLER_MAX] =
+{
+    {
+        NVIC_VECTOR_ADC0_SEQUENCE0, NVIC_VECTOR_ADC0_SEQUENCE1,
+        NVIC_VECTOR_ADC0_SEQUENCE2, NVIC_VECTOR_ADC0_SEQUENCE3
+    },
+    {
+        NVIC_VECTOR_ADC1_SEQUENCE0, NVIC_VECTOR_ADC1_SEQUENCE1,
+        NVIC_VECTOR_ADC1_SEQUENCE2, NVIC_VECTOR_ADC1_SEQUENCE3
+    }
+};
+
+static struct Source
+{
+    Sim_signal signal;
+    uint32_t frequency;
+    int16_t *wav;
+    uint32_t wav_samples;
+    uint32_t wav_rate;
+    uint32_t conversions;
+
+}   source = { .signal = SIM_SIGNAL_RAMP };
+
+static uint32_t read_le(const uint8_t *p, uint8_t bytes)
+{
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < bytes; i++)
+    {
+        value |= (uint32_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+static bool load_wav(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *raw = malloc((size_t)size);
+    bool ok = raw && fread(raw, 1, (size_t)size, f) == (size_t)size;
+    fclose(f);
+    ok = ok && size >= 12 && !memcmp(raw, "RIFF", 4) && !memcmp(raw + 8, "WAVE", 4);
+    uint16_t channels = 0;
+    uint16_t bits = 0;
+    long pos = 12;
+    while (ok && pos + 8 <= size)
+    {
+        uint32_t length = read_le(raw + pos + 4, 4);
+        if (!memcmp(raw + pos, "fmt ", 4) && length >= 16)
+        {
+            channels = (uint16_t)read_le(raw + pos + 10, 2);
+            source.wav_rate = read_le(raw + pos + 12, 4);
+            bits = (uint16_t)read_le(raw + pos + 22, 2);
+        }
+        else if (!memcmp(raw + pos, "data", 4) && bits == 16 && channels)
+        {
+            if (length > (uint32_t)(size - pos - 8))
+            {
+                length = (uint32_t)(size - pos - 8);
+            }
+            /*
+                Only the first channel is fed to the converter.
+            */
+            source.wav_samples = length / (2U * channels);
+            source.wav = malloc(source.wav_samples * sizeof(int16_t));
+            ok = source.wav != NULL;
+            for (uint32_t i = 0; ok && i < source.wav_samples; i++)
+            {
+                source.wav[i] = (int16_t)read_le(raw + pos + 8 + 2 * channels * i, 2);
+            }
+            break;
+        }
+        pos += 8 + length + (length & 1);
+    }
+    free(raw);
+    return ok && source.wav_samples && source.wav_rate;
+}
+
+bool sim_adc_source(Sim_signal signal, uint32_t frequency, const char *path)
+{
+    source.signal = signal;
+    source.frequency = frequency;
+    if (signal == SIM_SIGNAL_WAV)
+    {
+        return load_wav(path);
+    }
+    return true;
+}
+
+uint32_t sim_adc_conversions(void)
+{
+    return source.conversions;
+}
+
+static uint16_t convert(uint64_t time)
+{
+    int32_t value = ADC_BIAS;
+    switch (source.signal)
+    {
+    case SIM_SIGNAL_RAMP:
+        /*
+            A counter makes every dropped or repeated sample visible.
+        */
+        value = (int32_t)(source.conversions & ADC_FULL);
+        break;
+    case SIM_SIGNAL_SINE:
+        value += (int32_t)lround(ADC_AMPLITUDE * sin(2.0 * M_PI * source.frequency *
+                                 ((double)time / SIM_PS_PER_SECOND)));
+        break;
+    case SIM_SIGNAL_WAV:
+        value += source.wav[(time * source.wav_rate / SIM_PS_PER_SECOND) % source.wav_samples] / 16;
+        break;
+    }
+    source.conversions++;
+    if (value < 0)
+    {
+        value = 0;
+    }
+    if (value > ADC_FULL)
+    {
+        value = ADC_FULL;
+    }
+    return (uint16_t)value;
+}
+
+Adc *adc_address(Adc_module module)
+{
+    return &adc[module];
+}
+
+void adc_set_order(Adc *adc, Adc_sampler sampler, uint8_t num, Adc_channel channel)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    adc->ADCSSMUX[sampler] |= ((uint32_t)channel << (4 * (num - 1)));
+}
+
+void adc_set_end(Adc *adc, Adc_sampler sampler, uint8_t num)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    adc->ADCSSCTL[sampler] |= (1U << (4 * (num - 1) + 1));
+}
+
+void adc_set_trigger(Adc *adc, Adc_sampler sampler, uint8_t num)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    adc->ADCSSCTL[sampler] |= (1U << (4 * (num - 1) + 2));
+}
+
+void adc_set_averaging(Adc *adc, Adc_oversample oversample)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    adc->ADCSAC = oversample;
+}
+
+/*
+    Both clock sources give the 1 Msps conversion time, so the choice is
+    only recorded.
+*/
+void adc_set_clock(Adc *adc, Adc_clock clock)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    adc->ADCCC = clock;
+}
+
+void adc_enable_interrupt(Adc *adc, Adc_sampler sampler)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    adc->ADCIM |= (1U << sampler);
+}
+
+void adc_clear_interrupt(Adc *adc, Adc_sampler sampler)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    adc->ADCRIS &= ~(1U << sampler);
+}
+
+void adc_enable_sampler(Adc *adc, Adc_sampler sampler)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    adc->ADCACTSS |= (1U << sampler);
+}
+
+void adc_disable_sampler(Adc *adc, Adc_sampler sampler)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    adc->ADCACTSS &= ~(1U << sampler);
+}
+
+void adc_sample(Adc *adc, Adc_sampler sampler)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if ((adc->ADCACTSS & (1U << sampler)) && !adc->busy[sampler])
+    {
+        adc->busy[sampler] = true;
+        adc->done[sampler] = sim_now() + (ADC_CONVERSION_PS << adc->ADCSAC);
+    }
+}
+
+bool adc_busy(Adc *adc)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    for (uint32_t s = 0; s < ADC_SAMPLER_MAX; s++)
+    {
+        if (adc->busy[s])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t adc_result(Adc *adc, Adc_sampler sampler)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (!adc->count[sampler])
+    {
+        return 0;
+    }
+    uint16_t value = adc->fifo[sampler][0];
+    adc->count[sampler]--;
+    memmove(&adc->fifo[sampler][0], &adc->fifo[sampler][1], adc->count[sampler] * sizeof(uint16_t));
+    return value;
+}
+
+uint64_t sim_adc_next(void)
+{
+    uint64_t next = SIM_NEVER;
+    for (uint32_t m = 0; m < ADC_MODULE_MAX; m++)
+    {
+        for (uint32_t s = 0; s < ADC_SAMPLER_MAX; s++)
+        {
+            if (adc[m].busy[s] && adc[m].done[s] < next)
+            {
+                next = adc[m].done[s];
+            }
+        }
+    }
+    return next;
+}
+
+void sim_adc_update(uint64_t now)
+{
+    for (uint32_t m = 0; m < ADC_MODULE_MAX; m++)
+    {
+        for (uint32_t s = 0; s < ADC_SAMPLER_MAX; s++)
+        {
+            Adc *a = &adc[m];
+            if (!a->busy[s] || a->done[s] > now)
+            {
+                continue;
+            }
+            a->busy[s] = false;
+            if (a->count[s] < ADC_FIFO_MAX)
+            {
+                a->fifo[s][a->count[s]++] = convert(a->done[s]);
+            }
+            a->ADCRIS |= (1U << s);
+            if (a->ADCIM & (1U << s))
+            {
+                sim_nvic_raise(vector[m][s]);
+            }
+        }
+    }
+}
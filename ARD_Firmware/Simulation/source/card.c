@@ -0,0 +1,673 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gpio.h"
+#include "sim.h"
+
+/*
+    SD card in SPI mode, one byte per SSI frame, backed by the disk image.
+
+    Implements the commands tm4c123g.c issues (CMD0/8/9/10/12/13/16/17/
+    18/23/24/25/32/33/38/55/41/58) for an SDHC card with block addressing.
+    Programming a block keeps DO low (busy) for a time taken from the
+    profile: a fixed program time, a replayed latency trace, plus periodic
+    garbage collection stalls while old data is overwritten. The card
+    starts out fully written; CMD38 erases whole allocation units' worth
+    of time and leaves its range free for programming without garbage
+    collection. Faults turn the Nth command, read or write into an error.
+
+    Trace files hold one busy time in microseconds per written block,
+    whitespace separated, '#' to end of line for comments; the trace is
+    replayed cyclically.
+*/
+
+#define CARD_CS_PORT GPIO_PORTD
+#define CARD_CS_BIT  GPIO_BIT1
+
+#define SECTOR_SIZE  512
+#define REGISTER_SIZE 16
+#define SD_STATUS_SIZE 64
+#define QUEUE_MAX    8
+
+/*
+    R1 response flags and data tokens.
+*/
+#define R1_IDLE          0x01
+#define R1_ILLEGAL       0x04
+#define R1_ADDRESS       0x20
+#define R1_PARAMETER     0x40
+#define TOKEN_SINGLE     0xFE
+#define TOKEN_MULTIPLE   0xFC
+#define TOKEN_STOP       0xFD
+#define TOKEN_RANGE      0x08
+#define DATA_ACCEPTED    0x05
+#define DATA_WRITE_ERROR 0x0D
+
+/*
+    Busy time after CMD12 and the stop token.
+*/
+#define STOP_BUSY_US 20
+
+typedef enum
+{
+    CARD_COMMAND,
+    CARD_READ,
+    CARD_WRITE_TOKEN,
+    CARD_WRITE_DATA
+
+}   Card_mode;
+
+static struct Card
+{
+    Card_mode mode;
+    bool ready;
+    bool app;
+    uint64_t ready_at;
+    uint64_t busy_until;
+    uint8_t frame[6];
+    uint8_t framed;
+    uint8_t queue[QUEUE_MAX];
+    uint8_t queued;
+    uint8_t head;
+    uint32_t sector;
+    bool multiple;
+    uint8_t block[SECTOR_SIZE + 2];
+    uint16_t length;
+    int32_t position;
+    bool fault_token;
+    uint32_t commands;
+    uint32_t reads;
+    uint32_t writes;
+    uint64_t written;
+    uint64_t gc_due;
+    uint32_t erase_first;
+    uint32_t erase_last;
+    uint8_t *erased;
+    uint32_t trace_index;
+    Sim_disk_stats stats;
+
+}   card;
+
+static struct Profile
+{
+    Sim_card_profile profile;
+    uint32_t *trace;
+    uint32_t trace_length;
+    Sim_fault fault;
+    uint32_t fault_at;
+    uint64_t power_off;
+    uint32_t watch_first;
+    uint32_t watch_count;
+
+}   config =
+{
+    .power_off = SIM_NEVER,
+    .profile =
+    {
+        .init_ms = 50,
+        .read_us = 100,
+        .program_us = 250,
+        .au_kib = 4096,
+        .erase_ms = 50
+    }
+};
+
+static bool load_trace(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        return false;
+    }
+    uint32_t capacity = 0;
+    char word[32];
+    free(config.trace);
+    config.trace = NULL;
+    config.trace_length = 0;
+    while (fscanf(f, "%31s", word) == 1)
+    {
+        if (word[0] == '#')
+        {
+            int c;
+            while ((c = fgetc(f)) != EOF && c != '\n');
+            continue;
+        }
+        if (config.trace_length == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 1024;
+            uint32_t *grown = realloc(config.trace, capacity * sizeof(uint32_t));
+            if (!grown)
+            {
+                break;
+            }
+            config.trace = grown;
+        }
+        config.trace[config.trace_length++] = (uint32_t)strtoul(word, NULL, 10);
+    }
+    fclose(f);
+    return config.trace_length != 0;
+}
+
+bool sim_card_profile(const Sim_card_profile *profile)
+{
+    config.profile = *profile;
+    if (profile->trace)
+    {
+        return load_trace(profile->trace);
+    }
+    return true;
+}
+
+/*
+    Counted from here on, so the accesses that prepared the image do not
+    use the fault up.
+*/
+void sim_card_fault(Sim_fault fault, uint32_t count)
+{
+    config.fault = fault;
+    config.fault_at = count + (fault == SIM_FAULT_COMMAND ? card.commands :
+                               fault == SIM_FAULT_READ ? card.reads : card.writes);
+}
+
+/*
+    Power back on after a cut drops the transfer the cut landed in, as a
+    card coming up again would; the host is taken to have initialised
+    it again.
+*/
+void sim_card_power_off(uint64_t time)
+{
+    if (sim_now() >= config.power_off && time > sim_now())
+    {
+        card.mode = CARD_COMMAND;
+        card.framed = 0;
+        card.queued = 0;
+        card.multiple = false;
+        card.busy_until = sim_now();
+    }
+    config.power_off = time;
+}
+
+void sim_card_watch(uint32_t first, uint32_t count)
+{
+    config.watch_first = first;
+    config.watch_count = count;
+}
+
+void sim_card_stats(Sim_disk_stats *stats)
+{
+    *stats = card.stats;
+}
+
+static bool fault(Sim_fault kind, uint32_t count)
+{
+    return config.fault == kind && config.fault_at == count;
+}
+
+static void busy(uint64_t duration)
+{
+    uint64_t start = card.busy_until > sim_now() ? card.busy_until : sim_now();
+    card.busy_until = start + duration;
+    card.stats.busy += duration;
+    if (duration > card.stats.longest)
+    {
+        card.stats.longest = duration;
+    }
+}
+
+static void queue(uint8_t byte)
+{
+    if (card.queued < QUEUE_MAX)
+    {
+        card.queue[(card.head + card.queued++) % QUEUE_MAX] = byte;
+    }
+}
+
+static void respond(uint8_t r1)
+{
+    /*
+        One byte of NCR before the response.
+    */
+    queue(0xFF);
+    queue(r1 | (card.ready ? 0 : R1_IDLE));
+}
+
+static void start_read(uint32_t sector)
+{
+    card.mode = CARD_READ;
+    card.sector = sector;
+    card.length = SECTOR_SIZE;
+    card.position = -1;
+    card.fault_token = fault(SIM_FAULT_READ, ++card.reads);
+    if (!card.fault_token && !sim_image_read(sector, card.block))
+    {
+        card.fault_token = true;
+    }
+    uint64_t access = config.profile.read_us * SIM_PS_PER_US;
+    card.busy_until = sim_now() + access;
+    card.stats.busy += access;
+    card.stats.sectors_read++;
+}
+
+static void start_register(const uint8_t *data, uint16_t length)
+{
+    card.mode = CARD_READ;
+    card.multiple = false;
+    card.length = length;
+    card.position = -1;
+    card.fault_token = false;
+    memcpy(card.block, data, length);
+    card.busy_until = sim_now();
+}
+
+static void csd(void)
+{
+    /*
+        CSD version 2.0: capacity is (C_SIZE + 1) * 512 KiB.
+    */
+    uint8_t reg[REGISTER_SIZE] = { 0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59 };
+    uint32_t size = sim_image_sectors() / 1024 - 1;
+    reg[7] = (uint8_t)((size >> 16) & 0x3F);
+    reg[8] = (uint8_t)(size >> 8);
+    reg[9] = (uint8_t)size;
+    reg[10] = 0x7F;
+    reg[11] = 0x80;
+    reg[12] = 0x0A;
+    reg[13] = 0x40;
+    reg[15] = 0x01;
+    start_register(reg, REGISTER_SIZE);
+}
+
+static void cid(void)
+{
+    uint8_t reg[REGISTER_SIZE] = { 0x00, 'S', 'M', 'S', 'I', 'M', 'S', 'D', 0x10 };
+    reg[15] = 0x01;
+    start_register(reg, REGISTER_SIZE);
+}
+
+uint8_t sim_card_au_size(uint32_t kib)
+{
+    /*
+        16 KiB doubling up to 16 MiB, with 12 MiB, 24 MiB and 64 MiB among
+        the SD 3.0 codes above 8 MiB.
+    */
+    static const uint32_t au_kib[16] =
+    {
+        0, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192,
+        12288, 16384, 24576, 32768, 65536
+    };
+    for (uint8_t code = 1; code < 16; code++)
+    {
+        if (au_kib[code] == kib)
+        {
+            return code;
+        }
+    }
+    return 0;
+}
+
+static void sd_status(void)
+{
+    /*
+        AU_SIZE in the upper nibble of byte 10. The erase time per unit is ERASE_TIMEOUT seconds (upper six bits
+        of byte 13) over ERASE_SIZE units (bytes 11 and 12), rounded up
+        to what that can express.
+    */
+    uint8_t reg[SD_STATUS_SIZE] = { 0 };
+    reg[10] = (uint8_t)(sim_card_au_size(config.profile.au_kib) << 4);
+    uint32_t timeout = (config.profile.erase_ms + 999) / 1000;
+    uint32_t units = config.profile.erase_ms ? timeout * 1000 / config.profile.erase_ms : 0;
+    if (timeout && timeout < 64 && units)
+    {
+        reg[11] = (uint8_t)(units >> 8);
+        reg[12] = (uint8_t)units;
+        reg[13] = (uint8_t)(timeout << 2);
+    }
+    start_register(reg, SD_STATUS_SIZE);
+}
+
+static bool in_range(uint32_t sector)
+{
+    return sector < sim_image_sectors();
+}
+
+/*
+    Whether a sector is still erased, clearing the mark as it is
+    programmed. Sectors the card has not erased this run hold old data.
+*/
+static bool program_erased(uint32_t sector)
+{
+    if (!card.erased)
+    {
+        return false;
+    }
+    uint8_t bit = (uint8_t)(1u << (sector & 7));
+    bool erased = card.erased[sector >> 3] & bit;
+    card.erased[sector >> 3] &= (uint8_t)~bit;
+    return erased;
+}
+
+/*
+    The card erases in allocation units: a range that covers part of a
+    unit costs as much as the whole unit.
+*/
+static void erase(uint32_t first, uint32_t last)
+{
+    if (!card.erased)
+    {
+        card.erased = calloc(sim_image_sectors() / 8 + 1, 1);
+    }
+    for (uint32_t sector = first; card.erased && sector <= last; sector++)
+    {
+        card.erased[sector >> 3] |= (uint8_t)(1u << (sector & 7));
+    }
+    uint32_t au = config.profile.au_kib * 2;
+    uint64_t units = last / au - first / au + 1;
+    busy(units * config.profile.erase_ms * SIM_PS_PER_MS);
+    card.stats.erases++;
+    card.stats.sectors_erased += last - first + 1;
+}
+
+static void execute(uint8_t cmd, uint32_t arg)
+{
+    bool app = card.app;
+    card.app = false;
+    if (fault(SIM_FAULT_COMMAND, ++card.commands))
+    {
+        /*
+            No response at all: the host times out polling for R1.
+        */
+        return;
+    }
+    switch (cmd)
+    {
+    case 0:
+        card.ready = false;
+        card.ready_at = sim_now() + config.profile.init_ms * SIM_PS_PER_MS;
+        respond(0);
+        break;
+    case 8:
+        respond(0);
+        queue(0x00);
+        queue(0x00);
+        queue((uint8_t)((arg >> 8) & 0x0F));
+        queue((uint8_t)arg);
+        break;
+    case 9:
+        respond(0);
+        csd();
+        break;
+    case 10:
+        respond(0);
+        cid();
+        break;
+    case 13:
+        /*
+            SEND_STATUS answers with R2; as ACMD13 the SD status follows.
+        */
+        respond(0);
+        queue(0x00);
+        if (app)
+        {
+            sd_status();
+        }
+        break;
+    case 12:
+        card.mode = CARD_COMMAND;
+        card.busy_until = sim_now();
+        respond(0);
+        busy(STOP_BUSY_US * SIM_PS_PER_US);
+        break;
+    case 16:
+        respond(arg == SECTOR_SIZE ? 0 : R1_PARAMETER);
+        break;
+    case 17:
+    case 18:
+        if (!card.ready || !in_range(arg))
+        {
+            respond(card.ready ? R1_ADDRESS : R1_ILLEGAL);
+            break;
+        }
+        respond(0);
+        card.multiple = cmd == 18;
+        card.stats.reads++;
+        start_read(arg);
+        break;
+    case 23:
+        /*
+            ACMD23 pre-erase count; only a hint for the card.
+        */
+        respond(0);
+        break;
+    case 24:
+    case 25:
+        if (!card.ready || !in_range(arg))
+        {
+            respond(card.ready ? R1_ADDRESS : R1_ILLEGAL);
+            break;
+        }
+        respond(0);
+        card.mode = CARD_WRITE_TOKEN;
+        card.multiple = cmd == 25;
+        card.sector = arg;
+        card.stats.writes++;
+        break;
+    case 32:
+    case 33:
+        if (!card.ready || !in_range(arg))
+        {
+            respond(card.ready ? R1_ADDRESS : R1_ILLEGAL);
+            break;
+        }
+        *(cmd == 32 ? &card.erase_first : &card.erase_last) = arg;
+        respond(0);
+        break;
+    case 38:
+        if (!card.ready || card.erase_first > card.erase_last)
+        {
+            respond(card.ready ? R1_PARAMETER : R1_ILLEGAL);
+            break;
+        }
+        respond(0);
+        erase(card.erase_first, card.erase_last);
+        break;
+    case 41:
+        if (!app)
+        {
+            respond(R1_ILLEGAL);
+            break;
+        }
+        if (sim_now() >= card.ready_at)
+        {
+            card.ready = true;
+        }
+        respond(0);
+        break;
+    case 55:
+        card.app = true;
+        respond(0);
+        break;
+    case 58:
+        respond(0);
+        queue(card.ready ? 0xC0 : 0x00);
+        queue(0xFF);
+        queue(0x80);
+        queue(0x00);
+        break;
+    default:
+        respond(R1_ILLEGAL);
+        break;
+    }
+}
+
+static uint64_t program_time(void)
+{
+    uint64_t us = config.profile.program_us;
+    if (config.trace_length)
+    {
+        us = config.trace[card.trace_index++ % config.trace_length];
+    }
+    uint64_t time = us * SIM_PS_PER_US;
+    if (program_erased(card.sector))
+    {
+        return time;
+    }
+    card.written += SECTOR_SIZE;
+    if (config.profile.gc_interval && card.written >= card.gc_due + config.profile.gc_interval)
+    {
+        card.gc_due += config.profile.gc_interval;
+        time += config.profile.gc_ms * SIM_PS_PER_MS;
+    }
+    return time;
+}
+
+static void receive_block(void)
+{
+    bool ok = !fault(SIM_FAULT_WRITE, ++card.writes) && in_range(card.sector) &&
+              sim_image_write(card.sector, card.block);
+    queue(ok ? DATA_ACCEPTED : DATA_WRITE_ERROR);
+    busy(program_time());
+    card.stats.sectors_written++;
+    if (card.sector - config.watch_first < config.watch_count)
+    {
+        card.stats.sectors_watched++;
+    }
+    card.sector++;
+    /*
+        After a write error the card leaves the data phase; the driver
+        gives up on the transfer.
+    */
+    card.mode = (ok && card.multiple) ? CARD_WRITE_TOKEN : CARD_COMMAND;
+}
+
+static uint8_t output(void)
+{
+    if (card.queued)
+    {
+        uint8_t byte = card.queue[card.head];
+        card.head = (card.head + 1) % QUEUE_MAX;
+        card.queued--;
+        return byte;
+    }
+    if (card.mode == CARD_READ)
+    {
+        if (sim_now() < card.busy_until)
+        {
+            return 0xFF;
+        }
+        if (card.position < 0)
+        {
+            card.position = 0;
+            if (card.fault_token)
+            {
+                card.mode = CARD_COMMAND;
+                return TOKEN_RANGE;
+            }
+            return TOKEN_SINGLE;
+        }
+        if (card.position < card.length)
+        {
+            return card.block[card.position++];
+        }
+        /*
+            CRC, then the next block of a multiple read.
+        */
+        if (++card.position < card.length + 2)
+        {
+            return 0xFF;
+        }
+        if (!card.multiple)
+        {
+            card.mode = CARD_COMMAND;
+        }
+        else if (in_range(card.sector + 1))
+        {
+            start_read(card.sector + 1);
+        }
+        else
+        {
+            /*
+                Past the end of the card: idle until CMD12.
+            */
+            card.busy_until = SIM_NEVER;
+        }
+        return 0xFF;
+    }
+    if (sim_now() < card.busy_until)
+    {
+        return 0x00;
+    }
+    return 0xFF;
+}
+
+static void input(uint8_t byte)
+{
+    if (card.mode == CARD_WRITE_TOKEN)
+    {
+        if (byte == TOKEN_SINGLE || byte == TOKEN_MULTIPLE)
+        {
+            card.mode = CARD_WRITE_DATA;
+            card.length = 0;
+        }
+        else if (byte == TOKEN_STOP && card.multiple)
+        {
+            card.mode = CARD_COMMAND;
+            busy(STOP_BUSY_US * SIM_PS_PER_US);
+        }
+        return;
+    }
+    if (card.mode == CARD_WRITE_DATA)
+    {
+        card.block[card.length++] = byte;
+        if (card.length == SECTOR_SIZE + 2)
+        {
+            receive_block();
+        }
+        return;
+    }
+    /*
+        Commands are only accepted between transfers, except CMD12 which
+        may interrupt a multiple block read.
+    */
+    if (!card.framed && (byte & 0xC0) != 0x40)
+    {
+        return;
+    }
+    card.frame[card.framed++] = byte;
+    if (card.framed < sizeof(card.frame))
+    {
+        return;
+    }
+    card.framed = 0;
+    uint8_t cmd = card.frame[0] & 0x3F;
+    if (card.mode == CARD_READ && cmd != 12)
+    {
+        return;
+    }
+    execute(cmd, ((uint32_t)card.frame[1] << 24) | ((uint32_t)card.frame[2] << 16) |
+                 ((uint32_t)card.frame[3] << 8) | card.frame[4]);
+}
+
+uint8_t sim_card_exchange(uint8_t byte)
+{
+    if (sim_gpio_output(CARD_CS_PORT, CARD_CS_BIT))
+    {
+        /*
+            Deselected: DO is released and a partial command is dropped.
+        */
+        card.framed = 0;
+        return 0xFF;
+    }
+    if (sim_now() >= config.power_off)
+    {
+        /*
+            Unpowered: DO is left to the pull-up and nothing more is
+            taken in. Blocks already received stay written.
+        */
+        return 0xFF;
+    }
+    uint8_t out = output();
+    input(byte);
+    return out;
+}
@@ -0,0 +1,93 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "comp.h"
+#include "nvic.h"
+#include "sim.h"
+
+#define COMP_MODULE_MAX (COMP_MOD1 + 1)
+
+struct Comp
+{
+    uint32_t ACINTEN;
+    uint32_t ACREFCTL;
+    uint32_t ACCTL[COMP_MODULE_MAX];
+};
+
+/*
+    Comparator 0 watches the supply: above the threshold until the
+    scenario's power fail, below it from then on. Comparator 1 has
+    nothing connected and reads low.
+*/
+static Comp comp;
+static uint64_t fail_at = SIM_NEVER;
+static bool failed;
+
+Comp *comp_address(void)
+{
+    return &comp;
+}
+
+void sim_comp_supply_fail(uint64_t time)
+{
+    fail_at = time;
+}
+
+void comp_set_reference(Comp *comp, Comp_range range, uint8_t level)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    comp->ACREFCTL = (1U << 9) | ((uint32_t)range << 8) | (level & 0x0F);
+}
+
+void comp_set_source(Comp *comp, Comp_module module, Comp_source source)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    comp->ACCTL[module] = (comp->ACCTL[module] & ~(0x3U << 9)) | ((uint32_t)source << 9);
+}
+
+void comp_set_sense(Comp *comp, Comp_module module, Comp_sense sense)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    comp->ACCTL[module] = (comp->ACCTL[module] & ~(0x3U << 2)) | ((uint32_t)sense << 2);
+}
+
+void comp_enable_interrupt(Comp *comp, Comp_module module)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    comp->ACINTEN |= (1U << module);
+}
+
+void comp_clear_interrupt(Comp *comp, Comp_module module)
+{
+    (void)comp;
+    (void)module;
+    sim_advance(SIM_BUS_CYCLES);
+}
+
+bool comp_output(Comp *comp, Comp_module module)
+{
+    (void)comp;
+    sim_advance(SIM_BUS_CYCLES);
+    return module == COMP_MOD0 && failed;
+}
+
+uint64_t sim_comp_next(void)
+{
+    return failed ? SIM_NEVER : fail_at;
+}
+
+void sim_comp_update(uint64_t now)
+{
+    if (failed || fail_at > now)
+    {
+        return;
+    }
+    /*
+        The output rises as the supply falls through the threshold.
+    */
+    failed = true;
+    Comp_sense sense = (Comp_sense)((comp.ACCTL[COMP_MOD0] >> 2) & 0x3);
+    if ((comp.ACINTEN & (1U << COMP_MOD0)) && (sense == COMP_SENSE_RISING || sense == COMP_SENSE_BOTH))
+    {
+        sim_nvic_raise(NVIC_VECTOR_ANALOG_COMPARATOR0);
+    }
+}
@@ -0,0 +1,43 @@
+#include <stdint.h>
+#include "dwt.h"
+#include "sim.h"
+
+/*
+    The cycle counter follows simulated time, so it counts the bus and
+    exception cycles the models charge but not the instructions of the
+    code in between.
+*/
+static struct Dwt
+{
+    uint64_t origin;
+    uint32_t hz;
+    uint32_t base;
+
+}   dwt;
+
+void dwt_enable_cycles(void)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    dwt.origin = sim_now();
+    dwt.hz = sim_clock_hz();
+    dwt.base = 0;
+}
+
+uint32_t dwt_cycles(void)
+{
+    if (!dwt.hz)
+    {
+        return 0;
+    }
+    /*
+        Rebase on a clock change so earlier time is counted at the rate
+        it ran at.
+    */
+    if (dwt.hz != sim_clock_hz())
+    {
+        dwt.base += (uint32_t)((sim_now() - dwt.origin) / (SIM_PS_PER_SECOND / dwt.hz));
+        dwt.origin = sim_now();
+        dwt.hz = sim_clock_hz();
+    }
+    return dwt.base + (uint32_t)((sim_now() - dwt.origin) / (SIM_PS_PER_SECOND / dwt.hz));
+}
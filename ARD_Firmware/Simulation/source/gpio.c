@@ -0,0 +1,138 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "gpio.h"
+#include "sim.h"
+
+#define GPIO_PORT_MAX (GPIO_PORTK + 1)
+
+struct Gpio
+{
+    uint32_t GPIODATA;
+    uint32_t GPIODIR;
+    uint32_t GPIOAFSEL;
+    uint32_t GPIOPUR;
+    uint32_t GPIOPDR;
+    uint32_t GPIOODR;
+    uint32_t GPIODEN;
+    uint32_t GPIOCR;
+    uint32_t GPIOAMSEL;
+    Gpio_function function[8];
+    uint32_t low;
+};
+
+/*
+    Inputs read high unless driven low by the scenario; the buttons and
+    the card detect switch are active low.
+*/
+static Gpio gpio[GPIO_PORT_MAX];
+
+Gpio *gpio_address(Gpio_port port)
+{
+    return &gpio[port];
+}
+
+void sim_gpio_drive(Gpio_port port, Gpio_bit bit, bool level)
+{
+    if (level)
+    {
+        gpio[port].low &= ~(1U << bit);
+    }
+    else
+    {
+        gpio[port].low |= (1U << bit);
+    }
+}
+
+bool sim_gpio_output(Gpio_port port, Gpio_bit bit)
+{
+    return (gpio[port].GPIODATA >> bit) & 1U;
+}
+
+void gpio_unlock(Gpio *gpio, Gpio_bit bit)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    gpio->GPIOCR |= (1U << bit);
+}
+
+void gpio_set_direction(Gpio *gpio, Gpio_bit bit, Gpio_direction direction)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (direction == GPIO_OUTPUT)
+    {
+        gpio->GPIODIR |= (1U << bit);
+    }
+    else
+    {
+        gpio->GPIODIR &= ~(1U << bit);
+    }
+}
+
+void gpio_set_operation(Gpio *gpio, Gpio_bit bit, Gpio_operation operation)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (operation == GPIO_ALTERNATE)
+    {
+        gpio->GPIOAFSEL |= (1U << bit);
+    }
+    else
+    {
+        gpio->GPIOAFSEL &= ~(1U << bit);
+    }
+}
+
+void gpio_set_resistor(Gpio *gpio, Gpio_bit bit, Gpio_resistor resistor)
+{
+    uint32_t *reg[] =
+    {
+         &gpio->GPIOPUR,
+         &gpio->GPIOPDR,
+         &gpio->GPIOODR
+    };
+    sim_advance(SIM_BUS_CYCLES);
+    *reg[resistor] |= (1U << bit);
+}
+
+void gpio_set_function(Gpio *gpio, Gpio_bit bit, Gpio_function function)
+{
+    /*
+        Pin muxing is not modelled beyond remembering the selection.
+    */
+    sim_advance(SIM_BUS_CYCLES);
+    gpio->function[bit] = function;
+}
+
+void gpio_enable_digital(Gpio *gpio, Gpio_bit bit)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    gpio->GPIODEN |= (1U << bit);
+}
+
+void gpio_enable_analog(Gpio *gpio, Gpio_bit bit)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    gpio->GPIOAMSEL |= (1U << bit);
+}
+
+void gpio_write_high(Gpio *gpio, Gpio_bit bit)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    gpio->GPIODATA |= (1U << bit);
+}
+
+void gpio_write_low(Gpio *gpio, Gpio_bit bit)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    gpio->GPIODATA &= ~(1U << bit);
+}
+
+void gpio_write_toggle(Gpio *gpio, Gpio_bit bit)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    gpio->GPIODATA ^= (1U << bit);
+}
+
+uint32_t gpio_read(Gpio *gpio)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    return (gpio->GPIODATA & gpio->GPIODIR) | (~gpio->low & ~gpio->GPIODIR & 0xFF);
+}
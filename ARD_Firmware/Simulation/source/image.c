@@ -0,0 +1,75 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "sim.h"
+
+/*
+    Host disk image holding the sectors of the simulated SD card.
+*/
+#define SECTOR_SIZE 512
+
+static struct Image
+{
+    FILE *file;
+    uint32_t sectors;
+
+}   image;
+
+bool sim_image_open(const char *path, uint32_t sectors)
+{
+    image.file = fopen(path, "r+b");
+    if (!image.file)
+    {
+        image.file = fopen(path, "w+b");
+        if (!image.file)
+        {
+            return false;
+        }
+    }
+    fseek(image.file, 0, SEEK_END);
+    long size = ftell(image.file);
+    if (size < (long)sectors * SECTOR_SIZE)
+    {
+        /*
+            Grow a fresh or short image to the requested card size.
+        */
+        static const uint8_t zero[SECTOR_SIZE];
+        for (long s = size / SECTOR_SIZE; s < (long)sectors; s++)
+        {
+            fseek(image.file, s * SECTOR_SIZE, SEEK_SET);
+            fwrite(zero, 1, SECTOR_SIZE, image.file);
+        }
+        size = (long)sectors * SECTOR_SIZE;
+    }
+    image.sectors = (uint32_t)(size / SECTOR_SIZE);
+    return true;
+}
+
+void sim_image_close(void)
+{
+    if (image.file)
+    {
+        fclose(image.file);
+        image.file = NULL;
+    }
+    image.sectors = 0;
+}
+
+uint32_t sim_image_sectors(void)
+{
+    return image.sectors;
+}
+
+bool sim_image_read(uint32_t sector, uint8_t *buff)
+{
+    return sector < image.sectors &&
+           !fseek(image.file, (long)sector * SECTOR_SIZE, SEEK_SET) &&
+           fread(buff, SECTOR_SIZE, 1, image.file) == 1;
+}
+
+bool sim_image_write(uint32_t sector, const uint8_t *buff)
+{
+    return sector < image.sectors &&
+           !fseek(image.file, (long)sector * SECTOR_SIZE, SEEK_SET) &&
+           fwrite(buff, SECTOR_SIZE, 1, image.file) == 1;
+}
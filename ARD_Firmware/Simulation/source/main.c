@@ -0,0 +1,1476 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "agc.h"
+#include "blockpool.h"
+#include "capture.h"
+#include "catalog.h"
+#include "fft.h"
+#include "ff.h"
+#include "init.h"
+#include "peaks.h"
+#include "player.h"
+#include "sample.h"
+#include "sm.h"
+#include "spectrum.h"
+#include "stack.h"
+#include "sysctl.h"
+#include "sim.h"
+#include "wave.h"
+
+/*
+    Host entry point: runs the recorder firmware against the simulated
+    hardware and checks the file it leaves on the disk image, the card
+    benchmark report, or what playback put out on the PWM pin.
+
+    usage: recorder_sim [key=value]...
+
+        image=FILE              disk image, created if missing
+        size=MIB                card size
+        seconds=S               recording length
+        rate=HZ                 requested sample rate
+        signal=ramp|sine:HZ|wav:FILE
+        init=MS read=US program=US
+                                card initialisation, access and
+                                per-block program times
+        gc=KIB:MS               stall MS every KIB written over old data
+        au=KIB erase=MS         allocation unit size and erase time per unit
+        reserve=0|1             pre-erased, unit-aligned file placement
+        instant=0|1             capture from reset, before the card is up
+        powerfail=S[:MS]        supply drops S seconds into the recording,
+                                the card losing power MS later
+        fragment=MIB:K          allocate the first MIB but one cluster in K
+        trace=FILE              per-block busy times in microseconds
+        fault=command|read|write:N
+                                fail the Nth command, read or write once
+                                the image is prepared
+        expect=done|failed|powerfail
+                                how the run should end, by default done
+                                or, with powerfail, powerfail; a failed
+                                run is checked for a consistent volume
+        bench=KIB               hold start and unmount from reset to
+                                benchmark the card over KIB
+        play=0|1|BITS           write a RATE Hz, S second recording, in
+                                the built format or of BITS 8, 16, 24 or
+                                32 (float), and hold stop from reset to
+                                play it
+        scan=N                  keep N files in SCAN and time a mount, a
+                                scan and a file creation in it after the run
+        recordings=N            keep N recordings in date buckets and time
+                                a catalog build and a creation after the run
+        agc=ATTACK:RELEASE[:GAIN]
+                                gain stage attack and release time
+                                constants in ms, raising by GAIN at most;
+                                a build with AGC=1 only
+*/
+
+#define DEFAULT_IMAGE   "sim.img"
+#define DEFAULT_SECONDS 2.0
+#define DEFAULT_MIB     64
+
+#define START_PRESS_MS  50
+#define FINISH_LIMIT_S  10
+#define BENCH_LIMIT_S   120
+
+#define DC_BIAS 0x04DB
+
+static FATFS fatfs;
+static Agc_config agc = { .attack_ms = AGC_ATTACK_MS, .release_ms = AGC_RELEASE_MS,
+                          .target = AGC_TARGET, .max_gain = AGC_MAX_GAIN };
+static uint32_t play_bits = SAMPLE_BITS;
+
+/*
+    PWM periods playback put out.
+*/
+static struct Pwm
+{
+    uint32_t *match;
+    uint32_t count;
+    uint32_t capacity;
+
+}   pwm;
+
+static bool format(void)
+{
+    DIR dir;
+    f_mount(0, &fatfs);
+    FRESULT result = f_opendir(&dir, "");
+    if (result == FR_NO_FILESYSTEM)
+    {
+        printf("formatting new image\n");
+        result = f_mkfs(0, 1, 0);
+    }
+    f_mount(0, NULL);
+    return result == FR_OK;
+}
+
+/*
+    Leaves the first mib MiB of the card allocated but for one free
+    cluster in every holes, so no two free clusters are adjacent: the
+    free map of a nearly full card that has been written and trimmed
+    many times. Seeking past the end of a file allocates without
+    writing data; two files take turns and one is then deleted.
+*/
+static bool fragment(uint32_t mib, uint32_t holes)
+{
+    FIL keep;
+    FIL hole;
+    f_mount(0, &fatfs);
+    FRESULT result = f_open(&keep, "KEEP.TMP", FA_CREATE_ALWAYS|FA_WRITE);
+    if (result == FR_OK)
+    {
+        result = f_open(&hole, "HOLE.TMP", FA_CREATE_ALWAYS|FA_WRITE);
+    }
+    uint32_t cluster = (uint32_t)fatfs.csize * 512;
+    while (result == FR_OK && keep.fsize + hole.fsize < (mib << 20))
+    {
+        result = f_lseek(&keep, keep.fsize + (holes - 1) * cluster);
+        if (result == FR_OK)
+        {
+            result = f_lseek(&hole, hole.fsize + cluster);
+        }
+    }
+    if (result == FR_OK)
+    {
+        f_close(&keep);
+        result = f_close(&hole);
+    }
+    if (result == FR_OK)
+    {
+        result = f_unlink("HOLE.TMP");
+    }
+    f_mount(0, NULL);
+    return result == FR_OK;
+}
+
+static uint32_t read_le(const uint8_t *p, uint8_t bytes)
+{
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < bytes; i++)
+    {
+        value |= (uint32_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+/*
+    The recording's samples as the 16-bit values they were packed from.
+    Every format keeps the SAMPLE_INPUT_BITS the samples span, as
+    captured or through the gain stage, saturating beyond them, and an
+    8-bit sample only the top 8 of those: code() is the byte expected
+    for a value and quantise() the value a sample reads back as, a step
+    of quantum() apart. A 16 or 24-bit sample with anything below the
+    bits in use reads as out of range.
+*/
+static int32_t quantum(void)
+{
+    return SAMPLE_FORMAT == 8 ? 1 << (SAMPLE_INPUT_BITS - 8) : 1;
+}
+
+static uint8_t code(int32_t value)
+{
+    int32_t top = value / quantum() - (value % quantum() < 0);
+    return (uint8_t)((top > INT8_MAX ? INT8_MAX : top < INT8_MIN ? INT8_MIN : top) + 128);
+}
+
+static int32_t quantise(int32_t value)
+{
+    int32_t top = (1 << (SAMPLE_INPUT_BITS - 1)) - 1;
+    value = value > top ? top : value < -top - 1 ? -top - 1 : value;
+    return SAMPLE_FORMAT == 8 ? ((int32_t)code(value) - 128) * quantum() : value;
+}
+
+/*
+    A sign-extended sample of bits bits with the ones in use at the top.
+*/
+static int32_t unscale(int32_t value, uint32_t bits)
+{
+    int32_t below = (int32_t)1 << (bits - SAMPLE_INPUT_BITS);
+    return value % below ? INT32_MAX : value / below;
+}
+
+static int32_t unpack(const uint8_t *p)
+{
+    float value;
+    switch (SAMPLE_FORMAT)
+    {
+    case 8:  return ((int32_t)p[0] - 128) * quantum();
+    case 24: return unscale((int32_t)(read_le(p, 3) << 8) / 256, 24);
+    case 32: memcpy(&value, p, sizeof value);
+             return (int32_t)lrintf(value * (1 << (SAMPLE_INPUT_BITS - 1)));
+    default: return unscale((int16_t)read_le(p, 2), 16);
+    }
+}
+
+static int32_t *read_samples(FIL *wave, uint32_t offset, uint32_t count)
+{
+    int32_t *sample = malloc((count + 1) * sizeof(*sample));
+    uint8_t bytes[512 * SAMPLE_BYTES];
+    UINT read = 0;
+    f_lseek(wave, offset);
+    for (uint32_t i = 0; sample && i < count; i += read / SAMPLE_BYTES)
+    {
+        uint32_t n = count - i < 512 ? count - i : 512;
+        if (f_read(wave, bytes, n * SAMPLE_BYTES, &read) != FR_OK || read != n * SAMPLE_BYTES)
+        {
+            free(sample);
+            return NULL;
+        }
+        for (uint32_t k = 0; k < n; k++)
+        {
+            sample[i + k] = unpack(bytes + k * SAMPLE_BYTES);
+        }
+    }
+    return sample;
+}
+
+static uint32_t floor_sqrt(uint64_t value)
+{
+    uint64_t root = (uint64_t)sqrt((double)value);
+    while (root * root > value)
+    {
+        root--;
+    }
+    while ((root + 1) * (root + 1) <= value)
+    {
+        root++;
+    }
+    return (uint32_t)root;
+}
+
+/*
+    The summary beside the recording against the samples in it: the
+    header, a count that is either patched or left 0 by a power fail
+    over the records synced before it, and every record there
+    recomputed from the data, to within what an 8-bit
+    sample keeps. The summary is taken before packing, so a block that
+    saturates an 8-bit sample reads back with the lower RMS.
+*/
+static bool verify_peaks(const int32_t *sample, uint32_t samples, uint32_t rate)
+{
+    FIL file;
+    UINT read;
+    uint8_t header[PEAKS_HEADER];
+    char path[CATALOG_PATH];
+    strcpy(path, catalog_latest());
+    strcpy(path + strlen(path) - 3, "PKS");
+    uint32_t expected = (samples + PEAKS_SAMPLES - 1) / PEAKS_SAMPLES;
+    if (f_open(&file, path, FA_READ) != FR_OK ||
+        f_read(&file, header, sizeof(header), &read) != FR_OK || read != sizeof(header))
+    {
+        printf("verify: %s missing or short\n", path);
+        return false;
+    }
+    uint32_t count = read_le(header + 12, 4);
+    uint32_t stored = (file.fsize - PEAKS_HEADER) / PEAKS_RECORD;
+    if (memcmp(header, "PKS1", 4) || read_le(header + 4, 4) != rate ||
+        read_le(header + 8, 2) != PEAKS_SAMPLES || read_le(header + 10, 2) != PEAKS_RECORD ||
+        (count ? count != expected || stored != expected : stored > expected) ||
+        file.fsize != PEAKS_HEADER + stored * PEAKS_RECORD)
+    {
+        printf("verify: %s header or size wrong for %lu samples\n", path, (unsigned long)samples);
+        f_close(&file);
+        return false;
+    }
+    uint32_t errors = 0;
+    for (uint32_t r = 0; r < stored; r++)
+    {
+        uint8_t record[PEAKS_RECORD];
+        const int32_t *block = sample + r * PEAKS_SAMPLES;
+        uint32_t n = samples - r * PEAKS_SAMPLES < PEAKS_SAMPLES ? samples - r * PEAKS_SAMPLES : PEAKS_SAMPLES;
+        int32_t min = INT32_MAX;
+        int32_t max = INT32_MIN;
+        uint64_t squares = 0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            min = block[i] < min ? block[i] : min;
+            max = block[i] > max ? block[i] : max;
+            squares += (uint64_t)((int64_t)block[i] * block[i]);
+        }
+        f_read(&file, record, sizeof(record), &read);
+        int32_t rms = (int32_t)read_le(record + 4, 2) - (int32_t)floor_sqrt(squares / n);
+        bool saturated = min == quantise(INT16_MIN) || max == quantise(INT16_MAX);
+        if (quantise((int16_t)read_le(record, 2)) != min || quantise((int16_t)read_le(record + 2, 2)) != max ||
+            rms < -quantum() || (rms > quantum() && !saturated))
+        {
+            errors++;
+        }
+    }
+    f_close(&file);
+    printf("peaks: %lu of %lu records of %u samples, count %s, %lu mismatched\n", (unsigned long)stored,
+           (unsigned long)expected, (unsigned)PEAKS_SAMPLES, count ? "patched" : "left 0", (unsigned long)errors);
+    return errors == 0;
+}
+
+/*
+    The gain log beside the recording against the samples in it: one
+    record per block with the gain only ever cut at a block's start, by
+    the limiter, and never past the most allowed. For the ramp source,
+    the counter is found from the first samples and every sample checked
+    to be exactly the counter times the logged gain, so the log gives
+    back what was captured. As with the summary, a power fail may leave
+    the count 0 over the records synced before it.
+*/
+static bool verify_agc(const int32_t *sample, uint32_t samples, uint32_t rate, Sim_signal signal)
+{
+    FIL file;
+    UINT read;
+    uint8_t header[AGC_HEADER];
+    char path[CATALOG_PATH];
+    strcpy(path, catalog_latest());
+    strcpy(path + strlen(path) - 3, "AGC");
+    uint32_t block = BLOCKPOOL_BLOCK_SAMPLES;
+    uint32_t expected = (samples + block - 1) / block;
+    if (f_open(&file, path, FA_READ) != FR_OK ||
+        f_read(&file, header, sizeof(header), &read) != FR_OK || read != sizeof(header))
+    {
+        printf("verify: %s missing or short\n", path);
+        return false;
+    }
+    uint32_t count = read_le(header + 12, 4);
+    uint32_t stored = (file.fsize - AGC_HEADER) / AGC_RECORD;
+    if (memcmp(header, "AGC1", 4) || read_le(header + 4, 4) != rate ||
+        read_le(header + 8, 2) != block || read_le(header + 10, 2) != AGC_RECORD ||
+        (count ? count != expected || stored != expected : stored > expected) ||
+        file.fsize != AGC_HEADER + stored * AGC_RECORD)
+    {
+        printf("verify: %s header or size wrong for %lu samples\n", path, (unsigned long)samples);
+        f_close(&file);
+        return false;
+    }
+    uint32_t errors = 0;
+    uint32_t clipped = 0;
+    uint32_t previous = AGC_UNITY;
+    uint32_t highest = 0;
+    int32_t counter = -1;
+    for (uint32_t r = 0; r < stored; r++)
+    {
+        uint8_t record[AGC_RECORD];
+        const int32_t *value = sample + r * block;
+        uint32_t n = samples - r * block < block ? samples - r * block : block;
+        f_read(&file, record, sizeof(record), &read);
+        uint32_t start = read_le(record, 4);
+        uint32_t end = read_le(record + 4, 4);
+        if (start > previous || start > (uint32_t)agc.max_gain << 16 || end > (uint32_t)agc.max_gain << 16)
+        {
+            errors++;
+        }
+        previous = end;
+        highest = end > highest ? end : highest;
+        int32_t step = ((int32_t)end - (int32_t)start) / (int32_t)n;
+        /*
+            The counter at the recording's first sample: the one the
+            first samples agree with.
+        */
+        for (int32_t v = 0; signal == SIM_SIGNAL_RAMP && counter < 0 && v <= 0x0FFF; v++)
+        {
+            uint32_t i = 0;
+            while (i < n && i < 1024 && value[i] ==
+                   quantise((int32_t)(((int64_t)((v + i) & 0x0FFF) - DC_BIAS) * ((int32_t)start + (int32_t)i * step) >> 16)))
+            {
+                i++;
+            }
+            counter = i == n || i == 1024 ? v : -1;
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (value[i] == quantise(INT16_MAX) || value[i] == INT16_MIN)
+            {
+                clipped++;
+            }
+            if (signal == SIM_SIGNAL_RAMP)
+            {
+                int64_t input = (int64_t)(((uint32_t)counter + r * block + i) & 0x0FFF) - DC_BIAS;
+                int64_t output = input * ((int32_t)start + (int32_t)i * step) >> 16;
+                output = output > INT16_MAX ? INT16_MAX : output < INT16_MIN ? INT16_MIN : output;
+                errors += value[i] != quantise((int32_t)output);
+            }
+        }
+    }
+    f_close(&file);
+    printf("agc: %lu of %lu records, gain %.2f at most, %lu samples clipped, %lu mismatched\n",
+           (unsigned long)stored, (unsigned long)expected, (double)highest / AGC_UNITY,
+           (unsigned long)clipped, (unsigned long)errors);
+    return errors == 0 && clipped == 0;
+}
+
+#ifdef SPECTRUM
+/*
+    spectrum.c's level of an energy: 4 log2, the top bit and the two
+    below it.
+*/
+static uint32_t spectrum_level(double energy)
+{
+    if (energy < 1)
+    {
+        return 0;
+    }
+    int top = (int)floor(log2(energy));
+    return (uint32_t)(4 * top + ((uint64_t)ldexp(energy, 2 - top) & 3));
+}
+
+/*
+    The band energies beside the recording against a double precision
+    DFT of the samples in it, scaled as fft_power() scales. The blocks
+    drained after a power fail are not analysed, so there may be fewer
+    records than frames. Levels more than one apart count as mismatched;
+    bands under 2^10, where the fixed point rounding dominates, are left
+    out.
+*/
+static bool verify_spectrum(const int32_t *sample, uint32_t samples, uint32_t rate)
+{
+    static double cosine[FFT_SAMPLES];
+    FIL file;
+    UINT read;
+    uint8_t header[SPECTRUM_HEADER];
+    char path[CATALOG_PATH];
+    strcpy(path, catalog_latest());
+    strcpy(path + strlen(path) - 3, "SPC");
+    uint32_t frames = samples / FFT_SAMPLES;
+    if (f_open(&file, path, FA_READ) != FR_OK ||
+        f_read(&file, header, sizeof(header), &read) != FR_OK || read != sizeof(header))
+    {
+        printf("verify: %s missing or short\n", path);
+        return false;
+    }
+    uint32_t count = read_le(header + 12, 4);
+    uint32_t stored = (file.fsize - SPECTRUM_HEADER) / SPECTRUM_BANDS;
+    if (memcmp(header, "SPC1", 4) || read_le(header + 4, 4) != rate ||
+        read_le(header + 8, 2) != FFT_SAMPLES || read_le(header + 10, 2) != SPECTRUM_BANDS ||
+        read_le(header + 16, 2) != 1 || read_le(header + 16 + 2 * SPECTRUM_BANDS, 2) != FFT_BINS ||
+        (count && count != stored) || stored > frames ||
+        file.fsize != SPECTRUM_HEADER + stored * SPECTRUM_BANDS)
+    {
+        printf("verify: %s header or size wrong for %lu frames\n", path, (unsigned long)frames);
+        f_close(&file);
+        return false;
+    }
+    for (uint32_t n = 0; n < FFT_SAMPLES; n++)
+    {
+        cosine[n] = cos(2 * acos(-1.0) * n / FFT_SAMPLES);
+    }
+    uint32_t errors = 0;
+    uint32_t compared = 0;
+    for (uint32_t r = 0; r < stored; r++)
+    {
+        uint8_t record[SPECTRUM_BANDS];
+        double x[FFT_SAMPLES];
+        double power[FFT_BINS];
+        for (uint32_t n = 0; n < FFT_SAMPLES; n++)
+        {
+            x[n] = sample[r * FFT_SAMPLES + n] * (1 - cosine[n]) / 2 / FFT_SAMPLES;
+        }
+        for (uint32_t k = 0; k < FFT_BINS; k++)
+        {
+            double re = 0;
+            double im = 0;
+            for (uint32_t n = 0; n < FFT_SAMPLES; n++)
+            {
+                re += x[n] * cosine[k * n % FFT_SAMPLES];
+                im -= x[n] * cosine[(k * n + FFT_SAMPLES * 3 / 4) % FFT_SAMPLES];
+            }
+            power[k] = re * re + im * im;
+        }
+        f_read(&file, record, sizeof(record), &read);
+        for (uint32_t b = 0; b < SPECTRUM_BANDS; b++)
+        {
+            double energy = 0;
+            for (uint32_t k = read_le(header + 16 + 2 * b, 2); k < read_le(header + 18 + 2 * b, 2); k++)
+            {
+                energy += power[k];
+            }
+            uint32_t level = spectrum_level(energy);
+            if (level < 40)
+            {
+                continue;
+            }
+            compared++;
+            if ((uint32_t)record[b] + 1 < level || record[b] > level + 1)
+            {
+                errors++;
+            }
+        }
+    }
+    f_close(&file);
+    printf("spectrum: %lu records of %u bands, count %s, %lu of %lu band levels off by more than 0.75 dB\n",
+           (unsigned long)stored, (unsigned)SPECTRUM_BANDS, count ? "patched" : "left 0",
+           (unsigned long)errors, (unsigned long)compared);
+    return errors == 0;
+}
+#endif
+
+/*
+    Consistency of the header against the file size, and for the ramp
+    source that no sample was dropped or repeated on the way to the card.
+*/
+static bool verify(Sim_signal signal)
+{
+    FIL file;
+    UINT read;
+    uint8_t header[WAVE_DATA_OFFSET];
+    bool ok = true;
+    f_mount(0, &fatfs);
+    if (catalog_build() != FR_OK || !catalog_latest() ||
+        f_open(&file, catalog_latest(), FA_READ) != FR_OK ||
+        f_read(&file, header, sizeof(header), &read) != FR_OK || read != sizeof(header))
+    {
+        printf("verify: recording missing or short\n");
+        f_mount(0, NULL);
+        return false;
+    }
+    uint32_t size = file.fsize;
+    /*
+        Walk the chunks after "WAVE" to the data chunk.
+    */
+    uint32_t offset = 12;
+    while (offset + 8 <= sizeof(header) && memcmp(header + offset, "data", 4))
+    {
+        offset += 8 + read_le(header + offset + 4, 4);
+    }
+    uint32_t data = offset + 8 <= sizeof(header) ? read_le(header + offset + 4, 4) : 0;
+    uint32_t rate = read_le(header + 24, 4);
+    uint32_t samples = data / SAMPLE_BYTES;
+    if (offset + 8 > sizeof(header) || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4) ||
+        read_le(header + 4, 4) != size - 8 || data != size - (offset + 8) || data % SAMPLE_BYTES ||
+        read_le(header + 20, 2) != SAMPLE_WAVE_FORMAT || read_le(header + 34, 2) != SAMPLE_BITS)
+    {
+        printf("verify: header does not match file size %lu or format\n", (unsigned long)size);
+        ok = false;
+    }
+    printf("file: %lu bytes, %lu Hz, %u bit%s, %lu samples from offset %lu\n", (unsigned long)size,
+           (unsigned long)rate, (unsigned)read_le(header + 34, 2),
+           read_le(header + 20, 2) == WAVE_FORMAT_FLOAT ? " float" : "",
+           (unsigned long)samples, (unsigned long)(offset + 8));
+    int32_t *sample = ok ? read_samples(&file, offset + 8, samples) : NULL;
+    if (ok && !sample)
+    {
+        printf("verify: samples unreadable\n");
+        ok = false;
+    }
+    /*
+        The counter at the first sample is the one the first samples
+        agree with; an 8-bit sample only pins it where its top byte
+        steps.
+    */
+    if (ok && signal == SIM_SIGNAL_RAMP && !agc_enabled())
+    {
+        uint32_t errors = samples;
+        for (uint32_t v = 0; v <= 0x0FFF && errors == samples; v++)
+        {
+            uint32_t i = 0;
+            while (i < samples && i < 4096 && sample[i] == quantise((int32_t)((v + i) & 0x0FFF) - DC_BIAS))
+            {
+                i++;
+            }
+            if (i < samples && i < 4096)
+            {
+                continue;
+            }
+            errors = 0;
+            for (i = 0; i < samples; i++)
+            {
+                errors += sample[i] != quantise((int32_t)((v + i) & 0x0FFF) - DC_BIAS);
+            }
+        }
+        if (errors)
+        {
+            printf("verify: %lu ramp discontinuities\n", (unsigned long)errors);
+            ok = false;
+        }
+    }
+    if (ok)
+    {
+        ok = verify_peaks(sample, samples, rate);
+    }
+    if (ok && agc_enabled())
+    {
+        ok = verify_agc(sample, samples, rate, signal);
+    }
+#ifdef SPECTRUM
+    if (ok)
+    {
+        ok = verify_spectrum(sample, samples, rate);
+    }
+#endif
+    free(sample);
+    f_close(&file);
+    f_mount(0, NULL);
+    return ok;
+}
+
+static bool populate(uint32_t files)
+{
+    FIL file;
+    char name[24];
+    f_mount(0, &fatfs);
+    FRESULT result = f_mkdir("SCAN");
+    if (result == FR_EXIST)
+    {
+        result = FR_OK;
+    }
+    for (uint32_t i = 0; result == FR_OK && i < files; i++)
+    {
+        snprintf(name, sizeof name, "SCAN/F%05lu.DAT", (unsigned long)i);
+        result = f_open(&file, name, FA_CREATE_NEW|FA_WRITE);
+        if (result == FR_OK)
+        {
+            result = f_close(&file);
+        }
+        else if (result == FR_EXIST)
+        {
+            result = FR_OK;
+        }
+    }
+    f_mount(0, NULL);
+    return result == FR_OK;
+}
+
+/*
+    At the full clock, as the recorder mounts: card initialisation and
+    the boot sector and FSINFO reads, then every entry of SCAN.
+*/
+static bool measure_scan(void)
+{
+    DIR dir;
+    FILINFO info;
+    uint32_t entries = 0;
+    init_clock(SYSCTL_CLOCK_MAX);
+    uint64_t begin = sim_now();
+    f_mount(0, &fatfs);
+    FRESULT result = f_opendir(&dir, "");
+    uint64_t mounted = sim_now();
+    if (result == FR_OK)
+    {
+        result = f_opendir(&dir, "SCAN");
+    }
+    while (result == FR_OK && (result = f_readdir(&dir, &info)) == FR_OK && info.fname[0])
+    {
+        entries++;
+    }
+    uint64_t scanned = sim_now();
+    FIL file;
+    if (result == FR_OK)
+    {
+        result = f_open(&file, "SCAN/NEW.DAT", FA_CREATE_NEW|FA_WRITE);
+    }
+    if (result == FR_OK)
+    {
+        result = f_close(&file);
+    }
+    uint64_t created = sim_now();
+    if (result == FR_OK)
+    {
+        result = f_unlink("SCAN/NEW.DAT");
+    }
+    f_mount(0, NULL);
+    printf("mount: %.3f ms, scan: %lu entries in %.3f ms, create: %.3f ms\n", (double)(mounted - begin) / SIM_PS_PER_MS,
+           (unsigned long)entries, (double)(scanned - mounted) / SIM_PS_PER_MS,
+           (double)(created - scanned) / SIM_PS_PER_MS);
+    return result == FR_OK;
+}
+
+static bool populate_recordings(uint32_t recordings)
+{
+    FIL file;
+    f_mount(0, &fatfs);
+    FRESULT result = catalog_build();
+    for (uint32_t i = catalog_count(); result == FR_OK && i < recordings; i++)
+    {
+        result = catalog_create(&file);
+        if (result == FR_OK)
+        {
+            result = f_close(&file);
+        }
+    }
+    f_mount(0, NULL);
+    return result == FR_OK;
+}
+
+/*
+    At the full clock, as the recorder mounts: the catalog walk, then
+    one more recording created and removed again.
+*/
+static bool measure_catalog(void)
+{
+    FIL file;
+    init_clock(SYSCTL_CLOCK_MAX);
+    f_mount(0, &fatfs);
+    uint64_t begin = sim_now();
+    FRESULT result = catalog_build();
+    uint64_t built = sim_now();
+    if (result == FR_OK)
+    {
+        result = catalog_create(&file);
+    }
+    if (result == FR_OK)
+    {
+        result = f_close(&file);
+    }
+    uint64_t created = sim_now();
+    if (result == FR_OK)
+    {
+        result = f_unlink(catalog_latest());
+    }
+    f_mount(0, NULL);
+    printf("catalog: %lu recordings in %lu buckets, built in %.3f ms, create: %.3f ms\n",
+           (unsigned long)catalog_count() - 1, (unsigned long)catalog_buckets(),
+           (double)(built - begin) / SIM_PS_PER_MS, (double)(created - built) / SIM_PS_PER_MS);
+    return result == FR_OK;
+}
+
+/*
+    A sawtooth whose step is not a divisor of the range, so every
+    sample differs from its neighbours. It is written play_bits wide, a
+    24-bit sample with its low byte set as well, and play_sample() is
+    what the player should make of it.
+*/
+
+static int16_t play_source(uint32_t i)
+{
+    return (int16_t)(uint16_t)(i * 331);
+}
+
+static int16_t play_sample(uint32_t i)
+{
+    return play_bits == 8 ? (int16_t)((play_source(i) >> 8) * 256) : play_source(i);
+}
+
+static uint32_t play_encode(uint32_t i, uint8_t *bytes)
+{
+    int16_t value = play_source(i);
+    float real = value / 32768.0f;
+    switch (play_bits)
+    {
+    case 8:  bytes[0] = (uint8_t)((value >> 8) + 128);
+             return 1;
+    case 24: bytes[0] = (uint8_t)i;
+             bytes[1] = (uint8_t)value;
+             bytes[2] = (uint8_t)(value >> 8);
+             return 3;
+    case 32: memcpy(bytes, &real, sizeof real);
+             return 4;
+    default: bytes[0] = (uint8_t)value;
+             bytes[1] = (uint8_t)(value >> 8);
+             return 2;
+    }
+}
+
+static bool write_playback(uint32_t rate, uint32_t samples)
+{
+    FIL file;
+    UINT written;
+    Wave_info info = { .audio_format = play_bits == 32 ? WAVE_FORMAT_FLOAT : WAVE_FORMAT_PCM, .num_channels = 1,
+                       .bits_per_sample = (uint16_t)play_bits, .sample_rate = rate };
+    f_mount(0, &fatfs);
+    FRESULT result = catalog_build();
+    if (result == FR_OK)
+    {
+        result = catalog_create(&file);
+    }
+    if (result == FR_OK)
+    {
+        wave_write_header(&file, &info);
+        for (uint32_t i = 0; result == FR_OK && i < samples; i++)
+        {
+            uint8_t bytes[4];
+            result = f_write(&file, bytes, play_encode(i, bytes), &written);
+        }
+        info.chunk_size += samples * play_bits / 8;
+        wave_update_header(&file, &info);
+        if (result == FR_OK)
+        {
+            result = f_close(&file);
+        }
+    }
+    f_mount(0, NULL);
+    return result == FR_OK;
+}
+
+static void collect_pwm(Timer_module module, Timer_select select, uint32_t match)
+{
+    if (module == TIMER_MOD1 && select == TIMER_A && pwm.count < pwm.capacity)
+    {
+        pwm.match[pwm.count] = match;
+    }
+    pwm.count++;
+}
+
+/*
+    Every sample on the pin in order, once each, after the periods at
+    midscale between the timer starting and the first sample loading.
+*/
+static bool verify_playback(uint32_t samples)
+{
+    uint32_t lead = pwm.count - samples;
+    if (pwm.count < samples || pwm.count > pwm.capacity || lead > 2)
+    {
+        printf("verify: %lu PWM periods for %lu samples\n", (unsigned long)pwm.count, (unsigned long)samples);
+        return false;
+    }
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < pwm.count; i++)
+    {
+        uint32_t expected = player_match(i < lead ? 0 : play_sample(i - lead));
+        if (pwm.match[i] != expected && errors++ < 5)
+        {
+            printf("verify: period %lu has match %lu, expected %lu\n", (unsigned long)i,
+                   (unsigned long)pwm.match[i], (unsigned long)expected);
+        }
+    }
+    printf("pwm: %lu periods of %lu cycles, first sample in period %lu\n", (unsigned long)pwm.count,
+           (unsigned long)player_period(), (unsigned long)lead);
+    return !errors;
+}
+
+/*
+    Shows the report the benchmark left and checks its scratch file is
+    gone.
+*/
+static bool verify_bench(void)
+{
+    FIL file;
+    FILINFO info;
+    f_mount(0, &fatfs);
+    if (f_open(&file, "BENCH.TXT", FA_READ) != FR_OK || !file.fsize)
+    {
+        printf("verify: BENCH.TXT missing or empty\n");
+        f_mount(0, NULL);
+        return false;
+    }
+    char line[96];
+    while (f_gets(line, sizeof line, &file))
+    {
+        printf("  %s", line);
+    }
+    f_close(&file);
+    bool gone = f_stat("BENCH.TMP", &info) == FR_NO_FILE;
+    if (!gone)
+    {
+        printf("verify: BENCH.TMP left behind\n");
+    }
+    f_mount(0, NULL);
+    return gone;
+}
+
+/*
+    Marks a cluster as belonging to a file or directory; false if one
+    already has it.
+*/
+static bool claim(uint8_t *owned, DWORD cluster)
+{
+    if (cluster < 2 || cluster >= fatfs.n_fatent || owned[cluster / 8] & (1 << cluster % 8))
+    {
+        return false;
+    }
+    owned[cluster / 8] |= (uint8_t)(1 << cluster % 8);
+    return true;
+}
+
+/*
+    Reads the file in full a cluster at a time, claiming each cluster its
+    chain passes through.
+*/
+static FRESULT check_file(const char *path, uint8_t *owned)
+{
+    FIL file;
+    UINT read;
+    static uint8_t buffer[128 * 512];
+    UINT cluster = fatfs.csize * 512u;
+    FRESULT result = f_open(&file, path, FA_READ);
+    if (result != FR_OK)
+    {
+        return result;
+    }
+    for (DWORD left = file.fsize; result == FR_OK && left; left -= read)
+    {
+        result = f_read(&file, buffer, left < cluster ? left : cluster, &read);
+        if (result == FR_OK && (!read || !claim(owned, file.clust)))
+        {
+            result = FR_INT_ERR;
+        }
+    }
+    FRESULT closed = f_close(&file);
+    return result == FR_OK ? closed : result;
+}
+
+static FRESULT check_tree(char *path, uint8_t *owned, uint32_t *files)
+{
+    DIR dir;
+    FILINFO info;
+    size_t length = strlen(path);
+    DWORD cluster = 0;
+    FRESULT result = f_opendir(&dir, path);
+    while (result == FR_OK)
+    {
+        if (dir.clust != cluster && dir.clust)
+        {
+            cluster = dir.clust;
+            result = claim(owned, cluster) ? FR_OK : FR_INT_ERR;
+        }
+        if (result == FR_OK)
+        {
+            result = f_readdir(&dir, &info);
+        }
+        if (result != FR_OK || !info.fname[0])
+        {
+            break;
+        }
+        if (info.fname[0] == '.')
+        {
+            continue;
+        }
+        sprintf(path + length, "/%s", info.fname);
+        if (info.fattrib & AM_DIR)
+        {
+            result = check_tree(path, owned, files);
+        }
+        else
+        {
+            result = check_file(path, owned);
+            (*files)++;
+        }
+        if (result == FR_OK)
+        {
+            path[length] = '\0';
+        }
+    }
+    return result;
+}
+
+/*
+    After a run that was to fail: the volume still mounts, every file on
+    it reads back in full to its size, and no cluster belongs to two of
+    them.
+*/
+static bool verify_volume(void)
+{
+    char path[256] = "";
+    uint32_t files = 0;
+    f_mount(0, &fatfs);
+    FATFS *fs;
+    DWORD clusters;
+    FRESULT result = f_getfree("", &clusters, &fs);
+    uint8_t *owned = result == FR_OK ? calloc(fatfs.n_fatent / 8 + 1, 1) : NULL;
+    if (owned)
+    {
+        result = check_tree(path, owned, &files);
+        free(owned);
+    }
+    f_mount(0, NULL);
+    if (!owned || result != FR_OK)
+    {
+        printf("verify: volume %s %s\n", owned ? "inconsistent at" : "unmountable", path);
+    }
+    else
+    {
+        printf("volume: %lu files, %lu clusters free, consistent\n", (unsigned long)files, (unsigned long)clusters);
+    }
+    return owned && result == FR_OK;
+}
+
+/*
+    Has the card count writes to the second FAT, if the volume has one;
+    true if the recorder is to hold them back while it records.
+*/
+static bool watch_mirror(void)
+{
+    FATFS *fs;
+    DWORD clusters;
+    f_mount(0, &fatfs);
+    bool mounted = f_getfree("", &clusters, &fs) == FR_OK;
+    if (mounted && fatfs.n_fats >= 2)
+    {
+        sim_card_watch(fatfs.fatbase + fatfs.fsize, fatfs.fsize);
+    }
+    bool deferred = mounted && _FS_LAZY_MIRROR && fatfs.n_fats >= 2 && fatfs.fs_type != FS_FAT12;
+    f_mount(0, NULL);
+    return deferred;
+}
+
+/*
+    After a run: the mount restores a mirror that a power cut left
+    stale, so from then on both FATs read the same.
+*/
+static bool verify_mirror(uint32_t recording, uint32_t all)
+{
+    static uint8_t first[512];
+    static uint8_t second[512];
+    FATFS *fs;
+    DWORD clusters;
+    f_mount(0, &fatfs);
+    bool same = f_getfree("", &clusters, &fs) == FR_OK;
+    for (DWORD i = 0; same && fatfs.n_fats >= 2 && i < fatfs.fsize; i++)
+    {
+        same = sim_image_read(fatfs.fatbase + i, first) &&
+               sim_image_read(fatfs.fatbase + fatfs.fsize + i, second) && !memcmp(first, second, sizeof first);
+    }
+    f_mount(0, NULL);
+    printf("mirror: %lu FAT-2 sectors written while recording, %lu in all, FATs %s\n",
+           (unsigned long)recording, (unsigned long)all, same ? "identical" : "differ");
+    return same;
+}
+
+static const char *option(const char *arg, const char *key)
+{
+    size_t length = strlen(key);
+    if (!strncmp(arg, key, length) && arg[length] == '=')
+    {
+        return arg + length + 1;
+    }
+    return NULL;
+}
+
+static bool parse_signal(const char *signal, Sim_signal *source)
+{
+    if (!strncmp(signal, "sine:", 5))
+    {
+        *source = SIM_SIGNAL_SINE;
+        return sim_adc_source(*source, (uint32_t)atoi(signal + 5), NULL);
+    }
+    if (!strncmp(signal, "wav:", 4))
+    {
+        *source = SIM_SIGNAL_WAV;
+        return sim_adc_source(*source, 0, signal + 4);
+    }
+    *source = SIM_SIGNAL_RAMP;
+    return !strcmp(signal, "ramp");
+}
+
+static bool parse_fault(const char *fault, Sim_fault *kind, uint32_t *at)
+{
+    const char *count = strchr(fault, ':');
+    if (!count || atoi(count + 1) <= 0)
+    {
+        return false;
+    }
+    static const char *const name[] = { "command", "read", "write" };
+    for (uint32_t i = 0; i < sizeof(name) / sizeof(name[0]); i++)
+    {
+        if (!strncmp(fault, name[i], (size_t)(count - fault)) && strlen(name[i]) == (size_t)(count - fault))
+        {
+            *kind = (Sim_fault)(SIM_FAULT_COMMAND + i);
+            *at = (uint32_t)atoi(count + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_expect(const char *expect, Sm_status *status)
+{
+    static const char *const name[] = { "done", "failed", "powerfail" };
+    for (uint32_t i = 0; i < sizeof(name) / sizeof(name[0]); i++)
+    {
+        if (!strcmp(expect, name[i]))
+        {
+            *status = (Sm_status)(SM_DONE + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = DEFAULT_IMAGE;
+    double seconds = DEFAULT_SECONDS;
+    uint32_t mib = DEFAULT_MIB;
+    uint32_t fragment_mib = 0;
+    uint32_t fragment_holes = 0;
+    Sim_signal source = SIM_SIGNAL_RAMP;
+    Sim_card_profile profile = { .init_ms = 50, .read_us = 100, .program_us = 250,
+                                 .au_kib = 4096, .erase_ms = 50 };
+#ifdef INSTANT_ON
+    bool instant = true;
+#else
+    bool instant = false;
+#endif
+    bool reserve = true;
+    uint32_t bench_kib = 0;
+    uint32_t rate = 40000;
+    bool play = false;
+    uint32_t scan = 0;
+    uint32_t recordings = 0;
+    double power_fail = 0;
+    int32_t holdup_ms = -1;
+    Sim_fault fault = SIM_FAULT_NONE;
+    uint32_t fault_at = 0;
+    Sm_status expect = SM_BUSY;
+    bool ok = true;
+    for (int i = 1; ok && i < argc; i++)
+    {
+        const char *value;
+        if ((value = option(argv[i], "image")))
+        {
+            path = value;
+        }
+        else if ((value = option(argv[i], "size")))
+        {
+            mib = (uint32_t)atoi(value);
+        }
+        else if ((value = option(argv[i], "seconds")))
+        {
+            seconds = atof(value);
+        }
+        else if ((value = option(argv[i], "rate")))
+        {
+            rate = (uint32_t)atoi(value);
+            sm_set_sample_rate(rate);
+        }
+        else if ((value = option(argv[i], "signal")))
+        {
+            ok = parse_signal(value, &source);
+        }
+        else if ((value = option(argv[i], "init")))
+        {
+            profile.init_ms = (uint32_t)atoi(value);
+        }
+        else if ((value = option(argv[i], "read")))
+        {
+            profile.read_us = (uint32_t)atoi(value);
+        }
+        else if ((value = option(argv[i], "program")))
+        {
+            profile.program_us = (uint32_t)atoi(value);
+        }
+        else if ((value = option(argv[i], "gc")))
+        {
+            const char *ms = strchr(value, ':');
+            profile.gc_interval = (uint32_t)atoi(value) << 10;
+            profile.gc_ms = ms ? (uint32_t)atoi(ms + 1) : 0;
+            ok = ms != NULL;
+        }
+        else if ((value = option(argv[i], "au")))
+        {
+            profile.au_kib = (uint32_t)atoi(value);
+            ok = sim_card_au_size(profile.au_kib) != 0;
+        }
+        else if ((value = option(argv[i], "erase")))
+        {
+            profile.erase_ms = (uint32_t)atoi(value);
+        }
+        else if ((value = option(argv[i], "reserve")))
+        {
+            reserve = atoi(value) != 0;
+            sm_set_reserve(reserve);
+        }
+        else if ((value = option(argv[i], "instant")))
+        {
+            instant = atoi(value) != 0;
+            sm_set_instant_on(instant);
+        }
+        else if ((value = option(argv[i], "fragment")))
+        {
+            const char *holes = strchr(value, ':');
+            fragment_mib = (uint32_t)atoi(value);
+            fragment_holes = holes ? (uint32_t)atoi(holes + 1) : 0;
+            ok = fragment_holes >= 2;
+        }
+        else if ((value = option(argv[i], "powerfail")))
+        {
+            const char *ms = strchr(value, ':');
+            power_fail = atof(value);
+            holdup_ms = ms ? atoi(ms + 1) : -1;
+            ok = power_fail > 0 && (!ms || holdup_ms >= 0);
+        }
+        else if ((value = option(argv[i], "trace")))
+        {
+            profile.trace = value;
+        }
+        else if ((value = option(argv[i], "fault")))
+        {
+            ok = parse_fault(value, &fault, &fault_at);
+        }
+        else if ((value = option(argv[i], "expect")))
+        {
+            ok = parse_expect(value, &expect);
+        }
+        else if ((value = option(argv[i], "bench")))
+        {
+            bench_kib = (uint32_t)atoi(value);
+            sm_set_bench_size(bench_kib * 1024);
+            ok = bench_kib != 0;
+        }
+        else if ((value = option(argv[i], "play")))
+        {
+            uint32_t bits = (uint32_t)atoi(value);
+            play = bits != 0;
+            play_bits = bits > 1 ? bits : SAMPLE_BITS;
+            ok = bits <= 1 || bits == 8 || bits == 16 || bits == 24 || bits == 32;
+        }
+        else if ((value = option(argv[i], "scan")))
+        {
+            scan = (uint32_t)atoi(value);
+        }
+        else if ((value = option(argv[i], "recordings")))
+        {
+            recordings = (uint32_t)atoi(value);
+        }
+#ifdef AGC
+        else if ((value = option(argv[i], "agc")))
+        {
+            const char *release = strchr(value, ':');
+            const char *gain = release ? strchr(release + 1, ':') : NULL;
+            agc.attack_ms = (uint32_t)atoi(value);
+            agc.release_ms = release ? (uint32_t)atoi(release + 1) : 0;
+            agc.max_gain = gain ? (uint16_t)atoi(gain + 1) : AGC_MAX_GAIN;
+            sm_set_agc(&agc);
+            ok = release && agc.max_gain;
+        }
+#endif
+        else
+        {
+            ok = false;
+        }
+    }
+    if (!ok || seconds <= 0 || !mib || ((bench_kib || play) && power_fail > 0) || (bench_kib && play))
+    {
+        fprintf(stderr, "usage: %s [image=FILE] [size=MIB] [seconds=S] [rate=HZ]\n"
+                        "       [signal=ramp|sine:HZ|wav:FILE]\n"
+                        "       [init=MS] [read=US] [program=US] [gc=KIB:MS] [trace=FILE]\n"
+                        "       [au=KIB] [erase=MS] [reserve=0|1] [fragment=MIB:K]\n"
+                        "       [instant=0|1] [powerfail=S[:MS]] [fault=command|read|write:N]\n"
+                        "       [expect=done|failed|powerfail]\n"
+                        "       [bench=KIB] [play=0|1|BITS] [scan=N] [recordings=N]\n"
+                        "       [agc=ATTACK:RELEASE[:GAIN]]\n", argv[0]);
+        return 2;
+    }
+    if (!sim_card_profile(&profile))
+    {
+        fprintf(stderr, "%s: cannot load trace\n", profile.trace);
+        return 2;
+    }
+    sim_ssi_attach(SSI_MOD1, sim_card_exchange);
+    uint64_t reset = sim_now();
+    init();
+    uint32_t play_samples = (uint32_t)(seconds * rate);
+    if (!sim_image_open(path, mib * 2048) || !format() ||
+        (fragment_mib && !fragment(fragment_mib, fragment_holes)) ||
+        (recordings && !populate_recordings(recordings)) ||
+        (play && !write_playback(rate, play_samples)) || (scan && !populate(scan)))
+    {
+        fprintf(stderr, "%s: cannot prepare disk image\n", path);
+        return 2;
+    }
+    bool deferred = watch_mirror();
+    sim_card_fault(fault, fault_at);
+    if (expect == SM_BUSY)
+    {
+        expect = power_fail > 0 ? SM_POWER_FAIL : SM_DONE;
+    }
+
+    /*
+        Card inserted from power-up, start pressed shortly after, stop
+        pressed once the requested length has been recorded. Both stay
+        held: the recorder only polls them between card accesses, which
+        calibration or a stalling card can stretch past a short press.
+        A benchmark instead has start and unmount held from reset, and
+        playback has stop held.
+    */
+    uint64_t start = sim_now() + START_PRESS_MS * SIM_PS_PER_MS;
+    uint64_t stop = start + (uint64_t)(seconds * SIM_PS_PER_SECOND);
+    uint64_t limit = stop + FINISH_LIMIT_S * SIM_PS_PER_SECOND;
+    uint64_t recorded = stop;
+    sim_schedule_pin(sim_now(), GPIO_PORTD, GPIO_BIT4, false);
+    if (bench_kib)
+    {
+        sim_schedule_pin(sim_now(), GPIO_PORTF, GPIO_BIT4, false);
+        sim_schedule_pin(sim_now(), GPIO_PORTF, GPIO_BIT6, false);
+        limit = sim_now() + BENCH_LIMIT_S * SIM_PS_PER_SECOND;
+    }
+    else if (play)
+    {
+        sim_schedule_pin(sim_now(), GPIO_PORTF, GPIO_BIT5, false);
+        pwm.capacity = play_samples + 16;
+        pwm.match = malloc(pwm.capacity * sizeof(*pwm.match));
+        sim_timer_pwm_sink(collect_pwm);
+    }
+    else
+    {
+        sim_schedule_pin(start, GPIO_PORTF, GPIO_BIT4, false);
+        sim_schedule_pin(stop, GPIO_PORTF, GPIO_BIT5, false);
+    }
+    if (power_fail > 0)
+    {
+        uint64_t drop = start + (uint64_t)(power_fail * SIM_PS_PER_SECOND);
+        sim_comp_supply_fail(drop);
+        recorded = drop < stop ? drop : stop;
+        if (holdup_ms >= 0)
+        {
+            sim_card_power_off(drop + (uint64_t)holdup_ms * SIM_PS_PER_MS);
+        }
+    }
+
+    Sim_disk_stats before;
+    Sim_disk_stats after;
+    Sim_disk_stats opened;
+    Sim_disk_stats closing;
+    sim_card_stats(&before);
+    opened = closing = before;
+    bool opened_seen = false;
+    uint64_t begin = sim_now();
+    /*
+        The firmware times from init(); preparing the image took place in
+        between and is taken back out, as if the recorder had just reset.
+    */
+    uint32_t prepare_us = (uint32_t)((begin - reset) / SIM_PS_PER_US);
+    clock_t wall = clock();
+    sim_stack_paint();
+
+    while (sm_status() == SM_BUSY && sim_now() < limit)
+    {
+        sm_execute();
+        /*
+            The recording's FAT writes are counted from the file opening,
+            its preallocation synced, to the stop press or supply drop.
+        */
+        if (!opened_seen && sm_file_ready())
+        {
+            sim_card_stats(&opened);
+            opened_seen = true;
+        }
+        if (sim_now() < recorded)
+        {
+            sim_card_stats(&closing);
+        }
+        /*
+            Branch back to the top of the main loop.
+        */
+        sim_advance(SIM_BUS_CYCLES);
+    }
+
+    uint32_t stack = stack_high_water();
+    double host = (double)(clock() - wall) / CLOCKS_PER_SEC;
+    double simulated = (double)(sim_now() - begin) / SIM_PS_PER_SECOND;
+    sim_card_stats(&after);
+    printf("state: %s\n", sm_status() == SM_DONE ? "done" : sm_status() == SM_FAILED ? "failed" :
+                           sm_status() == SM_POWER_FAIL ? "power fail" : "hung");
+    printf("simulated: %.3f s in %.3f s host (%.1fx real time)\n",
+           simulated, host, host > 0 ? simulated / host : 0.0);
+    printf("throughput: %lu bytes/s sustained\n", (unsigned long)capture_throughput());
+    printf("clock: %lu Hz after recording\n", (unsigned long)sysctl_get_clock());
+    printf("conversions: %lu, overruns: %lu, adc isr %lu cycles worst case\n",
+           (unsigned long)sim_adc_conversions(), (unsigned long)sm_overruns(),
+           (unsigned long)sm_isr_cycles());
+    printf("capture latency: %lu cycles worst case\n", (unsigned long)sm_capture_latency());
+    if (sm_first_sample())
+    {
+        uint32_t first = sm_first_sample() - prepare_us;
+        printf("first sample: %.3f ms after reset", (double)first / 1000);
+        if (!instant)
+        {
+            printf(", %.3f ms after start", (double)sm_trigger_latency() / 1000);
+        }
+        printf(", file open %.3f ms later\n", (double)(sm_file_ready() - sm_first_sample()) / 1000);
+    }
+    const Bench_result *bench = sm_bench();
+    if (bench)
+    {
+        printf("bench: %lu KiB streamed at %lu bytes/s, f_write %.3f ms worst case, busy %.3f ms worst case\n",
+               (unsigned long)(bench->size / 1024), (unsigned long)bench->write_rate,
+               (double)bench->stream.max / 1000, (double)bench->busy.max / 1000);
+    }
+    if (play)
+    {
+        printf("playback: %lu of %lu samples, %lu underruns, block read %.3f ms worst case (%.3f ms per block)\n",
+               (unsigned long)sm_played(), (unsigned long)play_samples, (unsigned long)sm_underruns(),
+               (double)sm_read_latency() / 1000, 1000.0 * player_fill(BLOCKPOOL_BLOCK_SIZE) / (play_bits / 8) / rate);
+    }
+    if (sm_status() == SM_POWER_FAIL)
+    {
+        printf("power fail: recording closed %.3f ms after the supply dropped\n",
+               (double)sm_power_flush() / 1000);
+    }
+    if (agc_enabled())
+    {
+        printf("agc: %.2f cycles per sample on average, %.2f worst case\n",
+               (double)sm_agc_cycles() / BLOCKPOOL_BLOCK_SAMPLES, (double)sm_agc_worst() / BLOCKPOOL_BLOCK_SAMPLES);
+    }
+#ifdef SPECTRUM
+    printf("spectrum: %lu blocks analysed, %lu cycles per block on average, %lu worst case\n",
+           (unsigned long)sm_spectrum_blocks(), (unsigned long)sm_spectrum_cycles(),
+           (unsigned long)sm_spectrum_worst());
+#endif
+    printf("window copies while recording: %lu\n", (unsigned long)sm_window_copies());
+    printf("block write latency: %.3f ms worst case\n", (double)sm_write_latency() / 1000);
+    printf("free cluster search: %lu FAT entries read while recording\n", (unsigned long)sm_fat_entries());
+    printf("reservation: %.3f ms worst case, %lu units written unerased\n",
+           (double)sm_reserve_latency() / 1000, (unsigned long)sm_erases_skipped());
+    printf("pool: %lu blocks of %u bytes, %lu free at worst\n", (unsigned long)blockpool_count(),
+           (unsigned)BLOCKPOOL_BLOCK_SIZE, (unsigned long)blockpool_low());
+    printf("stack: %lu bytes deepest on the host, %lu reserved on the target\n", (unsigned long)stack,
+           (unsigned long)stack_size());
+    printf("card: %lu writes (%lu sectors), %lu reads (%lu sectors), %lu erases (%lu sectors),\n"
+           "      busy %.1f%%, longest %.3f ms\n",
+           (unsigned long)(after.writes - before.writes),
+           (unsigned long)(after.sectors_written - before.sectors_written),
+           (unsigned long)(after.reads - before.reads),
+           (unsigned long)(after.sectors_read - before.sectors_read),
+           (unsigned long)(after.erases - before.erases),
+           (unsigned long)(after.sectors_erased - before.sectors_erased),
+           100.0 * (double)(after.busy - before.busy) / (double)(sim_now() - begin),
+           (double)after.longest / SIM_PS_PER_MS);
+
+    /*
+        Power back on to read what made it to the card.
+    */
+    sim_card_power_off(SIM_NEVER);
+    sim_card_fault(SIM_FAULT_NONE, 0);
+    if (expect == SM_FAILED)
+    {
+        ok = sm_status() == SM_FAILED && verify_volume();
+    }
+    else if (bench_kib)
+    {
+        ok = sm_status() == SM_DONE && bench && verify_bench();
+    }
+    else if (play)
+    {
+        ok = sm_status() == SM_DONE && sm_underruns() == 0 && sm_played() == play_samples &&
+             verify_playback(play_samples);
+        free(pwm.match);
+    }
+    else
+    {
+        ok = sm_status() == expect && sm_overruns() == 0 && sm_window_copies() == 0 && verify(source);
+        /*
+            A reservation erases the unit it takes unless the pool had no
+            room for the erase or the supply failed first; none erased
+            otherwise means the data area is off the unit grid and every
+            run fell back to unaligned clusters.
+        */
+        if (reserve && power_fail <= 0 && after.erases == before.erases && !sm_erases_skipped())
+        {
+            printf("reserve: no allocation unit erased\n");
+            ok = false;
+        }
+    }
+    if (!bench_kib && !play)
+    {
+        /*
+            A run that was to fail may close early, so its FAT writes are
+            not held to the recording window.
+        */
+        uint32_t recording = opened_seen ? closing.sectors_watched - opened.sectors_watched : 0;
+        ok = verify_mirror(recording, after.sectors_watched - before.sectors_watched) && ok;
+        if (deferred && expect != SM_FAILED && recording)
+        {
+            ok = false;
+        }
+    }
+    if (scan)
+    {
+        ok = measure_scan() && ok;
+    }
+    if (recordings)
+    {
+        ok = measure_catalog() && ok;
+    }
+    sim_image_close();
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
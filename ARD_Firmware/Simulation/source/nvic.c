@@ -0,0 +1,232 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "nvic.h"
+#include "sim.h"
+
+#define NVIC_VECTOR_MAX (NVIC_VECTOR_PWM1_FAULT + 1)
+
+extern void isr_systick(void);
+extern void isr_timer0A(void);
+extern void isr_timer1A(void);
+extern void isr_adc0_sequence0(void);
+extern void isr_comp0(void);
+
+/*
+    Mirrors the vector table in startup.c for the handlers the
+    application provides; everything else is IntDefaultHandler.
+*/
+static void (*const handler[NVIC_VECTOR_MAX])(void) =
+{
+    [NVIC_VECTOR_ADC0_SEQUENCE0]  = isr_adc0_sequence0,
+    [NVIC_VECTOR_16_32_TIMER_0A]  = isr_timer0A,
+    [NVIC_VECTOR_16_32_TIMER_1A]  = isr_timer1A,
+    [NVIC_VECTOR_ANALOG_COMPARATOR0] = isr_comp0,
+};
+
+/*
+    Preemption level of thread mode, below every handler.
+*/
+#define NVIC_THREAD_LEVEL (NVIC_PRIORITY_LOWEST + 1)
+
+static struct Nvic
+{
+    bool enabled[NVIC_VECTOR_MAX];
+    bool pending[NVIC_VECTOR_MAX];
+    bool active[NVIC_VECTOR_MAX];
+    uint8_t priority[NVIC_VECTOR_MAX];
+    uint32_t pendings;
+    bool systick;
+    uint8_t systick_priority;
+    Nvic_grouping grouping;
+    uint32_t basepri;
+    bool primask;
+    uint8_t running;
+
+}   nvic = { .running = NVIC_THREAD_LEVEL };
+
+static uint8_t level(uint8_t priority)
+{
+    return (uint8_t)(priority >> nvic.grouping);
+}
+
+void nvic_enable_interrupt(Nvic_vector vector)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    nvic.enabled[vector] = true;
+}
+
+void nvic_disable_interrupt(Nvic_vector vector)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    nvic.enabled[vector] = false;
+}
+
+void nvic_set_grouping(Nvic_grouping grouping)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    nvic.grouping = grouping;
+}
+
+void nvic_set_priority(Nvic_vector vector, uint8_t priority)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    nvic.priority[vector] = priority & NVIC_PRIORITY_LOWEST;
+}
+
+void nvic_set_priority_systick(uint8_t priority)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    nvic.systick_priority = priority & NVIC_PRIORITY_LOWEST;
+}
+
+bool nvic_pending(Nvic_vector vector)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    return nvic.pending[vector];
+}
+
+bool nvic_pending_systick(void)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    return nvic.systick;
+}
+
+bool nvic_active(Nvic_vector vector)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    return nvic.active[vector];
+}
+
+uint32_t nvic_enter_critical(uint8_t priority)
+{
+    uint32_t state = nvic.basepri;
+    uint32_t mask = (uint32_t)priority << 5;
+    sim_advance(2);
+    if (mask && (!nvic.basepri || mask < nvic.basepri))
+    {
+        nvic.basepri = mask;
+    }
+    return state;
+}
+
+void nvic_exit_critical(uint32_t state)
+{
+    nvic.basepri = state;
+    /*
+        Anything held off by the mask is taken on the next instruction.
+    */
+    sim_advance(1);
+}
+
+uint32_t nvic_mask_all(void)
+{
+    uint32_t state = nvic.primask;
+    sim_advance(2);
+    nvic.primask = true;
+    return state;
+}
+
+void nvic_unmask_all(uint32_t state)
+{
+    nvic.primask = state;
+    sim_advance(1);
+}
+
+void sim_nvic_raise(Nvic_vector vector)
+{
+    nvic.pendings += !nvic.pending[vector];
+    nvic.pending[vector] = true;
+}
+
+void sim_nvic_raise_systick(void)
+{
+    nvic.systick = true;
+}
+
+/*
+    Most urgent pending exception allowed to preempt what is running:
+    lowest priority value first, then lowest exception number (SysTick,
+    then the IRQs in vector order). Returns false if none may.
+*/
+static bool select(bool *systick, uint32_t *vector, uint8_t *priority)
+{
+    uint8_t best = NVIC_THREAD_LEVEL;
+    bool found = false;
+    if (nvic.primask || (!nvic.pendings && !nvic.systick))
+    {
+        return false;
+    }
+    if (nvic.systick)
+    {
+        best = nvic.systick_priority;
+        *systick = true;
+        found = true;
+    }
+    for (uint32_t i = 0; i < NVIC_VECTOR_MAX; i++)
+    {
+        if (nvic.pending[i] && nvic.enabled[i] && !nvic.active[i] && nvic.priority[i] < best)
+        {
+            best = nvic.priority[i];
+            *systick = false;
+            *vector = i;
+            found = true;
+        }
+    }
+    if (!found || level(best) >= nvic.running)
+    {
+        return false;
+    }
+    if (nvic.basepri && level(best) >= level((uint8_t)(nvic.basepri >> 5)))
+    {
+        return false;
+    }
+    *priority = best;
+    return true;
+}
+
+bool sim_nvic_ready(void)
+{
+    bool systick;
+    uint32_t vector;
+    uint8_t priority;
+    return select(&systick, &vector, &priority);
+}
+
+static void enter(uint8_t priority, void (*isr)(void))
+{
+    uint8_t preempted = nvic.running;
+    nvic.running = level(priority);
+    sim_advance(SIM_EXCEPTION_CYCLES);
+    isr();
+    sim_advance(SIM_EXCEPTION_CYCLES);
+    nvic.running = preempted;
+}
+
+void sim_nvic_dispatch(void)
+{
+    /*
+        Called whenever simulated time moves, from thread mode or from
+        inside a handler; only exceptions more urgent than the running
+        one are taken, the rest stay pending until it returns.
+    */
+    bool systick;
+    uint32_t vector;
+    uint8_t priority;
+    while (select(&systick, &vector, &priority))
+    {
+        if (systick)
+        {
+            nvic.systick = false;
+            enter(priority, isr_systick);
+            continue;
+        }
+        nvic.pending[vector] = false;
+        nvic.pendings--;
+        if (handler[vector])
+        {
+            nvic.active[vector] = true;
+            enter(priority, handler[vector]);
+            nvic.active[vector] = false;
+        }
+    }
+}
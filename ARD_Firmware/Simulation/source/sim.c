@@ -0,0 +1,134 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "sim.h"
+
+#define SIM_PIN_EVENT_MAX 32
+
+struct Pin_event
+{
+    uint64_t time;
+    Gpio_port port;
+    Gpio_bit bit;
+    bool level;
+};
+
+static struct Sim
+{
+    uint64_t now;
+    uint32_t depth;
+    struct Pin_event pin[SIM_PIN_EVENT_MAX];
+    uint8_t pins;
+
+}   sim;
+
+uint64_t sim_now(void)
+{
+    return sim.now;
+}
+
+uint64_t sim_cycles(uint32_t cycles)
+{
+    return (uint64_t)cycles * SIM_PS_PER_SECOND / sim_clock_hz();
+}
+
+bool sim_in_isr(void)
+{
+    return sim.depth != 0;
+}
+
+void sim_schedule_pin(uint64_t time, Gpio_port port, Gpio_bit bit, bool level)
+{
+    if (sim.pins >= SIM_PIN_EVENT_MAX)
+    {
+        return;
+    }
+    uint8_t i = sim.pins++;
+    while (i && sim.pin[i - 1].time > time)
+    {
+        sim.pin[i] = sim.pin[i - 1];
+        i--;
+    }
+    sim.pin[i].time = time;
+    sim.pin[i].port = port;
+    sim.pin[i].bit = bit;
+    sim.pin[i].level = level;
+}
+
+static uint64_t next_event(void)
+{
+    if (sim_nvic_ready())
+    {
+        return sim.now;
+    }
+    uint64_t next = sim.pins ? sim.pin[0].time : SIM_NEVER;
+    uint64_t t = sim_timer_next();
+    if (t < next)
+    {
+        next = t;
+    }
+    t = sim_adc_next();
+    if (t < next)
+    {
+        next = t;
+    }
+    t = sim_systick_next();
+    if (t < next)
+    {
+        next = t;
+    }
+    t = sim_comp_next();
+    if (t < next)
+    {
+        next = t;
+    }
+    return next;
+}
+
+static void update(void)
+{
+    while (sim.pins && sim.pin[0].time <= sim.now)
+    {
+        sim_gpio_drive(sim.pin[0].port, sim.pin[0].bit, sim.pin[0].level);
+        sim.pins--;
+        for (uint8_t i = 0; i < sim.pins; i++)
+        {
+            sim.pin[i] = sim.pin[i + 1];
+        }
+    }
+    sim_timer_update(sim.now);
+    sim_adc_update(sim.now);
+    sim_systick_update(sim.now);
+    sim_comp_update(sim.now);
+    sim.depth++;
+    sim_nvic_dispatch();
+    sim.depth--;
+}
+
+void sim_advance(uint32_t cycles)
+{
+    uint64_t remaining = sim_cycles(cycles);
+    /*
+        Inside a handler events keep coming due; the NVIC model only
+        takes those more urgent than the running handler and leaves the
+        rest pending until it returns.
+    */
+    while (1)
+    {
+        uint64_t next = next_event();
+        if (next > sim.now + remaining)
+        {
+            sim.now += remaining;
+            break;
+        }
+        if (next > sim.now)
+        {
+            remaining -= next - sim.now;
+            sim.now = next;
+        }
+        /*
+            Handler time preempts the caller, so it does not consume the
+            remaining cycles of the interrupted code.
+        */
+        update();
+    }
+}
@@ -0,0 +1,9 @@
+#include <stdint.h>
+#include "sim.h"
+
+/*
+    Stands in for the part's SRAM; the makefile points the linker's
+    __blockpool_start__ past what the firmware would take of it and
+    __blockpool_end__ at its end.
+*/
+uint8_t sim_sram[SIM_SRAM] __attribute__ ((aligned(512)));
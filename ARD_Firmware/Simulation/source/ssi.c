@@ -0,0 +1,187 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "ssi.h"
+#include "sysctl.h"
+#include "sim.h"
+
+#define SSI_MODULE_MAX (SSI_MOD3 + 1)
+
+struct Ssi
+{
+    uint32_t SSICR0;
+    uint32_t SSICR1;
+    uint32_t SSIDR;
+    uint32_t SSICPSR;
+    uint32_t SSIDMACTL;
+};
+
+static Ssi ssi[SSI_MODULE_MAX];
+
+static uint32_t rate[SSI_MODULE_MAX];
+
+static uint8_t (*device[SSI_MODULE_MAX])(uint8_t byte);
+
+Ssi *ssi_address(Ssi_module module)
+{
+    return &ssi[module];
+}
+
+void ssi_set_phase(Ssi *ssi, Ssi_phase phase)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (phase == SSI_SECOND_EDGE)
+    {
+        ssi->SSICR0 |= (1U << 7);
+    }
+    else
+    {
+        ssi->SSICR0 &= ~(1U << 7);
+    }
+}
+
+void ssi_set_polarity(Ssi *ssi, Ssi_polarity polarity)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (polarity == SSI_STEADY_STATE_HIGH)
+    {
+        ssi->SSICR0 |= (1U << 6);
+    }
+    else
+    {
+        ssi->SSICR0 &= ~(1U << 6);
+    }
+}
+
+void ssi_set_format(Ssi *ssi, Ssi_format format)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    ssi->SSICR0 |= ((uint32_t)format << 4);
+}
+
+void ssi_set_rate(Ssi *ssi, uint32_t hz)
+{
+    uint32_t clock = sysctl_get_clock();
+    uint32_t cpsdvsr = 0;
+    uint32_t scr;
+    sim_advance(6 * SIM_BUS_CYCLES);
+    rate[ssi - ssi_address(SSI_MOD0)] = hz;
+    do
+    {
+        cpsdvsr += 2;
+        scr = (clock / cpsdvsr + hz - 1) / hz - 1;
+    }
+    while (scr > 0xFF && cpsdvsr < 254);
+    scr = scr > 0xFF ? 0xFF : scr;
+    ssi->SSICPSR = cpsdvsr;
+    ssi->SSICR0 &= ~(0xFFU << 8);
+    ssi->SSICR0 |=  (scr << 8);
+}
+
+void ssi_update_rate(Ssi *ssi)
+{
+    ssi_set_rate(ssi, rate[ssi - ssi_address(SSI_MOD0)]);
+}
+
+void ssi_set_size(Ssi *ssi, Ssi_size size)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    ssi->SSICR0 |= ((uint32_t)size + 3);
+}
+
+void ssi_set_mode(Ssi *ssi, Ssi_mode mode)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (mode == SSI_SLAVE)
+    {
+        ssi->SSICR1 |= (1U << 2);
+    }
+    else
+    {
+        ssi->SSICR1 &= ~(1U << 2);
+    }
+}
+
+void ssi_enable_module(Ssi *ssi)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    ssi->SSICR1 |= (1U << 1);
+}
+
+void ssi_disable_module(Ssi *ssi)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    ssi->SSICR1 &= ~(1U << 1);
+}
+
+uint32_t sim_ssi_byte_cycles(Ssi_module module)
+{
+    /*
+        The bit clock is SysClk / (CPSDVSR * (1 + SCR)).
+    */
+    uint32_t bits = (ssi[module].SSICR0 & 0xF) + 1;
+    uint32_t scr = (ssi[module].SSICR0 >> 8) & 0xFF;
+    return bits * (ssi[module].SSICPSR ? ssi[module].SSICPSR : 2) * (scr + 1);
+}
+
+void sim_ssi_attach(Ssi_module module, uint8_t (*attach)(uint8_t byte))
+{
+    device[module] = attach;
+}
+
+uint8_t sim_ssi_exchange(Ssi_module module, uint8_t byte)
+{
+    sim_advance(sim_ssi_byte_cycles(module));
+    return device[module] ? device[module](byte) : 0xFF;
+}
+
+bool sim_ssi_dma(Ssi_module module)
+{
+    return (ssi[module].SSIDMACTL & 0x3) == 0x3;
+}
+
+void ssi_read_burst(Ssi *ssi, uint8_t *buff, uint32_t count)
+{
+    Ssi_module module = (Ssi_module)(ssi - ssi_address(SSI_MOD0));
+    /*
+        Priming the transmit FIFO, then frames back to back: the loop
+        refilling and draining the FIFOs keeps ahead of the wire.
+    */
+    sim_advance(4 * SIM_BUS_CYCLES);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        buff[i] = sim_ssi_exchange(module, 0xFF);
+    }
+}
+
+volatile void *ssi_data(Ssi *ssi)
+{
+    return &ssi->SSIDR;
+}
+
+void ssi_enable_dma(Ssi *ssi, bool enable)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (enable)
+    {
+        ssi->SSIDMACTL |= 0x3;
+    }
+    else
+    {
+        ssi->SSIDMACTL &= ~0x3U;
+    }
+}
+
+uint16_t ssi_write(Ssi *ssi, uint16_t data)
+{
+    Ssi_module module = (Ssi_module)(ssi - ssi_address(SSI_MOD0));
+    /*
+        The frame takes its time on the wire plus the poll loop; with
+        nothing attached MISO idles high.
+    */
+    sim_advance(sim_ssi_byte_cycles(module) + 4 * SIM_BUS_CYCLES);
+    if (!device[module])
+    {
+        return 0xFF;
+    }
+    return device[module]((uint8_t)data);
+}
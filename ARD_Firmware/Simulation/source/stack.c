@@ -0,0 +1,44 @@
+#include <stdint.h>
+#include "stack.h"
+#include "sim.h"
+
+/*
+    The firmware runs on the host's stack here. sim_stack_paint() paints
+    the host stack below the simulator's own frame and stack_high_water()
+    measures how far the firmware and the models have reached into it.
+    Host frames hold 64-bit registers and are optimised differently, so
+    this follows the trend; make stack gives the target's figure.
+*/
+#define STACK_HOST 65536
+
+/*
+    Held as integers: the area is a dead frame by the time it is read.
+*/
+static uintptr_t bottom;
+static uintptr_t top;
+
+uint32_t stack_size(void)
+{
+    return SIM_STACK;
+}
+
+uint32_t stack_high_water(void)
+{
+    volatile uint32_t *word = (volatile uint32_t *)bottom;
+    while ((uintptr_t)word < top && *word == STACK_PAINT)
+    {
+        word++;
+    }
+    return (uint32_t)(top - (uintptr_t)word);
+}
+
+__attribute__ ((noinline)) void sim_stack_paint(void)
+{
+    volatile uint32_t area[STACK_HOST / sizeof(uint32_t)];
+    for (uint32_t i = 0; i < STACK_HOST / sizeof(uint32_t); i++)
+    {
+        area[i] = STACK_PAINT;
+    }
+    bottom = (uintptr_t)area;
+    top = bottom + STACK_HOST;
+}
@@ -0,0 +1,119 @@
+#include <stdint.h>
+#include "sysctl.h"
+#include "sim.h"
+
+/*
+    The part comes out of reset on the 16 MHz PIOSC; sysctl_set_clock()
+    divides the 400 MHz PLL or the 16 MHz crystal the way the hardware
+    driver does.
+*/
+#define SYSCTL_RESET_HZ 16000000UL
+#define SYSCTL_PLL_HZ   400000000UL
+#define SYSCTL_PLL_LOCK_US 500
+
+static struct Sysctl
+{
+    uint32_t hz;
+    uint32_t gpiohbctl;
+
+}   sysctl = { .hz = SYSCTL_RESET_HZ };
+
+uint32_t sim_clock_hz(void)
+{
+    return sysctl.hz;
+}
+
+void sim_set_clock_hz(uint32_t hz)
+{
+    sysctl.hz = hz;
+}
+
+uint32_t sysctl_set_clock(uint32_t hz)
+{
+    uint32_t divisor;
+    sim_advance(SIM_BUS_CYCLES);
+    if (hz > SYSCTL_CLOCK_XTAL)
+    {
+        divisor = (SYSCTL_PLL_HZ + hz - 1) / hz;
+        divisor = divisor < 5 ? 5 : divisor;
+        /*
+            Spin on PLLSTAT at the crystal rate until the PLL locks.
+        */
+        sysctl.hz = SYSCTL_CLOCK_XTAL;
+        sim_advance(SYSCTL_CLOCK_XTAL / 1000000 * SYSCTL_PLL_LOCK_US);
+        sysctl.hz = SYSCTL_PLL_HZ / divisor;
+    }
+    else
+    {
+        divisor = hz ? (SYSCTL_CLOCK_XTAL + hz - 1) / hz : 64;
+        divisor = divisor > 64 ? 64 : divisor;
+        sysctl.hz = SYSCTL_CLOCK_XTAL / divisor;
+    }
+    return sysctl.hz;
+}
+
+uint32_t sysctl_get_clock(void)
+{
+    return sysctl.hz;
+}
+
+void sysctl_enable_ahb(Sysctl_port port)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    sysctl.gpiohbctl |= (1U << port);
+}
+
+/*
+    Clock gating is not modelled; every module is always clocked.
+*/
+static void gate(Sysctl_mode mode)
+{
+    (void)mode;
+    sim_advance(SIM_BUS_CYCLES);
+}
+
+void sysctl_set_clock_adc(Sysctl_module module, Sysctl_mode mode)
+{
+    (void)module;
+    gate(mode);
+}
+
+void sysctl_set_clock_comp(Sysctl_mode mode)
+{
+    gate(mode);
+}
+
+void sysctl_set_clock_dma(Sysctl_mode mode)
+{
+    gate(mode);
+}
+
+void sysctl_set_clock_gpio(Sysctl_port port, Sysctl_mode mode)
+{
+    (void)port;
+    gate(mode);
+}
+
+void sysctl_set_clock_pwm(Sysctl_module module, Sysctl_mode mode)
+{
+    (void)module;
+    gate(mode);
+}
+
+void sysctl_set_clock_ssi(Sysctl_module module, Sysctl_mode mode)
+{
+    (void)module;
+    gate(mode);
+}
+
+void sysctl_set_clock_timer(Sysctl_module module, Sysctl_mode mode)
+{
+    (void)module;
+    gate(mode);
+}
+
+void sysctl_set_clock_uart(Sysctl_module module, Sysctl_mode mode)
+{
+    (void)module;
+    gate(mode);
+}
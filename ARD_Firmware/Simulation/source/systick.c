@@ -0,0 +1,127 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "systick.h"
+#include "sim.h"
+
+/*
+    PIOSC/4 is the alternate SysTick clock source.
+*/
+#define SYSTICK_PIOSC_DIV4_HZ 4000000UL
+
+struct Systick
+{
+    uint32_t STCTRL;
+    uint32_t STRELOAD;
+    uint64_t next;
+};
+
+static struct Systick systick;
+
+static uint64_t period(void)
+{
+    uint64_t ticks = (uint64_t)systick.STRELOAD + 1;
+    if (systick.STCTRL & (1U << 2))
+    {
+        return sim_cycles(1) * ticks;
+    }
+    return ticks * SIM_PS_PER_SECOND / SYSTICK_PIOSC_DIV4_HZ;
+}
+
+void systick_source(Systick_source source)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (source == SYSTICK_SYSTEM_CLOCK)
+    {
+        systick.STCTRL |= (1U << 2);
+    }
+    else
+    {
+        systick.STCTRL &= ~(1U << 2);
+    }
+}
+
+void systick_reload(uint32_t value)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    systick.STRELOAD = value;
+}
+
+void systick_reset(void)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    systick.next = sim_now() + period();
+}
+
+void systick_interrupt(void)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    systick.STCTRL |= (1U << 1);
+}
+
+void systick_start(void)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (!(systick.STCTRL & (1U << 0)))
+    {
+        systick.next = sim_now() + period();
+    }
+    systick.STCTRL |= (1U << 0);
+}
+
+void systick_stop(void)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    systick.STCTRL &= ~(1U << 0);
+}
+
+uint32_t systick_value(void)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (!(systick.STCTRL & (1U << 0)) || systick.next <= sim_now())
+    {
+        return 0;
+    }
+    /*
+        The counter reaches 0 at the wrap and reloads on the count after.
+    */
+    uint64_t left = systick.next - sim_now();
+    uint32_t value = (uint32_t)(left * ((uint64_t)systick.STRELOAD + 1) / period());
+    return value > systick.STRELOAD ? systick.STRELOAD : value;
+}
+
+uint64_t sim_systick_next(void)
+{
+    return (systick.STCTRL & (1U << 0)) ? systick.next : SIM_NEVER;
+}
+
+void sim_systick_update(uint64_t now)
+{
+    if (!(systick.STCTRL & (1U << 0)) || systick.next > now)
+    {
+        return;
+    }
+    while (systick.next <= now)
+    {
+        systick.next += period();
+    }
+    if (systick.STCTRL & (1U << 1))
+    {
+        sim_nvic_raise_systick();
+    }
+}
+
+/*
+    Counter wraps since reset. The handler costs the same however many
+    deadlines are waiting; alarm.c compares them against this.
+*/
+static volatile uint32_t ticks;
+
+uint32_t systick_ticks(void)
+{
+    return ticks;
+}
+
+void isr_systick(void)
+{
+    ticks++;
+}
@@ -0,0 +1,189 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "timer.h"
+#include "nvic.h"
+#include "sim.h"
+
+#define TIMER_MODULE_MAX (TIMER_MOD5 + 1)
+
+struct Timer
+{
+    uint32_t GPTMCFG;
+    uint32_t GPTMTnMR[2];
+    uint32_t GPTMCTL;
+    uint32_t GPTMIMR;
+    uint32_t GPTMRIS;
+    uint32_t GPTMTnILR[2];
+    uint32_t GPTMTnMATCHR[2];
+    uint32_t match[2];
+    uint64_t next[2];
+};
+
+static Timer timer[TIMER_MODULE_MAX];
+
+static const Nvic_vector vector[TIMER_MODULE_MAX][2] =
+{
+    {NVIC_VECTOR_16_32_TIMER_0A, NVIC_VECTOR_16_32_TIMER_0B},
+    {NVIC_VECTOR_16_32_TIMER_1A, NVIC_VECTOR_16_32_TIMER_1B},
+    {NVIC_VECTOR_16_32_TIMER_2A, NVIC_VECTOR_16_32_TIMER_2B},
+    {NVIC_VECTOR_16_32_TIMER_3A, NVIC_VECTOR_16_32_TIMER_3B},
+    {NVIC_VECTOR_16_32_TIMER_4A, NVIC_VECTOR_16_32_TIMER_4B},
+    {NVIC_VECTOR_16_32_TIMER_5A, NVIC_VECTOR_16_32_TIMER_5B}
+};
+
+static const uint32_t mask[] = {(1 << 0), (1 << 8)};
+static const uint32_t interrupt_mask[] = {(1 << 0), (1 << 8), (1 << 2), (1 << 10)};
+
+#define MODE_ONE_SHOT 0x1
+#define MODE_PERIODIC 0x2
+#define MODE_PWM      0x20A
+
+/*
+    Receives the match in force over every PWM period that ends.
+*/
+static void (*pwm_sink)(Timer_module module, Timer_select select, uint32_t match);
+
+Timer *timer_address(Timer_module module)
+{
+    return &timer[module];
+}
+
+void timer_set_width(Timer *timer, Timer_width width)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    timer->GPTMCFG = (width == TIMER_16_BIT) ? 0x04 : 0x00;
+}
+
+void timer_set_mode(Timer *timer, Timer_select select, Timer_mode mode)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    const uint32_t value[] = {MODE_ONE_SHOT, MODE_PERIODIC, MODE_PWM};
+    timer->GPTMTnMR[select] = value[mode];
+}
+
+void timer_set_load(Timer *timer, Timer_select select, uint32_t load)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    timer->GPTMTnILR[select] = load;
+}
+
+void timer_set_match(Timer *timer, Timer_select select, uint32_t match)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    timer->GPTMTnMATCHR[select] = match;
+}
+
+static uint64_t period(Timer *timer, Timer_select select)
+{
+    return sim_cycles(timer->GPTMTnILR[select]) + sim_cycles(1);
+}
+
+void timer_enable(Timer *timer, Timer_select select)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (!(timer->GPTMCTL & mask[select]))
+    {
+        timer->next[select] = sim_now() + period(timer, select);
+        timer->match[select] = timer->GPTMTnMATCHR[select];
+    }
+    timer->GPTMCTL |= mask[select];
+}
+
+void timer_disable(Timer *timer, Timer_select select)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    timer->GPTMCTL &= ~mask[select];
+}
+
+void timer_interrupt(Timer *timer, Timer_interrupt timer_interrupt)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    timer->GPTMIMR |= interrupt_mask[timer_interrupt];
+}
+
+void timer_clear_interrupt(Timer *timer, Timer_interrupt timer_interrupt)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    timer->GPTMRIS &= ~interrupt_mask[timer_interrupt];
+}
+
+uint32_t timer_value(Timer *timer, Timer_select select)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (!(timer->GPTMCTL & mask[select]))
+    {
+        return timer->GPTMTnILR[select];
+    }
+    /*
+        Counting down: cycles left until the next timeout.
+    */
+    uint64_t left = (timer->next[select] - sim_now()) / sim_cycles(1);
+    return left ? (uint32_t)(left - 1) : 0;
+}
+
+void sim_timer_pwm_sink(void (*sink)(Timer_module module, Timer_select select, uint32_t match))
+{
+    pwm_sink = sink;
+}
+
+uint64_t sim_timer_next(void)
+{
+    uint64_t next = SIM_NEVER;
+    for (uint32_t m = 0; m < TIMER_MODULE_MAX; m++)
+    {
+        for (uint32_t s = 0; s < 2; s++)
+        {
+            if ((timer[m].GPTMCTL & mask[s]) && timer[m].next[s] < next)
+            {
+                next = timer[m].next[s];
+            }
+        }
+    }
+    return next;
+}
+
+void sim_timer_update(uint64_t now)
+{
+    for (uint32_t m = 0; m < TIMER_MODULE_MAX; m++)
+    {
+        for (uint32_t s = 0; s < 2; s++)
+        {
+            Timer *t = &timer[m];
+            if (!(t->GPTMCTL & mask[s]) || t->next[s] > now)
+            {
+                continue;
+            }
+            /*
+                A PWM period ends on the reload, which is the output's
+                rising edge: the match written during it is latched for
+                the next one.
+            */
+            bool pwm = t->GPTMTnMR[s] == MODE_PWM;
+            uint32_t raised = pwm ? interrupt_mask[TIMER_A_EVENT + s] : mask[s];
+            t->GPTMRIS |= raised;
+            if (t->GPTMIMR & raised)
+            {
+                sim_nvic_raise(vector[m][s]);
+            }
+            if (t->GPTMTnMR[s] != MODE_ONE_SHOT)
+            {
+                /*
+                    Periodic: a missed timeout is lost, as on the part.
+                */
+                while (t->next[s] <= now)
+                {
+                    if (pwm && pwm_sink)
+                    {
+                        pwm_sink((Timer_module)m, (Timer_select)s, t->match[s]);
+                    }
+                    t->match[s] = t->GPTMTnMATCHR[s];
+                    t->next[s] += period(t, s);
+                }
+            }
+            else
+            {
+                t->GPTMCTL &= ~mask[s];
+            }
+        }
+    }
+}
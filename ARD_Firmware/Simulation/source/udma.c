@@ -0,0 +1,89 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "udma.h"
+#include "sim.h"
+
+struct Udma
+{
+    uint32_t DMACFG;
+    uint32_t DMAENASET;
+    uint32_t DMAPRIOSET;
+    Udma_control *control;
+};
+
+static Udma udma;
+
+Udma *udma_address(void)
+{
+    return &udma;
+}
+
+void udma_enable(Udma *udma, Udma_control *table)
+{
+    sim_advance(2 * SIM_BUS_CYCLES);
+    udma->DMACFG = 1;
+    udma->control = table;
+}
+
+void udma_set_priority(Udma *udma, Udma_channel channel, bool high)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    if (high)
+    {
+        udma->DMAPRIOSET |= 1U << channel;
+    }
+    else
+    {
+        udma->DMAPRIOSET &= ~(1U << channel);
+    }
+}
+
+void udma_transfer(Udma *udma, Udma_channel channel,
+                   const volatile void *src, Udma_increment src_increment,
+                   volatile void *dst, Udma_increment dst_increment, uint32_t count)
+{
+    uint32_t last = count - 1;
+    Udma_control *entry = &udma->control[channel];
+    sim_advance(5 * SIM_BUS_CYCLES);
+    entry->src_end = (const volatile uint8_t *)src + (src_increment == UDMA_INCREMENT_BYTE ? last : 0);
+    entry->dst_end = (volatile uint8_t *)dst + (dst_increment == UDMA_INCREMENT_BYTE ? last : 0);
+    entry->control = ((dst_increment == UDMA_INCREMENT_NONE ? 0x3U : 0x0U) << 30) |
+                     ((src_increment == UDMA_INCREMENT_NONE ? 0x3U : 0x0U) << 26) |
+                     (0x2U << 14) |
+                     (last << 4) |
+                     0x1U;
+    udma->DMAENASET |= 1U << channel;
+}
+
+/*
+    Only the SSI1 pair is modelled. Once both channels and the SSI's
+    requests are enabled the whole transfer runs on the first poll, a
+    frame at a time on the wire, from the transmit channel's source to
+    the receive channel's destination.
+*/
+static void run_ssi1(Udma *udma)
+{
+    uint32_t pair = (1U << UDMA_CHANNEL_SSI1_RX) | (1U << UDMA_CHANNEL_SSI1_TX);
+    if ((udma->DMAENASET & pair) != pair || !sim_ssi_dma(SSI_MOD1))
+    {
+        return;
+    }
+    Udma_control *rx = &udma->control[UDMA_CHANNEL_SSI1_RX];
+    Udma_control *tx = &udma->control[UDMA_CHANNEL_SSI1_TX];
+    uint32_t count = ((rx->control >> 4) & 0x3FF) + 1;
+    volatile uint8_t *dst = (volatile uint8_t *)rx->dst_end - ((rx->control >> 30) == 0x3 ? 0 : count - 1);
+    const volatile uint8_t *src = (const volatile uint8_t *)tx->src_end - ((tx->control >> 26 & 0x3) == 0x3 ? 0 : count - 1);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t byte = sim_ssi_exchange(SSI_MOD1, src[(tx->control >> 26 & 0x3) == 0x3 ? 0 : i]);
+        dst[(rx->control >> 30) == 0x3 ? 0 : i] = byte;
+    }
+    udma->DMAENASET &= ~pair;
+}
+
+bool udma_busy(Udma *udma, Udma_channel channel)
+{
+    sim_advance(SIM_BUS_CYCLES);
+    run_ssi1(udma);
+    return udma->DMAENASET & (1U << channel);
+}
@@ -1,6 +1,31 @@
 #ifndef INIT_H_
 #define INIT_H_
 
+#include <stdint.h>
+#include "nvic.h"
+#include "sysctl.h"
+
+/*
+    SysTick counts PIOSC/4 and wraps every millisecond, through clock
+    changes and PLL relocking alike: the unit of alarm.h and of the SD
+    driver's timeouts.
+*/
+#define INIT_TICK_HZ 1000
+#define INIT_TICK_CLOCK 4000000
+#define INIT_TICK_LOAD (INIT_TICK_CLOCK / INIT_TICK_HZ - 1)
+
+/*
+    The capture and playback paths and the power-fail comparator preempt
+    everything; the SysTick timebase waits behind them and is what
+    critical sections in thread mode mask.
+*/
+#define INIT_PRIORITY_CAPTURE  NVIC_PRIORITY_HIGHEST
+#define INIT_PRIORITY_PLAYBACK NVIC_PRIORITY_HIGHEST
+#define INIT_PRIORITY_POWER    NVIC_PRIORITY_HIGHEST
+#define INIT_PRIORITY_TICK     2
+
 void init(void);
 
+void init_clock(uint32_t hz);
+
 #endif /* INIT_H_ */
@@ -1,6 +1,111 @@
 #ifndef SM_H_
 #define SM_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+#include "agc.h"
+#include "bench.h"
+
+typedef enum
+{
+    SM_BUSY,
+    SM_DONE,
+    SM_FAILED,
+    SM_POWER_FAIL
+
+}   Sm_status;
+
 void sm_execute(void);
 
+Sm_status sm_status(void);
+
+uint32_t sm_overruns(void);
+
+uint32_t sm_isr_cycles(void);
+
+uint32_t sm_capture_latency(void);
+
+uint32_t sm_window_copies(void);
+
+uint32_t sm_write_latency(void);
+
+uint32_t sm_fat_entries(void);
+
+/*
+    Microseconds the writer spent at worst linking a reserved allocation
+    unit, and the units the data reached before the pool had room for
+    their erase.
+*/
+uint32_t sm_reserve_latency(void);
+
+uint32_t sm_erases_skipped(void);
+
+/*
+    Playback: samples put out, PWM periods with no block ready, and the
+    slowest block read in microseconds.
+*/
+uint32_t sm_played(void);
+
+uint32_t sm_underruns(void);
+
+uint32_t sm_read_latency(void);
+
+/*
+    Microseconds from reset to the first sample and to the recording
+    file being open with its header written, and from the start button
+    being seen to the first sample.
+*/
+uint32_t sm_first_sample(void);
+
+uint32_t sm_trigger_latency(void);
+
+uint32_t sm_file_ready(void);
+
+/*
+    Microseconds from the supply monitor tripping to the recording being
+    closed.
+*/
+uint32_t sm_power_flush(void);
+
+/*
+    Cycles the gain stage spent on a block, on average and at worst,
+    its log included.
+*/
+uint32_t sm_agc_cycles(void);
+
+uint32_t sm_agc_worst(void);
+
+/*
+    Built with SPECTRUM: blocks analysed for the band energy file and
+    the cycles spent on each, on average and at worst, its writes to the
+    card included.
+*/
+uint32_t sm_spectrum_blocks(void);
+
+uint32_t sm_spectrum_cycles(void);
+
+uint32_t sm_spectrum_worst(void);
+
+void sm_set_sample_rate(uint32_t rate);
+
+void sm_set_reserve(bool enable);
+
+void sm_set_instant_on(bool enable);
+
+#ifdef AGC
+/*
+    Gain stage settings for the recordings that follow. The stage itself
+    runs in every recording of a build with AGC and in none without.
+*/
+void sm_set_agc(const Agc_config *config);
+#endif
+
+/*
+    Test size for the card benchmark, and its results once it has run
+    (NULL until then).
+*/
+void sm_set_bench_size(uint32_t bytes);
+
+const Bench_result *sm_bench(void);
+
 #endif /* SM_H_ */
@@ -1,19 +1,30 @@
 #include "adc.h"
+#include "comp.h"
+#include "diskio.h"
+#include "dwt.h"
 #include "gpio.h"
 #include "nvic.h"
 #include "ssi.h"
 #include "sysctl.h"
+#include "systick.h"
 #include "timer.h"
+#include "init.h"
 
 static void sysctl(void)
 {
-    sysctl_enable_run_mode();
+    sysctl_set_clock(SYSCTL_CLOCK_MAX);
     sysctl_enable_ahb(SYSCTL_PORTB);
+    sysctl_enable_ahb(SYSCTL_PORTC);
     sysctl_enable_ahb(SYSCTL_PORTD);
     sysctl_enable_ahb(SYSCTL_PORTF);
     sysctl_enable_ahb(SYSCTL_PORTG);
     sysctl_set_clock_adc  (SYSCTL_MOD0,  SYSCTL_RUN_MODE);
+    sysctl_set_clock_comp (SYSCTL_RUN_MODE);
+#ifdef SD_DMA
+    sysctl_set_clock_dma  (SYSCTL_RUN_MODE);
+#endif
     sysctl_set_clock_gpio (SYSCTL_PORTB, SYSCTL_RUN_MODE);
+    sysctl_set_clock_gpio (SYSCTL_PORTC, SYSCTL_RUN_MODE);
     sysctl_set_clock_gpio (SYSCTL_PORTD, SYSCTL_RUN_MODE);
     sysctl_set_clock_gpio (SYSCTL_PORTF, SYSCTL_RUN_MODE);
     sysctl_set_clock_gpio (SYSCTL_PORTG, SYSCTL_RUN_MODE);
@@ -22,6 +33,16 @@ static void sysctl(void)
     sysctl_set_clock_timer(SYSCTL_MOD1,  SYSCTL_RUN_MODE);
 }
 
+static void nvic(void)
+{
+    nvic_set_grouping(NVIC_GROUP_8_1);
+    nvic_set_priority(NVIC_VECTOR_16_32_TIMER_0A, INIT_PRIORITY_CAPTURE);
+    nvic_set_priority(NVIC_VECTOR_ADC0_SEQUENCE0, INIT_PRIORITY_CAPTURE);
+    nvic_set_priority(NVIC_VECTOR_16_32_TIMER_1A, INIT_PRIORITY_PLAYBACK);
+    nvic_set_priority(NVIC_VECTOR_ANALOG_COMPARATOR0, INIT_PRIORITY_POWER);
+    nvic_set_priority_systick(INIT_PRIORITY_TICK);
+}
+
 static void portb(void)
 {
     Gpio *portb = gpio_address(GPIO_PORTB);
@@ -30,6 +51,21 @@ static void portb(void)
     */
     gpio_set_operation(portb, GPIO_BIT5, GPIO_ALTERNATE);
     gpio_enable_analog(portb, GPIO_BIT5);
+    /*
+            PLAYBACK: T1CCP0 PWM OUTPUT (PB4)
+    */
+    gpio_set_operation(portb, GPIO_BIT4, GPIO_ALTERNATE);
+    gpio_enable_digital(portb, GPIO_BIT4);
+    gpio_set_function (portb, GPIO_BIT4, GPIO_PB4_T1CCP0);
+}
+
+static void portc(void)
+{
+    Gpio *portc = gpio_address(GPIO_PORTC);
+    /*
+            SUPPLY MONITOR: C0- INPUT (PC7)
+    */
+    gpio_enable_analog(portc, GPIO_BIT7);
 }
 
 static void portd(void)
@@ -117,11 +153,33 @@ static void adc0(void)
     adc_set_end       (adc0, ADC_SAMPLER0, 1);
     adc_set_trigger   (adc0, ADC_SAMPLER0, 1);
     adc_set_averaging (adc0, ADC_0X);
+    /*
+        Convert on the PIOSC so sampling does not depend on the PLL,
+        which init_clock() powers down below 16 MHz.
+    */
+    adc_set_clock     (adc0, ADC_CLOCK_PIOSC);
     adc_enable_interrupt(adc0, ADC_SAMPLER0);
     nvic_enable_interrupt(NVIC_VECTOR_ADC0_SEQUENCE0);
     adc_enable_sampler(adc0, ADC_SAMPLER0);
 }
 
+static void comp0(void)
+{
+    Comp *comp = comp_address();
+    /*
+        C0- sees the unregulated supply through a divider, compared with
+        the internal reference: a fraction of the regulated VDDA, which
+        holds until the regulator drops out. The output rises as the
+        supply falls through the threshold.
+    */
+    comp_set_reference   (comp, COMP_RANGE_HIGH, 8);
+    comp_set_source      (comp, COMP_MOD0, COMP_SOURCE_REFERENCE);
+    comp_set_sense       (comp, COMP_MOD0, COMP_SENSE_RISING);
+    comp_clear_interrupt (comp, COMP_MOD0);
+    comp_enable_interrupt(comp, COMP_MOD0);
+    nvic_enable_interrupt(NVIC_VECTOR_ANALOG_COMPARATOR0);
+}
+
 static void ssi1(void)
 {
     Ssi  *ssi1  = ssi_address(SSI_MOD1);
@@ -132,7 +190,7 @@ static void ssi1(void)
     ssi_set_phase     (ssi1, SSI_FIRST_EDGE);
     ssi_set_polarity  (ssi1, SSI_STEADY_STATE_LOW);
     ssi_set_format    (ssi1, SSI_FREESCALE);
-    ssi_set_rate      (ssi1, SSI_4_MHZ);
+    ssi_set_rate      (ssi1, SPI_SLOW_HZ);
     ssi_set_size      (ssi1, SSI_SIZE_8);
     ssi_set_mode      (ssi1, SSI_MASTER);
     ssi_enable_module (ssi1);
@@ -145,9 +203,8 @@ static void timer0(void)
     timer_set_width(timer0, TIMER_32_BIT);
     timer_set_mode (timer0, TIMER_A, TIMER_PERIODIC);
     /*
-        CPU_FREQ/TIMER_FREQ - 1
+        The load is set from the sample rate by capture_configure().
     */
-    timer_set_load (timer0, TIMER_A, 0x007CF);
     timer_interrupt(timer0, TIMER_A_TIMEOUT);
     nvic_enable_interrupt(NVIC_VECTOR_16_32_TIMER_0A);
 }
@@ -156,23 +213,50 @@ static void timer1(void)
 {
     Timer *timer1 = timer_address(TIMER_MOD1);
     timer_disable  (timer1, TIMER_A);
-    timer_set_width(timer1, TIMER_32_BIT);
-    timer_set_mode (timer1, TIMER_A, TIMER_PERIODIC);
-    timer_set_load (timer1, TIMER_A, 0xC34FF);
-    timer_interrupt(timer1, TIMER_A_TIMEOUT);
+    timer_set_width(timer1, TIMER_16_BIT);
+    timer_set_mode (timer1, TIMER_A, TIMER_PWM);
+    /*
+        The period and first match are set from the file's sample rate
+        by player_configure().
+    */
+    timer_interrupt(timer1, TIMER_A_EVENT);
     nvic_enable_interrupt(NVIC_VECTOR_16_32_TIMER_1A);
-    timer_enable(timer1, TIMER_A);
+}
+
+static void systick(void)
+{
+    systick_stop     ();
+    systick_source   (SYSTICK_PIOSC_DIV4);
+    systick_reload   (INIT_TICK_LOAD);
+    systick_reset    ();
+    systick_interrupt();
+    systick_start    ();
+}
+
+void init_clock(uint32_t hz)
+{
+    /*
+        Re-derive everything that counts system clock cycles; the sample
+        timer is reloaded by capture_configure() before it next runs.
+    */
+    sysctl_set_clock(hz);
+    ssi_update_rate(ssi_address(SSI_MOD1));
 }
 
 void init(void)
 {
     sysctl();
+    dwt_enable_cycles();
+    nvic();
     portb();
+    portc();
     portd();
     portf();
     portg();
     adc0();
+    comp0();
     ssi1();
     timer0();
     timer1();
+    systick();
 }
@@ -2,28 +2,94 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "wave.h"
+#include "agc.h"
+#include "alarm.h"
+#include "bench.h"
+#include "blockpool.h"
 #include "diskio.h"
 #include "ff.h"
+#include "peaks.h"
+#include "sample.h"
+#include "spectrum.h"
 #include "sw.h"
+#include "capture.h"
+#include "catalog.h"
+#include "player.h"
 #include "adc.h"
+#include "comp.h"
+#include "dwt.h"
 #include "gpio.h"
+#include "nvic.h"
 #include "timer.h"
+#include "sysctl.h"
+#include "systick.h"
+#include "init.h"
+#include "ramfunc.h"
 #include "sm.h"
 
+#if defined(SPECTRUM) && SAMPLE_FORMAT != 16
+#error "SPECTRUM analyses each block once it is written, so only as 16-bit samples"
+#endif
+
 static void initial(void);
+static void calibrate(void);
+static void bench(void);
+static void cue(void);
+static void play(void);
+static void unload(void);
 static void wait(void);
 static void open(void);
 static void record(void);
 static void finish(void);
+static void done(void);
 static void error(void);
+static void emergency(void);
+static void off(void);
 
 static void (*state)(void) = initial;
 
+static volatile bool power_failed;
+static volatile uint32_t power_tripped;
+static uint32_t power_flush;
+
 void sm_execute(void)
 {
+    /*
+        A recording in progress is saved; anything earlier is abandoned.
+        A stop already pressed finishes normally.
+    */
+    if (power_failed)
+    {
+        if (state == record)
+        {
+            state = emergency;
+        }
+        else if (state != emergency && state != finish && state != done && state != error)
+        {
+            state = off;
+        }
+    }
+    alarm_dispatch();
     (*state)();
 }
 
+Sm_status sm_status(void)
+{
+    if (state == done)
+    {
+        return SM_DONE;
+    }
+    if (state == error)
+    {
+        return SM_FAILED;
+    }
+    if (state == off)
+    {
+        return SM_POWER_FAIL;
+    }
+    return SM_BUSY;
+}
+
 static Gpio *portg;
 static Adc *adc0;
 static Sw *start;
@@ -31,101 +97,799 @@ static Sw *stop;
 static Sw *unmount;
 static Sw *detect;
 static Timer *timer0;
+static Timer *timer1;
 static Wave_info info;
 static FATFS fatfs;
 static FIL file;
 
-#define BUFFER_MAX 4096
+/*
+    First error writing the recording: the remaining blocks are dropped
+    and the recording ends failed once its file is closed. A short write
+    means the volume is full.
+*/
+static FRESULT write_status;
+
+/*
+    Cluster link map of the open file, two items a fragment: seeks and
+    reads go straight to the cluster instead of following the FAT from
+    the top, and the file system extends it as the recording grows. A
+    file with more fragments than it holds falls back to the chain.
+*/
+#define LINKMAP_ITEMS 64
+static DWORD linkmap[LINKMAP_ITEMS];
+
 #define DC_BIAS 0x04DB
+#define SAMPLE_RATE_DEFAULT 40000
+#define CALIBRATE_BUFFERS 8
+#define TICK_US (1000000 / INIT_TICK_HZ)
+#define CARD_POLL_MS 10
+/*
+    Full speed while the card is calibrated and written, the bare crystal
+    while waiting for the start button or after the recording is closed.
+*/
+#define CLOCK_RUN  SYSCTL_CLOCK_MAX
+#define CLOCK_IDLE SYSCTL_CLOCK_XTAL
+
+static uint32_t sample_rate = SAMPLE_RATE_DEFAULT;
+static volatile uint32_t isr_cycles;
+static volatile uint32_t capture_latency;
+static uint32_t capture_load;
+static uint32_t window_copies;
+static uint32_t write_latency;
+static uint32_t fat_entries;
+static uint32_t triggered;
+static volatile uint32_t first_sample;
+static uint32_t file_ready;
+
+/*
+    Gain stage applied from reset: the defaults when built with AGC,
+    otherwise none. Samples are packed for the width the build gives
+    them, so sm_set_agc() only changes the settings.
+*/
+#ifdef AGC
+static const Agc_config agc_default =
+{
+    .attack_ms = AGC_ATTACK_MS,
+    .release_ms = AGC_RELEASE_MS,
+    .target = AGC_TARGET,
+    .max_gain = AGC_MAX_GAIN
+};
+static const Agc_config *agc_config = &agc_default;
+#else
+static const Agc_config *agc_config = NULL;
+#endif
+static uint32_t agc_blocks;
+static uint64_t agc_total;
+static uint32_t agc_worst;
+static uint32_t spectrum_blocks;
+static uint64_t spectrum_total;
+static uint32_t spectrum_worst;
+
+/*
+    Card detect is sampled every CARD_POLL_MS from the main loop rather
+    than on every pass; the card counts as gone once two samples in a
+    row miss it, which rides out contact bounce, and stays gone.
+*/
+static Alarm *card_poll;
+static bool card_present;
+static bool card_missing;
 
+/*
+    Instant-on starts capture from reset, ahead of card initialisation
+    and mount, at the default throughput since there has been no card to
+    calibrate against. Blocks captured meanwhile wait in the pool until
+    the file is open. Built with INSTANT_ON it is how the recorder
+    starts.
+*/
+#ifdef INSTANT_ON
+static bool instant = true;
+#else
+static bool instant = false;
+#endif
+
+/*
+    Holding start and unmount through reset qualifies the card instead
+    of recording: the results go to BENCH.TXT and stay readable through
+    sm_bench().
+*/
+static uint32_t bench_size = BENCH_SIZE_DEFAULT;
+static Bench_result bench_result;
+static bool bench_done;
+
+/*
+    Recordings are placed on allocation unit boundaries in pre-erased,
+    contiguous runs of one unit, the next one reserved while half of the
+    current one is still free. A card that does not report its unit, or
+    has no contiguous unit left, falls back to cluster-at-a-time
+    allocation.
+
+    The card takes no writes while it erases, so a reserved unit is only
+    erased once the free pool blocks, less one for the write that
+    follows, outlast the erase timeout the card gives for a unit; one the
+    data reaches first is written unerased.
+    What record() can still stall on is linking the unit, a run of FAT
+    writes plus, when the free extents hold no aligned run, a scan of
+    the FAT; sm_reserve_latency() reports the worst.
+*/
+static bool reserve = true;
+static uint32_t reserve_unit;
+static uint32_t reserve_align;
+static uint32_t reserved;
+static uint32_t reserve_latency;
+static DWORD erase_sector;
+static DWORD erase_offset;
+static DWORD erase_ms;
+static uint32_t erases_skipped;
+
+/*
+    Playback, entered by holding stop through reset, reads the recording
+    ahead into pool blocks, each filled by one f_read of whole frames in
+    whole sectors, which goes to the card as a multi-block read, and
+    queues them for the PWM handler; start
+    ends it early. An underrun is a PWM period with no block queued,
+    which holds the last sample.
+*/
+static struct Playback
+{
+    volatile uint8_t *block;
+    uint16_t index;
+    uint32_t frame;
+    uint32_t fill;
+    volatile uint32_t remaining;
+    uint32_t queued;
+    volatile uint32_t samples;
+    volatile uint32_t underruns;
+    bool silent;
+    bool failed;
+    volatile bool ended;
+
+}   playback;
+
+static uint32_t read_latency;
+
+/*
+    Capture fills pool blocks in place and submits them to the writer;
+    an overrun is a block's worth of samples dropped for want of a free
+    block.
+*/
 static struct Buffer
 {
-    volatile int8_t buff1[BUFFER_MAX];
-    volatile int8_t buff2[BUFFER_MAX];
-    volatile int8_t *ptr1;
-    volatile int8_t *ptr2;
-    volatile bool swapped;
-    volatile bool data_ready;
+    volatile int16_t *fill;
     volatile uint16_t index;
+    volatile uint32_t overruns;
 
 }   buffer;
 
-void swap(void)
+uint32_t sm_overruns(void)
+{
+    return buffer.overruns;
+}
+
+uint32_t sm_isr_cycles(void)
+{
+    return isr_cycles;
+}
+
+uint32_t sm_window_copies(void)
 {
-    if (!buffer.swapped)
+    return window_copies;
+}
+
+uint32_t sm_write_latency(void)
+{
+    return write_latency;
+}
+
+uint32_t sm_fat_entries(void)
+{
+    return fat_entries;
+}
+
+uint32_t sm_reserve_latency(void)
+{
+    return reserve_latency;
+}
+
+uint32_t sm_erases_skipped(void)
+{
+    return erases_skipped;
+}
+
+uint32_t sm_capture_latency(void)
+{
+    return capture_latency;
+}
+
+uint32_t sm_first_sample(void)
+{
+    return first_sample;
+}
+
+uint32_t sm_trigger_latency(void)
+{
+    return first_sample - triggered;
+}
+
+uint32_t sm_file_ready(void)
+{
+    return file_ready;
+}
+
+uint32_t sm_power_flush(void)
+{
+    return power_flush;
+}
+
+uint32_t sm_agc_cycles(void)
+{
+    return agc_blocks ? (uint32_t)(agc_total / agc_blocks) : 0;
+}
+
+uint32_t sm_agc_worst(void)
+{
+    return agc_worst;
+}
+
+#ifdef AGC
+void sm_set_agc(const Agc_config *config)
+{
+    agc_config = config;
+    agc_configure(config);
+}
+#endif
+
+uint32_t sm_spectrum_blocks(void)
+{
+    return spectrum_blocks;
+}
+
+uint32_t sm_spectrum_cycles(void)
+{
+    return spectrum_blocks ? (uint32_t)(spectrum_total / spectrum_blocks) : 0;
+}
+
+uint32_t sm_spectrum_worst(void)
+{
+    return spectrum_worst;
+}
+
+void sm_set_sample_rate(uint32_t rate)
+{
+    sample_rate = rate;
+}
+
+void sm_set_reserve(bool enable)
+{
+    reserve = enable;
+}
+
+void sm_set_instant_on(bool enable)
+{
+    instant = enable;
+}
+
+void sm_set_bench_size(uint32_t bytes)
+{
+    bench_size = bytes;
+}
+
+const Bench_result *sm_bench(void)
+{
+    return bench_done ? &bench_result : NULL;
+}
+
+uint32_t sm_played(void)
+{
+    return playback.samples;
+}
+
+uint32_t sm_underruns(void)
+{
+    return playback.underruns;
+}
+
+uint32_t sm_read_latency(void)
+{
+    return read_latency;
+}
+
+/*
+    Microseconds since boot: SysTick's 1 ms wraps plus how far the
+    current one has counted down. Both are read with the tick masked; a
+    wrap whose handler has not run yet shows as pending and is counted
+    here.
+*/
+static uint32_t timestamp(void)
+{
+    uint32_t key = nvic_enter_critical(INIT_PRIORITY_TICK);
+    uint32_t tick = systick_ticks();
+    uint32_t value = systick_value();
+    if (nvic_pending_systick())
     {
-        buffer.ptr1 = buffer.buff2;
-        buffer.ptr2 = buffer.buff1;
-        buffer.swapped = true;
+        tick++;
+        value = systick_value();
     }
-    else
+    nvic_exit_critical(key);
+    return tick * TICK_US + (INIT_TICK_LOAD - value) / (INIT_TICK_CLOCK / 1000000);
+}
+
+static void poll_card(void)
+{
+    bool present = sw_read(detect);
+    if (!present && card_missing)
     {
-        buffer.ptr1 = buffer.buff1;
-        buffer.ptr2 = buffer.buff2;
-        buffer.swapped = false;
+        card_present = false;
     }
+    card_missing = !present;
+    alarm_start(card_poll, CARD_POLL_MS);
+}
+
+/*
+    Samples flow into the pool from here on, whether or not there is a
+    file to drain them into yet.
+*/
+static bool start_capture(void)
+{
+    if (capture_configure(sample_rate, &info) != CAPTURE_OK)
+    {
+        return false;
+    }
+    capture_load = capture_period() - 1;
+    first_sample = 0;
+    triggered = timestamp();
+    timer_enable(timer0, TIMER_A);
+    return true;
 }
 
 static void initial(void)
 {
-    buffer.ptr1 = buffer.buff1;
-    buffer.ptr2 = buffer.buff2;
-    buffer.swapped = false;
-    buffer.data_ready = false;
+    blockpool_init();
+    buffer.fill = NULL;
     buffer.index = 0;
+    buffer.overruns = 0;
 
     start = sw_create(SW1);
     stop = sw_create(SW2);
     unmount = sw_create(SW3);
     detect = sw_create(SW4);
+    card_present = sw_read(detect);
+    card_missing = !card_present;
+    card_poll = alarm_create(poll_card);
+    alarm_start(card_poll, CARD_POLL_MS);
     timer0 = timer_address(TIMER_MOD0);
+    timer1 = timer_address(TIMER_MOD1);
     portg = gpio_address(GPIO_PORTG);
     adc0 = adc_address(ADC_MOD0);
 
     info.chunk_size = 0;
     info.num_channels = 1;
-    info.sample_rate = 40000;
-    info.bits_per_sample = 16;
+    info.audio_format = SAMPLE_WAVE_FORMAT;
+    info.bits_per_sample = SAMPLE_BITS;
+    agc_configure(agc_config);
 
     FRESULT status = f_mount(0, &fatfs);
     if(status != FR_OK)
     {
         state = error;
     }
-    state = wait;
+    else if (sw_read(start) && sw_read(unmount))
+    {
+        state = bench;
+    }
+    else if (sw_read(stop))
+    {
+        state = cue;
+    }
+    else if (instant)
+    {
+        init_clock(CLOCK_RUN);
+        state = start_capture() ? open : error;
+    }
+    else
+    {
+        state = calibrate;
+    }
+}
+
+static void calibrate(void)
+{
+    /*
+        Time a burst of buffer-sized writes to a scratch file so the
+        capture configuration can be checked against what the card
+        actually sustains.
+    */
+    if (!card_present)
+    {
+        state = error;
+        return;
+    }
+    void *block = blockpool_acquire();
+    FRESULT status = block ? f_open(&file, "SPEED.TMP", FA_CREATE_ALWAYS|FA_WRITE) : FR_NOT_ENOUGH_CORE;
+    UINT bytes_written = 0;
+    uint32_t begin = timestamp();
+    for (uint8_t i = 0; status == FR_OK && i < CALIBRATE_BUFFERS; i++)
+    {
+        status = f_write(&file, block, BLOCKPOOL_BLOCK_SAMPLES * SAMPLE_BYTES, &bytes_written);
+    }
+    if (block)
+    {
+        blockpool_release(block);
+    }
+    if (status == FR_OK)
+    {
+        status = f_close(&file);
+    }
+    if (status == FR_OK)
+    {
+        capture_measure(CALIBRATE_BUFFERS * BLOCKPOOL_BLOCK_SAMPLES * SAMPLE_BYTES, timestamp() - begin);
+        status = f_unlink("SPEED.TMP");
+    }
+    if (status == FR_OK)
+    {
+        status = catalog_build();
+    }
+    if (status == FR_OK)
+    {
+        init_clock(CLOCK_IDLE);
+        state = wait;
+    }
+    else
+    {
+        state = error;
+    }
+}
+
+static void bench(void)
+{
+    if (!card_present)
+    {
+        state = error;
+        return;
+    }
+    init_clock(CLOCK_RUN);
+    FRESULT status = bench_run(&file, "BENCH.TMP", bench_size, &bench_result);
+    if (status == FR_OK)
+    {
+        bench_done = true;
+        info.sample_rate = sample_rate;
+        status = bench_report(&file, "BENCH.TXT", &bench_result, &info, blockpool_count());
+    }
+    if (status == FR_OK)
+    {
+        status = f_mount(0, NULL);
+    }
+    init_clock(CLOCK_IDLE);
+    state = status == FR_OK ? done : error;
+}
+
+/*
+    Builds the link map of the file just opened. When the chain already
+    has more fragments than the map holds the file stays in normal seek
+    mode.
+*/
+static void map_clusters(void)
+{
+    linkmap[0] = LINKMAP_ITEMS;
+    file.cltbl = linkmap;
+    f_lseek(&file, CREATE_LINKMAP);
+}
+
+/*
+    Reads the next block of the recording into a free pool block and
+    queues it. Returns false when there is no free block or nothing left
+    to read.
+*/
+static bool read_block(void)
+{
+    uint32_t data = info.chunk_size - info.header_bytes;
+    if (playback.queued >= data)
+    {
+        return false;
+    }
+    void *block = blockpool_acquire();
+    if (!block)
+    {
+        return false;
+    }
+    UINT bytes_read;
+    uint32_t begin = timestamp();
+    FRESULT status = f_read(&file, block, playback.fill, &bytes_read);
+    uint32_t elapsed = timestamp() - begin;
+    if (elapsed > read_latency)
+    {
+        read_latency = elapsed;
+    }
+    if (status != FR_OK || !bytes_read)
+    {
+        /*
+            The data size was trimmed to the file, so this is the card
+            failing.
+        */
+        blockpool_release(block);
+        timer_disable(timer1, TIMER_A);
+        playback.failed = true;
+        playback.ended = true;
+        return false;
+    }
+    playback.queued += bytes_read;
+    blockpool_submit(block);
+    return true;
+}
+
+static void cue(void)
+{
+    FRESULT status = card_present ? catalog_build() : FR_NOT_READY;
+    if (status == FR_OK)
+    {
+        status = catalog_latest() ? f_open(&file, catalog_latest(), FA_READ) : FR_NO_FILE;
+    }
+    if (status == FR_OK)
+    {
+        map_clusters();
+    }
+    if (status != FR_OK || !wave_read_header(&file, &info))
+    {
+        state = error;
+        return;
+    }
+    init_clock(CLOCK_RUN);
+    if (player_configure(&info) != PLAYER_OK)
+    {
+        state = error;
+        return;
+    }
+    playback.block = NULL;
+    playback.frame = player_frame();
+    playback.fill = player_fill(BLOCKPOOL_BLOCK_SIZE);
+    playback.remaining = (info.chunk_size - info.header_bytes) / playback.frame * playback.frame;
+    playback.queued = 0;
+    playback.samples = 0;
+    playback.underruns = 0;
+    playback.silent = false;
+    playback.failed = false;
+    playback.ended = false;
+    read_latency = 0;
+    while (read_block())
+    {
+        // Fill the pool before the first period
+    }
+    timer_enable(timer1, TIMER_A);
+    state = play;
+}
+
+static void play(void)
+{
+    if (!card_present || sw_read(start))
+    {
+        timer_disable(timer1, TIMER_A);
+        playback.ended = true;
+    }
+    if (playback.ended)
+    {
+        state = unload;
+        return;
+    }
+    read_block();
+}
+
+static void unload(void)
+{
+    if (playback.block)
+    {
+        blockpool_release((void *)playback.block);
+        playback.block = NULL;
+    }
+    for (void *block; (block = blockpool_next()); )
+    {
+        blockpool_release(block);
+    }
+    FRESULT result = f_close(&file);
+    if (result == FR_OK)
+    {
+        result = f_mount(0, NULL);
+    }
+    init_clock(CLOCK_IDLE);
+    state = result == FR_OK && !playback.failed ? done : error;
 }
 
 static void wait(void)
 {
-    if (!sw_read(detect))
+    if (!card_present)
     {
         state = error;
     }
     if (sw_read(start))
     {
-        state = open;
+        init_clock(CLOCK_RUN);
+        state = start_capture() ? open : error;
+    }
+}
+
+static void erase_ahead(void)
+{
+    if (!erase_sector || power_failed)
+    {
+        return;
+    }
+    if (file.fsize > erase_offset)
+    {
+        erase_sector = 0;
+        erases_skipped++;
+    }
+    else if (blockpool_available() > 1 &&
+             (uint64_t)(blockpool_available() - 1) * BLOCKPOOL_BLOCK_SAMPLES * 1000 > (uint64_t)erase_ms * info.sample_rate)
+    {
+        DWORD range[2] = { erase_sector, erase_sector + reserve_unit / 512 - 1 };
+        disk_ioctl(0, CTRL_ERASE_SECTOR, range);
+        erase_sector = 0;
+    }
+}
+
+/*
+    Neither a reservation nor an erase is started once the supply is
+    going: emergency() waits for whatever card access is in progress,
+    and one the trip lands in is all it has to wait for.
+*/
+static void reserve_ahead(void)
+{
+    if (power_failed)
+    {
+        return;
+    }
+    if (reserve_unit && file.fsize + reserve_unit / 2 >= reserved)
+    {
+        DWORD sector;
+        uint32_t begin = timestamp();
+        if (f_reserve(&file, reserve_unit, reserve_align, &sector) == FR_OK)
+        {
+            erase_sector = sector;
+            erase_offset = reserved;
+            reserved += reserve_unit;
+        }
+        else
+        {
+            reserve_unit = 0;
+        }
+        uint32_t elapsed = timestamp() - begin;
+        if (elapsed > reserve_latency)
+        {
+            reserve_latency = elapsed;
+        }
     }
+    erase_ahead();
 }
 
+/*
+    Capture is already running: the card is initialised and mounted by
+    the catalog walk when instant-on skipped calibration, and the blocks
+    captured until the header is down are written once record() starts.
+*/
 static void open(void)
 {
-    FRESULT status = f_open(&file, "TEST.WAV", FA_CREATE_ALWAYS|FA_WRITE);
+    FRESULT status = !card_present ? FR_NOT_READY : instant ? catalog_build() : FR_OK;
+    if (status == FR_OK)
+    {
+        status = catalog_create(&file);
+    }
     if (status != FR_OK)
     {
+        timer_disable(timer0, TIMER_A);
         state = error;
     }
     else
     {
+        map_clusters();
+        DWORD au;
+        reserve_unit = 0;
+        reserved = 0;
+        reserve_latency = 0;
+        erase_sector = 0;
+        erases_skipped = 0;
+        if (reserve && disk_ioctl(0, GET_BLOCK_SIZE, &au) == RES_OK &&
+            disk_ioctl(0, MMC_GET_ERASE_TIME, &erase_ms) == RES_OK)
+        {
+            reserve_align = au;
+            reserve_unit = au * 512;
+        }
+        reserve_ahead();
         wave_write_header(&file, &info);
-        f_sync(&file);
-        timer_enable(timer0, TIMER_A);
+        write_status = f_sync(&file);
+        file_ready = timestamp();
+        /*
+            The summary grows by about one byte for every 170 of the
+            recording, a cluster at a time.
+        */
+        peaks_open(catalog_latest(), &info);
+        if (agc_enabled())
+        {
+            agc_open(catalog_latest(), &info, BLOCKPOOL_BLOCK_SAMPLES);
+        }
+        agc_blocks = 0;
+        agc_total = 0;
+        agc_worst = 0;
+#ifdef SPECTRUM
+        spectrum_open(catalog_latest(), &info);
+        spectrum_blocks = 0;
+        spectrum_total = 0;
+        spectrum_worst = 0;
+#endif
+        window_copies = file.wcopy;
+        write_latency = 0;
+        fat_entries = fatfs.fscan;
         state = record;
     }
 }
 
+/*
+    Writes the oldest filled block, if any, and hands it back to the
+    pool. Returns false when nothing was waiting or the write failed.
+*/
+static bool write_block(void)
+{
+    void *block = blockpool_next();
+    if (!block)
+    {
+        return false;
+    }
+    if (agc_enabled())
+    {
+        uint32_t begin = dwt_cycles();
+        agc_apply(block, 2 * BLOCKPOOL_BLOCK_SAMPLES);
+        uint32_t cycles = dwt_cycles() - begin;
+        agc_blocks++;
+        agc_total += cycles;
+        if (cycles > agc_worst)
+        {
+            agc_worst = cycles;
+        }
+    }
+    /*
+        The samples are summarised while the block is at hand, before it
+        is packed and goes to the card.
+    */
+    peaks_add(block, 2 * BLOCKPOOL_BLOCK_SAMPLES);
+    UINT bytes = sample_pack(block, BLOCKPOOL_BLOCK_SAMPLES);
+    UINT bytes_written;
+    uint32_t written = timestamp();
+    FRESULT status = write_status == FR_OK ? f_write(&file, block, bytes, &bytes_written) : write_status;
+    uint32_t elapsed = timestamp() - written;
+    capture_measure(bytes_written, elapsed);
+    if (elapsed > write_latency)
+    {
+        write_latency = elapsed;
+    }
+    info.chunk_size += bytes_written;
+    if (status != FR_OK || bytes_written != bytes)
+    {
+        write_status = status != FR_OK ? status : FR_DENIED;
+        blockpool_release(block);
+        return false;
+    }
+#ifdef SPECTRUM
+    /*
+        The analysis overwrites the block, so it waits until the card has
+        it, and is left out once the supply is going.
+    */
+    if (!power_failed)
+    {
+        uint32_t begin = dwt_cycles();
+        spectrum_add(block, 2 * BLOCKPOOL_BLOCK_SAMPLES);
+        uint32_t cycles = dwt_cycles() - begin;
+        spectrum_blocks++;
+        spectrum_total += cycles;
+        if (cycles > spectrum_worst)
+        {
+            spectrum_worst = cycles;
+        }
+    }
+#endif
+    blockpool_release(block);
+    return true;
+}
+
 static void record(void)
 {
-    if (!sw_read(detect))
+    if (!card_present)
     {
         state = error;
     }
@@ -134,67 +898,262 @@ static void record(void)
         timer_disable(timer0, TIMER_A);
         state = finish;
     }
-    if (buffer.data_ready)
+    write_block();
+    if (write_status != FR_OK)
     {
-        buffer.data_ready = false;
-        UINT bytes_written;
-        f_write(&file, (const void *)buffer.ptr2, BUFFER_MAX, &bytes_written);
-        info.chunk_size += bytes_written;
+        timer_disable(timer0, TIMER_A);
+        state = finish;
+        return;
     }
+    reserve_ahead();
 }
 
 static void finish(void)
 {
-    wave_update_header(&file, &info);
-    FRESULT result = f_close(&file);
-    if (result != FR_OK)
+    while (write_block())
     {
-        state = error;
+        // Drain the blocks captured before stop
     }
-    result = f_mount(0, NULL);
-    if (result != FR_OK)
+    /*
+        The header ends on a sector boundary and every block is whole
+        sectors, so none of the samples should have gone through the
+        file's sector buffer.
+    */
+    window_copies = file.wcopy - window_copies;
+    fat_entries = fatfs.fscan - fat_entries;
+    /*
+        Hand back the part of the reservation past the last sample.
+    */
+    FRESULT result = write_status == FR_OK ? f_truncate(&file) : write_status;
+    if (result == FR_OK)
     {
-        state = error;
+        wave_update_header(&file, &info);
     }
-    while (1)
+    /*
+        The file is closed whatever went wrong before, so the directory
+        entry covers the samples that did reach the card; the first
+        error is the one kept.
+    */
+    FRESULT closed = f_close(&file);
+    result = result == FR_OK ? closed : result;
+    peaks_close();
+    agc_close();
+#ifdef SPECTRUM
+    spectrum_close();
+#endif
+    FRESULT unmounted = f_mount(0, NULL);
+    if (result == FR_OK && unmounted == FR_OK)
     {
+        init_clock(CLOCK_IDLE);
+        state = done;
+    }
+    else
+    {
+        state = error;
+    }
+}
+
+static void done(void)
+{
+
+}
 
+/*
+    The supply is going: the blocks still in the pool and the part of a
+    block captured so far are written, the header patched and the file
+    closed, with no sector read back from the card. The reservation
+    past the last sample is left linked to the file rather than spend
+    FAT writes on it; the next recording frees it.
+
+    Hold-up budget, from the comparator tripping to the file closed, as
+    measured in the simulator at 40 kHz with reservation on: 3.6 ms to
+    5.2 ms while recording (the blocks still in the pool, then the tail,
+    header and directory sectors), up to 14 ms when the trip lands in
+    the link of a reserved unit, and the card's erase time for one unit
+    plus some 10 ms when it lands in that unit's erase (60 ms with a
+    50 ms erase), plus any garbage collection stall the card takes
+    during it. With the gain stage on, each block still in the pool
+    costs its pass as well, some 30k cycles.
+
+    The files beside the recording are closed after it, on whatever the
+    supply has left: some 1.5 ms each for the summary, the gain log and
+    the spectrum, so 7 ms from the trip with the summary alone and
+    11 ms with all three. A supply gone before then leaves the one
+    being closed with its count 0 over the records synced so far.
+*/
+static void emergency(void)
+{
+    while (write_block())
+    {
+        // Drain the blocks captured before the trip
     }
+    window_copies = file.wcopy - window_copies;
+    fat_entries = fatfs.fscan - fat_entries;
+    /*
+        Every block went straight to the card, so the file's sector
+        buffer still holds the header: it is patched there first, and
+        the partial block after it starts a fresh sector at the end.
+    */
+    UINT tail = 0;
+    if (buffer.fill && buffer.index)
+    {
+        if (agc_enabled())
+        {
+            agc_apply((void *)buffer.fill, 2 * buffer.index);
+        }
+        peaks_add((void *)buffer.fill, 2 * buffer.index);
+        tail = sample_pack((void *)buffer.fill, buffer.index);
+    }
+    info.chunk_size += tail;
+    FRESULT result = write_status;
+    if (result == FR_OK)
+    {
+        wave_update_header(&file, &info);
+        result = f_lseek(&file, file.fsize);
+    }
+    if (result == FR_OK && tail)
+    {
+        UINT bytes_written;
+        result = f_write(&file, (void *)buffer.fill, tail, &bytes_written);
+        result = result == FR_OK && bytes_written != tail ? FR_DENIED : result;
+    }
+    FRESULT closed = f_close(&file);
+    result = result == FR_OK ? closed : result;
+    power_flush = timestamp() - power_tripped;
+    /*
+        The files beside it only once the recording is safe; the tail
+        went into the summary before it was packed.
+    */
+    peaks_close();
+    agc_close();
+#ifdef SPECTRUM
+    spectrum_close();
+#endif
+    state = result == FR_OK ? off : error;
+}
+
+static void off(void)
+{
+
 }
 
 static void error(void)
 {
-    while (1)
-    {
 
-    }
 }
 
 void isr_timer0A(void)
 {
+    /*
+        Cycles since the timeout reloaded the counter: exception entry
+        plus anything that held the handler off.
+    */
+    uint32_t latency = capture_load - timer_value(timer0, TIMER_A);
+    if (latency > capture_latency)
+    {
+        capture_latency = latency;
+    }
+    if (!first_sample)
+    {
+        first_sample = timestamp();
+    }
     gpio_write_toggle(portg, GPIO_BIT1);
     adc_sample(adc0, ADC_SAMPLER0);
-    *(volatile unsigned int *)(0x40030024) |= 0x01F;
+    timer_clear_interrupt(timer0, TIMER_A_TIMEOUT);
+}
+
+/*
+    Rising edge of a PWM period: the match for the next one is loaded
+    with the next sample of the first channel. Once the last sample has
+    gone out the output is left at midscale and the timer stopped a
+    period later.
+*/
+RAMFUNC void isr_timer1A(void)
+{
+    timer_clear_interrupt(timer1, TIMER_A_EVENT);
+    if (!playback.remaining)
+    {
+        if (!playback.silent)
+        {
+            timer_set_match(timer1, TIMER_A, player_match(0));
+            playback.silent = true;
+        }
+        else
+        {
+            timer_disable(timer1, TIMER_A);
+            playback.ended = true;
+        }
+        return;
+    }
+    if (!playback.block)
+    {
+        playback.block = blockpool_next();
+        playback.index = 0;
+    }
+    if (!playback.block)
+    {
+        playback.underruns++;
+        return;
+    }
+    timer_set_match(timer1, TIMER_A, player_match(player_sample(playback.block + playback.index)));
+    playback.samples++;
+    playback.index += playback.frame;
+    playback.remaining -= playback.frame;
+    if (playback.index >= playback.fill || !playback.remaining)
+    {
+        blockpool_release((void *)playback.block);
+        playback.block = NULL;
+    }
 }
 
-void isr_timer1A(void)
+/*
+    Supply below the threshold: sampling stops here, and the state
+    machine saves the recording once the card access in progress, if
+    any, returns.
+*/
+void isr_comp0(void)
 {
-    disk_timerproc();
-    *(volatile unsigned int *)(0x40031024) |= 0x01F;
+    timer_disable(timer_address(TIMER_MOD0), TIMER_A);
+    if (!power_failed)
+    {
+        power_tripped = timestamp();
+        power_failed = true;
+    }
+    comp_clear_interrupt(comp_address(), COMP_MOD0);
 }
 
-void isr_adc0_sequence0(void)
+RAMFUNC void isr_adc0_sequence0(void)
 {
+    uint32_t entry = dwt_cycles();
     int16_t result = (int16_t)adc_result(adc0, ADC_SAMPLER0);
     result -= DC_BIAS;
-    *buffer.ptr1++ = result;
-    *buffer.ptr1++ = result >> 8;
-    buffer.index += 2;
-    if (buffer.index >= BUFFER_MAX)
+    if (!buffer.index)
+    {
+        buffer.fill = blockpool_acquire();
+    }
+    if (buffer.fill)
     {
-        swap();
+        buffer.fill[buffer.index] = result;
+    }
+    if (++buffer.index >= BLOCKPOOL_BLOCK_SAMPLES)
+    {
+        if (buffer.fill)
+        {
+            blockpool_submit((void *)buffer.fill);
+        }
+        else
+        {
+            buffer.overruns++;
+        }
         buffer.index = 0;
-        buffer.data_ready = true;
     }
-    *(volatile unsigned int *)(0x4003800C) |= (1U << 0);
+    adc_clear_interrupt(adc0, ADC_SAMPLER0);
+    /*
+        Worst case handler body, entry and exit stacking excluded.
+    */
+    uint32_t cycles = dwt_cycles() - entry;
+    if (cycles > isr_cycles)
+    {
+        isr_cycles = cycles;
+    }
 }
@@ -47,10 +47,12 @@ extern int main(void);
 
 //*****************************************************************************
 //
-// Reserve space for the system stack.
+// The system stack is reserved by the linker script (.stack, sized by
+// STACK_SIZE in the makefile); these mark its ends.
 //
 //*****************************************************************************
-static uint32_t pui32Stack[128];
+extern uint32_t __stack_start__;
+extern uint32_t __stack_end__;
 
 //*****************************************************************************
 //
@@ -61,6 +63,7 @@ extern void isr_systick(void);
 extern void isr_timer0A(void);
 extern void isr_timer1A(void);
 extern void isr_adc0_sequence0(void);
+extern void isr_comp0(void);
 
 //*****************************************************************************
 //
@@ -72,7 +75,7 @@ extern void isr_adc0_sequence0(void);
 __attribute__ ((section(".intvecs")))
 void (* const g_pfnVectors[])(void) =
 {
-    (void (*)(void))((uint32_t)pui32Stack + sizeof(pui32Stack)),
+    (void (*)(void))((uint32_t)&__stack_end__),
                                             // The initial stack pointer
     ResetISR,                               // The reset handler
     NmiSR,                                  // The NMI handler
@@ -114,7 +117,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // Timer 1 subtimer B
     IntDefaultHandler,                      // Timer 2 subtimer A
     IntDefaultHandler,                      // Timer 2 subtimer B
-    IntDefaultHandler,                      // Analog Comparator 0
+    isr_comp0,                              // Analog Comparator 0
     IntDefaultHandler,                      // Analog Comparator 1
     IntDefaultHandler,                      // Analog Comparator 2
     IntDefaultHandler,                      // System Control (PLL, OSC, BO)
@@ -230,6 +233,18 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler                       // PWM 1 Fault
 };
 
+//*****************************************************************************
+//
+// The SRAM copy of the vector table.  The linker places it at the start of
+// SRAM, which satisfies the 1024 byte alignment VTOR needs for this many
+// vectors; ResetISR() fills it in and points VTOR at it.
+//
+//*****************************************************************************
+#define NUM_VECTORS (sizeof(g_pfnVectors) / sizeof(g_pfnVectors[0]))
+
+__attribute__ ((section(".vtable"), aligned(1024)))
+static void (*g_pfnRAMVectors[NUM_VECTORS])(void);
+
 //*****************************************************************************
 //
 // The following are constructs created by the linker, indicating where the
@@ -242,6 +257,9 @@ extern uint32_t __data_start__;
 extern uint32_t __data_end__;
 extern uint32_t __bss_start__;
 extern uint32_t __bss_end__;
+extern uint32_t __ramfunc_load__;
+extern uint32_t __ramfunc_start__;
+extern uint32_t __ramfunc_end__;
 
 //*****************************************************************************
 //
@@ -267,6 +285,25 @@ ResetISR(void)
         *pui32Dest++ = *pui32Src++;
     }
 
+    //
+    // Copy the functions that execute from SRAM out of flash.
+    //
+    pui32Src = &__ramfunc_load__;
+    for(pui32Dest = &__ramfunc_start__; pui32Dest < &__ramfunc_end__; )
+    {
+        *pui32Dest++ = *pui32Src++;
+    }
+
+    //
+    // Copy the vector table to SRAM and relocate VTOR to it, so the vector
+    // fetch on exception entry does not wait on flash either.
+    //
+    for(uint32_t ui32Idx = 0; ui32Idx < NUM_VECTORS; ui32Idx++)
+    {
+        g_pfnRAMVectors[ui32Idx] = g_pfnVectors[ui32Idx];
+    }
+    HWREG(0xE000ED08) = (uint32_t)g_pfnRAMVectors;
+
     //
     // Zero fill the bss segment.
     //
@@ -280,6 +317,20 @@ ResetISR(void)
           "        strlt   r2, [r0], #4\n"
           "        blt     zero_loop");
 
+    //
+    // Paint the stack below this frame with STACK_PAINT (stack.h), so that
+    // stack_high_water() can find the deepest word anything has written.
+    //
+    __asm("    ldr     r0, =__stack_start__\n"
+          "    mov     r1, sp\n"
+          "    ldr     r2, =0xC5C5C5C5\n"
+          "    .thumb_func\n"
+          "paint_loop:\n"
+          "        cmp     r0, r1\n"
+          "        it      lt\n"
+          "        strlt   r2, [r0], #4\n"
+          "        blt     paint_loop");
+
     //
     // Enable the floating-point unit.  This must be done here to handle the
     // case where main() uses floating-point and the function prologue saves
@@ -0,0 +1,73 @@
+# SRAM budget from `size -A` output: what each object file puts in .data,
+# .ramfunc and .bss, then how the linked image splits the 32 KB between
+# those, the stack and the block pool that takes what is left.
+#
+#   arm-none-eabi-size -A build/*.o build/Recording_Device | awk -f Tools/budget.awk
+
+function flush()
+{
+    if (module == "")
+    {
+        return
+    }
+    total = data + ramfunc + bss
+    if (total)
+    {
+        printf "  %-20s %7d %8d %7d %7d\n", module, data, ramfunc, bss, total
+    }
+    sum_data += data
+    sum_ramfunc += ramfunc
+    sum_bss += bss
+    data = ramfunc = bss = 0
+}
+
+BEGIN {
+    SRAM = 536870912
+    printf "SRAM by module (bytes)     data  ramfunc     bss   total\n"
+}
+
+/^[^ \t].*:$/ {
+    flush()
+    module = $1
+    sub(/^.*\//, "", module)
+    image = module !~ /\.o$/
+    if (image)
+    {
+        module = ""
+    }
+    next
+}
+
+image && $3 ~ /^[0-9]+$/ && $3 >= SRAM {
+    section[++sections] = $1
+    size[sections] = $2
+    next
+}
+
+$1 ~ /^\.data/ || $1 == ".vtable" {
+    data += $2
+}
+
+$1 ~ /^\.ramfunc/ {
+    ramfunc += $2
+}
+
+$1 ~ /^\.bss/ {
+    bss += $2
+}
+
+END {
+    flush()
+    printf "  %-20s %7d %8d %7d %7d\n", "modules", sum_data, sum_ramfunc,
+        sum_bss, sum_data + sum_ramfunc + sum_bss
+    if (sections)
+    {
+        printf "SRAM by section (bytes)\n"
+        for (i = 1; i <= sections; i++)
+        {
+            printf "  %-20s %7d\n", section[i], size[i]
+            used += size[i]
+        }
+        printf "  %-20s %7d\n", "total", used
+    }
+}
@@ -0,0 +1,157 @@
+# Worst-case stack depth per call-graph root, from the .ci files GCC writes
+# with -fcallgraph-info=su.
+#
+# Roots are the functions nothing calls directly: main, the interrupt
+# handlers and the functions only reached through a pointer (the sm.c state
+# functions). A call through a pointer is charged the deepest of the roots
+# defined in the caller's own file, which is conservative. Calls to functions with no
+# frame size (library code) count zero and are listed at the end.
+#
+#   awk -f Tools/stack.awk build/*.ci
+
+function name(title)
+{
+    sub(/^.*:/, "", title)
+    return title
+}
+
+function handler(f)
+{
+    return name(f) ~ /^isr_|SR$|Handler$/
+}
+
+function indirect(f,    g, d, best)
+{
+    best = 0
+    for (g in frame)
+    {
+        if (!(g in called) && file[g] == file[f] && !(g in active) && !handler(g))
+        {
+            d = depth(g)
+            if (d > best || target[f] == "")
+            {
+                best = d
+                target[f] = g
+            }
+        }
+    }
+    return best
+}
+
+function depth(f,    i, n, to, d, best, pick)
+{
+    if (f in memo)
+    {
+        return memo[f]
+    }
+    if (!(f in frame))
+    {
+        unknown[name(f)] = 1
+        return memo[f] = 0
+    }
+    active[f] = 1
+    best = 0
+    n = calls[f]
+    for (i = 1; i <= n; i++)
+    {
+        to = callee[f, i]
+        if (to in active)
+        {
+            recursive[to] = 1
+            continue
+        }
+        d = to == "__indirect_call" ? indirect(f) : depth(to)
+        if (d > best || pick == "")
+        {
+            best = d
+            pick = to
+        }
+    }
+    delete active[f]
+    via[f] = pick
+    return memo[f] = frame[f] + best
+}
+
+function path(f,    p)
+{
+    p = name(f)
+    while (via[f] != "")
+    {
+        f = via[f] == "__indirect_call" ? target[f] : via[f]
+        p = p " > " name(f)
+    }
+    return p
+}
+
+/^node:/ && /bytes \(/ {
+    match($0, /title: "[^"]*"/)
+    f = substr($0, RSTART + 8, RLENGTH - 9)
+    match($0, /[0-9]+ bytes \([a-z,]*\)/)
+    s = substr($0, RSTART, RLENGTH)
+    frame[f] = s + 0
+    match($0, /\\n[^:]*:/)
+    file[f] = substr($0, RSTART + 2, RLENGTH - 3)
+    if (s ~ /dynamic\)/)
+    {
+        dynamic[f] = 1
+    }
+}
+
+/^edge:/ {
+    match($0, /sourcename: "[^"]*"/)
+    from = substr($0, RSTART + 13, RLENGTH - 14)
+    match($0, /targetname: "[^"]*"/)
+    to = substr($0, RSTART + 13, RLENGTH - 14)
+    if (!((from, to) in edge))
+    {
+        edge[from, to] = 1
+        callee[from, ++calls[from]] = to
+        called[to] = 1
+    }
+}
+
+END {
+    for (f in frame)
+    {
+        if (!(f in called))
+        {
+            d = depth(f)
+            line = sprintf("  %-24s %6d  %s", name(f), d, path(f))
+            if (handler(f))
+            {
+                isr = isr line "\n"
+                isr_total += d
+                isr_count++
+            }
+            else
+            {
+                root = root line "\n"
+                if (name(f) == "main")
+                {
+                    thread = d
+                }
+            }
+        }
+    }
+    printf "thread roots (bytes, deepest path)\n%s", root
+    printf "interrupt handlers\n%s", isr
+    # Exception entry stacks 8 words, 26 with the lazy FP context, per level.
+    printf "worst case: main %d + handlers %d + %d x 104 frame = %d\n",
+        thread, isr_total, isr_count, thread + isr_total + isr_count * 104
+    for (f in dynamic)
+    {
+        printf "dynamic frame: %s\n", name(f)
+    }
+    for (f in recursive)
+    {
+        printf "recursion through: %s\n", name(f)
+    }
+    for (f in unknown)
+    {
+        list = list " " f
+    }
+    if (list != "")
+    {
+        printf "no frame size:%s\n", list
+    }
+}
@@ -240,7 +240,8 @@ const SecondaryHeader = ({ onFileChange, hasFile, handleFileRemove }) => {
 
         <input
           type="file"
-          accept="audio/*"
+          accept="audio/*,.pks"
+          multiple
           onChange={onFileChange}
           style={{ display: "none" }}
           id="audio-upload"
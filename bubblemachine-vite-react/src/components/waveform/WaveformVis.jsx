@@ -44,6 +44,7 @@ const WaveformVis = ({
   setIsAudioLoaded,
   bubbleTrigger,
   audioFile,
+  audioPeaks,
 }) => {
   // Refs
   const waveformRef = useRef(null);
@@ -283,7 +284,7 @@ const WaveformVis = ({
       // Initialize new instance
       const ws = initializeWavesurfer();
       setWavesurfer(ws);
-      ws.load(audioFile);
+      ws.load(audioFile, audioPeaks?.peaks, audioPeaks?.duration);
       setZoomLevel(ZOOM_SETTINGS.FULL.level);
     } else {
       // Handle file removal
@@ -0,0 +1,37 @@
+// Reads the .PKS summary the recorder writes next to each WAV: a 16-byte
+// header ("PKS1", sample rate, samples per record, bytes per record, record
+// count) and one min/max/RMS record of little-endian int16s per block of
+// samples. Returns what WaveSurfer needs to draw without decoding the audio,
+// or null if the file is not a summary.
+export const readPeaks = (buffer) => {
+  if (buffer.byteLength < 16) return null;
+  const view = new DataView(buffer);
+  const magic = String.fromCharCode(
+    view.getUint8(0),
+    view.getUint8(1),
+    view.getUint8(2),
+    view.getUint8(3)
+  );
+  const sampleRate = view.getUint32(4, true);
+  const samplesPerRecord = view.getUint16(8, true);
+  const bytesPerRecord = view.getUint16(10, true);
+  if (magic !== "PKS1" || !sampleRate || bytesPerRecord < 4) return null;
+
+  // A recording cut short by a power failure leaves the count at 0
+  const stored = view.getUint32(12, true);
+  const count =
+    stored || Math.floor((buffer.byteLength - 16) / bytesPerRecord);
+
+  // Max and min alternate so each record spans its full swing
+  const channel = new Float32Array(count * 2);
+  for (let i = 0; i < count; i++) {
+    const offset = 16 + i * bytesPerRecord;
+    channel[2 * i] = view.getInt16(offset + 2, true) / 32768;
+    channel[2 * i + 1] = view.getInt16(offset, true) / 32768;
+  }
+
+  return {
+    peaks: [channel],
+    duration: (count * samplesPerRecord) / sampleRate,
+  };
+};
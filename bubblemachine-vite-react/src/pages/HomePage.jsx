@@ -10,6 +10,7 @@ import Typography from "@mui/material/Typography";
 import SecondaryHeader from "../components/layout/HomePageHeader";
 import CommentsTable from "../components/table/CommentsTable";
 import ConfirmDialog from "./ConfirmDialog";
+import { readPeaks } from "../helpers/peaks";
 export default function HomePage() {
   const [audioDuration, setAudioDuration] = useState(0);
   const [vizWidth, setVizWidth] = useState(800);
@@ -21,14 +22,20 @@ export default function HomePage() {
   const [isAudioLoaded, setIsAudioLoaded] = useState(false);
   const [wavesurfer, setWavesurfer] = useState(null);
   const [audioFile, setAudioFile] = useState(null);
+  const [audioPeaks, setAudioPeaks] = useState(null);
   const [hasFile, setHasFile] = useState(false);
   const [isConfirmDialogOpen, setIsConfirmDialogOpen] = useState(false);
 
   // Move file handling functions here
-  const handleFileChange = (e) => {
-    const file = e.target.files[0];
+  // A recording can be loaded together with its .PKS summary, which lets the
+  // waveform draw without decoding the whole file
+  const handleFileChange = async (e) => {
+    const files = Array.from(e.target.files);
+    const file = files.find((f) => !f.name.toLowerCase().endsWith(".pks"));
+    const summary = files.find((f) => f.name.toLowerCase().endsWith(".pks"));
     if (file) {
       const fileUrl = URL.createObjectURL(file);
+      setAudioPeaks(summary ? readPeaks(await summary.arrayBuffer()) : null);
       setAudioFile(fileUrl);
       setAudioFileName(file.name);
       setIsAudioLoaded(true);
@@ -38,6 +45,7 @@ export default function HomePage() {
 
   const confirmFileRemove = () => {
     setAudioFile(null);
+    setAudioPeaks(null);
     setAudioFileName("");
     setIsAudioLoaded(false);
     setHasFile(false);
@@ -117,6 +125,7 @@ export default function HomePage() {
               bubbleTrigger={bubbleTrigger}
               wavesurfer={wavesurfer}
               audioFile={audioFile} // Pass audioFile as prop
+              audioPeaks={audioPeaks}
             />
           </Box>
         </Box>